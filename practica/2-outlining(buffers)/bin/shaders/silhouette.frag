@@ -1,8 +1,13 @@
 # version 330 core
 
 uniform vec4 color;
+uniform bool colorByInstance; // para identificar la instancia (picking)
+flat in int instanceId;
 out vec4 fragColor;
 
 void main() {
-	fragColor = color;
+	if (colorByInstance) // el id en 24 bits, 8 por canal
+		fragColor = vec4(ivec3(instanceId,instanceId>>8,instanceId>>16)&255,255)/255.f;
+	else
+		fragColor = color;
 }
@@ -3,13 +3,23 @@
 in vec3 vertexPosition;
 in vec3 vertexNormal;
 
+// por instancia (ver InstanceBuffer)
+in mat4 instanceMatrix;
+in float instanceRotSpeed;
+
 uniform float outline_width;
+uniform float angle;
 uniform mat4 modelMatrix;
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
 
+flat out int instanceId;
+
 void main() {
-	mat4 vm = viewMatrix * modelMatrix;
+	float a = angle*instanceRotSpeed, c = cos(a), s = sin(a);
+	mat4 rot = mat4(c,0.f,-s,0.f, 0.f,1.f,0.f,0.f, s,0.f,c,0.f, 0.f,0.f,0.f,1.f);
+	mat4 vm = viewMatrix * modelMatrix * instanceMatrix * rot;
 	vec4 vmp = vm * vec4(vertexPosition+vertexNormal*outline_width,1.f);
 	gl_Position = projectionMatrix * vmp;
+	instanceId = gl_InstanceID;
 }
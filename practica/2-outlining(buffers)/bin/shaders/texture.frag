@@ -4,11 +4,13 @@ in vec3 fragNormal;
 in vec3 fragPosition;
 in vec2 fragTexCoords;
 in vec4 lightVSPosition;
+in vec3 fragColorVar;
+flat in float fragTexture;
 
 // propiedades del material
 uniform sampler2D colorTexture; // ambient and diffuse components
+uniform sampler2D alternativeTexture; // same, for the instances with fragTexture 1
 uniform vec3 ambientColor;
-uniform vec3 colorVar;
 uniform vec3 diffuseColor;
 uniform vec3 specularColor;
 uniform float shininess;
@@ -23,8 +25,9 @@ out vec4 fragColor;
 #include "funcs/calcPhong.frag"
 
 void main() {
-	vec4 tex = texture(colorTexture,fragTexCoords);
-	tex.rgb += colorVar;
+	vec4 tex = fragTexture>0.5 ? texture(alternativeTexture,fragTexCoords) 
+	                           : texture(colorTexture,fragTexCoords);
+	tex.rgb += fragColorVar;
 	vec3 phong = calcPhong(lightVSPosition, lightColor, ambientStrength,
 						   mix(ambientColor,ambientColor*vec3(tex),1.f),
 						   mix(diffuseColor,diffuseColor*vec3(tex),1.f),
@@ -4,22 +4,35 @@ in vec3 vertexPosition;
 in vec3 vertexNormal;
 in vec2 vertexTexCoords;
 
+// por instancia (ver InstanceBuffer)
+in mat4 instanceMatrix;
+in vec3 instanceColorVar;
+in float instanceRotSpeed;
+in float instanceTexture; // 0: colorTexture, 1: alternativeTexture
+
 uniform mat4 modelMatrix;
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
 uniform vec4 lightPosition;
+uniform float angle;
 
 out vec3 fragPosition;
 out vec3 fragNormal;
 out vec2 fragTexCoords;
 out vec4 lightVSPosition;
+out vec3 fragColorVar;
+flat out float fragTexture;
 
 void main() {
-	mat4 vm = viewMatrix * modelMatrix;
+	float a = angle*instanceRotSpeed, c = cos(a), s = sin(a);
+	mat4 rot = mat4(c,0.f,-s,0.f, 0.f,1.f,0.f,0.f, s,0.f,c,0.f, 0.f,0.f,0.f,1.f);
+	mat4 vm = viewMatrix * modelMatrix * instanceMatrix * rot;
 	vec4 vmp = vm * vec4(vertexPosition,1.f);
 	gl_Position = projectionMatrix * vmp;
 	fragPosition = vec3(vmp);
 	fragNormal = mat3(transpose(inverse(vm))) * vertexNormal;
 	lightVSPosition = viewMatrix * lightPosition;
 	fragTexCoords = vertexTexCoords;
+	fragColorVar = instanceColorVar;
+	fragTexture = instanceTexture;
 }
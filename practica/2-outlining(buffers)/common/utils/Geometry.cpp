@@ -60,6 +60,13 @@ void GeometryRenderer::draw() const {
 	glBindVertexArray(0);
 }
 
+void GeometryRenderer::drawInstanced(int instance_count) const {
+	glBindVertexArray(VAO);
+	if (EBO) glDrawElementsInstanced(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0, instance_count);
+	else glDrawArraysInstanced(GL_TRIANGLES, 0, count, instance_count);
+	glBindVertexArray(0);
+}
+
 void GeometryRenderer::freeResources() {
 	if (VAO==0) return;
 	if (VBO_pos) glDeleteBuffers(1,&VBO_pos);
@@ -88,6 +95,36 @@ void GeometryRenderer::updateElements(const std::vector<int> &ve, bool realloc,
 	updateBuffer(GL_ELEMENT_ARRAY_BUFFER,EBO,ve,realloc,dynamic);
 }
 
+InstanceBuffer::InstanceBuffer(InstanceBuffer &&other) {
+	*this = static_cast<const InstanceBuffer&>(other);
+	other = static_cast<const InstanceBuffer&>(InstanceBuffer());
+}
+
+InstanceBuffer &InstanceBuffer::operator=(InstanceBuffer &&other) {
+	if (VBO) glDeleteBuffers(1,&VBO);
+	*this = static_cast<const InstanceBuffer&>(other);
+	other = static_cast<const InstanceBuffer&>(InstanceBuffer());
+	return *this;
+}
+
+InstanceBuffer::~InstanceBuffer() {
+	if (VBO) glDeleteBuffers(1,&VBO);
+}
+
+void InstanceBuffer::addAttribute(const std::string &name, int floats, size_t offset) {
+	cg_assert((floats>=1 and floats<=4) or floats==16,"Wrong instance attribute size");
+	attributes.push_back({name,floats,offset});
+}
+
+void InstanceBuffer::update(const void *elements, size_t element_size, int count) {
+	if (VBO==0) glGenBuffers(1,&VBO);
+	glBindBuffer(GL_ARRAY_BUFFER,VBO);
+	// (a new store each time, so the driver doesn't wait for draws still using the old one)
+	glBufferData(GL_ARRAY_BUFFER,element_size*count,elements,GL_DYNAMIC_DRAW);
+	stride = element_size;
+	this->count = count;
+}
+
 void Geometry::generateNormals ( ) {
 	normals.clear();
 	normals.resize(positions.size());
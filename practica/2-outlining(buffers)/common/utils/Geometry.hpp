@@ -2,6 +2,7 @@
 #define GEOMETRY_HPP
 
 #include <vector>
+#include <string>
 #include <glad/glad.h>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
@@ -15,6 +16,37 @@ struct Geometry {
 	
 };
 
+// per-instance data for GeometryRenderer::drawInstanced: an array of any
+// struct, whose fields are read by the shader attributes described with
+// addAttribute (see Shader::setInstances); only floats, 1 to 4 of them, or
+// 16 for a mat4
+class InstanceBuffer {
+public:
+	InstanceBuffer() = default;
+	InstanceBuffer(InstanceBuffer &&other);
+	InstanceBuffer &operator=(InstanceBuffer &&other);
+	~InstanceBuffer();
+	
+	void addAttribute(const std::string &name, int floats, size_t offset);
+	template<typename T> void update(const std::vector<T> &elements) { 
+		update(elements.data(),sizeof(T),elements.size()); 
+	}
+	void update(const void *elements, size_t element_size, int count);
+	
+	struct Attribute { std::string name; int floats; size_t offset; };
+	const std::vector<Attribute> &getAttributes() const { return attributes; }
+	GLuint getBuffer() const { return VBO; }
+	GLsizei getStride() const { return stride; }
+	int size() const { return count; }
+private:
+	InstanceBuffer(const InstanceBuffer &) = delete;
+	InstanceBuffer &operator=(const InstanceBuffer &) = default;
+	std::vector<Attribute> attributes;
+	GLuint VBO = 0;
+	GLsizei stride = 0;
+	int count = 0;
+};
+
 class GeometryRenderer {
 public:
 	GeometryRenderer() = default;
@@ -22,6 +54,9 @@ public:
 	GeometryRenderer(GeometryRenderer &&geo);
 	GeometryRenderer &operator=(GeometryRenderer &&geo);
 	void draw() const;
+	// draws instance_count copies at once, the instance attributes must be
+	// set first with Shader::setInstances
+	void drawInstanced(int instance_count) const;
 	GLuint vertexArray() const { return VAO; }
 	GLuint positionsVBO() const { return VBO_pos; }
 	GLuint normalsVBO() const { return VBO_norms; }
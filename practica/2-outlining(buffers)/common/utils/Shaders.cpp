@@ -123,6 +123,7 @@ void Shader::setBuffers (const GeometryRenderer & geo) {
 		GLint loc_pos = glGetAttribLocation(program_id, "vertexPosition"); 
 		cg_assert(loc_pos!=-1,"Shader does not have vertexPosition attribute");
 		glVertexAttribPointer(loc_pos, 3, GL_FLOAT, GL_FALSE, 0, 0);
+		glVertexAttribDivisor(loc_pos, 0); // (the location could have had an instance attribute)
 		glEnableVertexAttribArray(loc_pos);
 	}
 	
@@ -131,6 +132,7 @@ void Shader::setBuffers (const GeometryRenderer & geo) {
 		cg_assert(geo.normalsVBO()!=0,"Geometry does not have normals");
 		glBindBuffer(GL_ARRAY_BUFFER,geo.normalsVBO());
 		glVertexAttribPointer(loc_norm, 3, GL_FLOAT, GL_FALSE, 0, 0);
+		glVertexAttribDivisor(loc_norm, 0);
 		glEnableVertexAttribArray(loc_norm);
 	}
 	
@@ -139,11 +141,28 @@ void Shader::setBuffers (const GeometryRenderer & geo) {
 		glBindBuffer(GL_ARRAY_BUFFER,geo.texCoordsVBO());
 		cg_assert(geo.texCoordsVBO()!=0,"Geometry does not have texture coordinates");
 		glVertexAttribPointer(loc_tc, 2, GL_FLOAT, GL_FALSE, 0, 0);
+		glVertexAttribDivisor(loc_tc, 0);
 		glEnableVertexAttribArray(loc_tc);
 	}
 	
 }
 
+void Shader::setInstances (const InstanceBuffer &instances) {
+	glBindBuffer(GL_ARRAY_BUFFER,instances.getBuffer());
+	for(const InstanceBuffer::Attribute &attrib : instances.getAttributes()) {
+		GLint loc = glGetAttribLocation(program_id, attrib.name.c_str());
+		if (loc==-1) continue;
+		// a mat4 takes 4 consecutive locations, one per column
+		int columns = attrib.floats==16 ? 4 : 1, rows = attrib.floats/columns;
+		for(int i=0;i<columns;++i) {
+			glVertexAttribPointer(loc+i, rows, GL_FLOAT, GL_FALSE, instances.getStride(),
+								  reinterpret_cast<void*>(attrib.offset+i*rows*sizeof(float)));
+			glVertexAttribDivisor(loc+i, 1);
+			glEnableVertexAttribArray(loc+i);
+		}
+	}
+}
+
 template<typename TFunc, typename... Ts>
 static bool setUniform_impl(TFunc glUniformAlgo, GLuint program_id, const char *name, const Ts &...vals) {
 	GLint pos = glGetUniformLocation(program_id, name); 
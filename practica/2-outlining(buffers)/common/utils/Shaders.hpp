@@ -20,6 +20,9 @@ public:
 	
 	bool setBuffer (const char *name, GLuint buffer_id, GLenum type, int size, bool required=true);
 	void setBuffers(const GeometryRenderer &geo);
+	// after setBuffers (the attributes are set in the geometry's VAO), for
+	// GeometryRenderer::drawInstanced; attributes the shader lacks are skipped
+	void setInstances(const InstanceBuffer &instances);
 	void setMaterial(const Material &mat);
 	void setMatrixes(const glm::mat4 &model, const glm::mat4 &view, const glm::mat4 &projection);
 	void setLight(const glm::vec4 &lightPosition, const glm::vec3 &lightColor, float ambientStrength);
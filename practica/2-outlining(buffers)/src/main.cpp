@@ -4,6 +4,7 @@
 #include <string>
 #include <random>
 #include <ctime>
+#include <cstddef>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -22,29 +23,35 @@ Window window;
 DrawBuffers draw_buffers;
 Model model;
 Texture alternative_texture;
-struct Instance {
+struct Instance { // (as read by the shaders, see initInstanceBuffers)
 	glm::mat4 matrix;
 	glm::vec3 color_var;
 	float rot_speed;
-	bool is_the_choosen_one;
+	float texture; // 1 for the choosen one (alternative_texture)
+	bool isTheChoosenOne() const { return texture!=0.f; }
 };
-std::vector<Instance> instances(256);
+std::vector<Instance> instances;
+InstanceBuffer instance_buffer, selection_buffer; // all of them, and just the selected one
 int selected_instance = -1;
+int instance_count = 0;
+const std::vector<std::string> vinstance_counts = { "256", "1024", "10000", "100000" };
 double time_to_find_the_one;
 Shader shader_texture, shader_silhouette;
 float angle_object = 0.f, outline_width  = 0.125f;
 int level = 1;
 const std::vector<std::string> vlevels = { "Easy", "Medium", "Hard" };
 
-void drawInstance(const Instance &instance, Shader &shader);
+void drawInstances(const InstanceBuffer &instances, Shader &shader);
 
 // extra callbacks
 void keyboardCallback(GLFWwindow* glfw_win, int key, int scancode, int action, int mods);
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 
+void initInstanceBuffers();
 void initInstances();
+void selectInstance(int i);
 
-void outlineInstance(const Instance &instance, glm::vec3 color_silhouette) {	
+void outlineInstance(glm::vec3 color_silhouette) {	
 	
 	// PART 1 DRAW THE SILHUETTE TO THE STENCIL BUFFER
 	
@@ -55,7 +62,7 @@ void outlineInstance(const Instance &instance, glm::vec3 color_silhouette) {
 	glStencilFunc(GL_ALWAYS,1,0xFFF);
 	glStencilOp(GL_KEEP,GL_KEEP,GL_REPLACE);
 	
-	drawInstance(instance,shader_texture);
+	drawInstances(selection_buffer,shader_texture);
 	
 	glDisable(GL_STENCIL_TEST);// STENCIL DRAWING END
 	glColorMask(GL_TRUE,GL_TRUE,GL_TRUE,GL_TRUE);
@@ -69,8 +76,9 @@ void outlineInstance(const Instance &instance, glm::vec3 color_silhouette) {
 	
 	shader_silhouette.use();
 	shader_silhouette.setUniform("outline_width",outline_width);
+	shader_silhouette.setUniform("colorByInstance",0);
 	shader_silhouette.setUniform("color",glm::vec4{color_silhouette,1.f});
-	drawInstance(instance,shader_silhouette); 
+	drawInstances(selection_buffer,shader_silhouette); 
 	
 	glStencilFunc(GL_EQUAL,0,0xFFF);
 	glStencilOp(GL_KEEP,GL_KEEP,GL_INCR);
@@ -79,7 +87,7 @@ void outlineInstance(const Instance &instance, glm::vec3 color_silhouette) {
 	shader_silhouette.use();
 	shader_silhouette.setUniform("outline_width",outline_width);
 	shader_silhouette.setUniform("color",glm::vec4{color_silhouette,0.2f});
-	drawInstance(instance,shader_silhouette); 
+	drawInstances(selection_buffer,shader_silhouette); 
 	
 	glEnable(GL_DEPTH_TEST);
 	glDisable(GL_STENCIL_TEST);// STENCIL DRAWING END
@@ -100,6 +108,7 @@ int main() {
 	// load model and init instances
 	model = Model::loadSingle("chookity");
 	alternative_texture = Texture("models/choosen.png",0);
+	initInstanceBuffers();
 	initInstances();
 	
 	// main loop
@@ -116,16 +125,16 @@ int main() {
 		
 		// auto-rotate
 		double dt = ftime.newFrame();
-		if (selected_instance==-1 or (not instances[selected_instance].is_the_choosen_one))
+		if (selected_instance==-1 or (not instances[selected_instance].isTheChoosenOne()))
 			time_to_find_the_one += dt;
 		angle_object += static_cast<float>(1.f*dt*level);
 		
-		for(auto &inst: instances)
-			drawInstance(inst,shader_texture);
+		// all the instances in a single draw call
+		drawInstances(instance_buffer,shader_texture);
 		
 		if (selected_instance!=-1) {
-			float s = instances[selected_instance].is_the_choosen_one ? 1.f : 0.f;
-			outlineInstance(instances[selected_instance],{1.f-s,s,0.f});
+			float s = instances[selected_instance].isTheChoosenOne() ? 1.f : 0.f;
+			outlineInstance({1.f-s,s,0.f});
 		}
 		
 		draw_buffers.draw(win_width,win_height);
@@ -134,6 +143,8 @@ int main() {
 		window.ImGuiDialog("Find The Choosen One!",[&](){
 			ImGui::LabelText("","Time: %.3f s",time_to_find_the_one);
 			ImGui::Combo("Level (L)", &level, vlevels);
+			if (ImGui::Combo("Instances", &instance_count, vinstance_counts)) initInstances();
+			ImGui::LabelText("","Frame: %.2f ms (%i fps)",dt*1000.0,ftime.getFrameRate());
 			if (ImGui::Button("Restart (R)")) initInstances();
 			ImGui::SliderFloat("outline width",&outline_width,.05,.5);
 			draw_buffers.addImGuiSettings(window);
@@ -161,18 +172,10 @@ int findSelection(int x, int y) {
 	glDisable(GL_MULTISAMPLE);
 	glClearColor(1.f,1.f,1.f,1.f);
 	glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
-	glm::mat4 mrot = glm::rotate(glm::mat4{1.f},angle_object,{0.f,1.f,0.f});
 	shader_silhouette.use();
 	shader_silhouette.setUniform("outline_width",0.f);
-	glm::vec3 color_silhouette(1.f,0.f,0.f);
-	for(size_t i=0;i<instances.size();++i) { 
-		const auto &mat = instances[i].matrix;
-		float r = (i%256)/255.f;
-		float g = ((i/256)%256)/255.f;
-		float b = ((i/256/256)%256)/255.f;
-		shader_silhouette.setUniform("color",glm::vec4{r,g,b,1.f});
-		drawInstance(instances[i],shader_silhouette);
-	}
+	shader_silhouette.setUniform("colorByInstance",1); // the shader encodes gl_InstanceID in rgb
+	drawInstances(instance_buffer,shader_silhouette);
 	glFlush();
 	glFinish();
 	glReadBuffer(GL_BACK);
@@ -200,33 +203,52 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
 	if (isDoubleClick(button,action)) {
 		double xpos, ypos;
 		glfwGetCursorPos(window, &xpos, &ypos);
-		selected_instance = findSelection(int(xpos),win_height-int(ypos));
-		if (selected_instance!=-1 and (not instances[selected_instance].is_the_choosen_one))
+		selectInstance(findSelection(int(xpos),win_height-int(ypos)));
+		if (selected_instance!=-1 and (not instances[selected_instance].isTheChoosenOne()))
 			time_to_find_the_one += level+1;
 	}
 }
 
-void drawInstance(const Instance &instance, Shader &shader) {
+void drawInstances(const InstanceBuffer &instances, Shader &shader) {
 	shader.use();
 	
+	// each instance's matrix and rotation are applied in the vertex shader
 	auto mats = common_callbacks::getMatrixes();
-	glm::mat4 mrot = glm::rotate(glm::mat4{1.f},angle_object*instance.rot_speed,{0.f,1.f,0.f});
-	shader.setMatrixes(mats[0]*instance.matrix*mrot,mats[1],mats[2]);
+	shader.setMatrixes(mats[0],mats[1],mats[2]);
+	shader.setUniform("angle",angle_object);
 	
 	// setup light and material
 	shader.setLight({-5.0,5.f,5.f,1.f}, glm::vec3{1.f,1.f,1.f}, 0.4f);
 	shader.setMaterial(model.material);
-	shader.setUniform("colorVar",instance.color_var);
-	(instance.is_the_choosen_one ? alternative_texture : model.texture).bind();
+	alternative_texture.bind(1);
+	model.texture.bind(0); // (last, so unit 0 stays active)
+	shader.setUniform("alternativeTexture",1);
 	
 	// send geometry
 	shader.setBuffers(model.buffers);
-	model.buffers.draw();
+	shader.setInstances(instances);
+	model.buffers.drawInstanced(instances.size());
+}
+
+void initInstanceBuffers() {
+	for(InstanceBuffer *buffer : {&instance_buffer,&selection_buffer}) {
+		buffer->addAttribute("instanceMatrix",16,offsetof(Instance,matrix));
+		buffer->addAttribute("instanceColorVar",3,offsetof(Instance,color_var));
+		buffer->addAttribute("instanceRotSpeed",1,offsetof(Instance,rot_speed));
+		buffer->addAttribute("instanceTexture",1,offsetof(Instance,texture));
+	}
+}
+
+void selectInstance(int i) {
+	selected_instance = i;
+	if (i!=-1) selection_buffer.update(instances.data()+i,sizeof(Instance),1);
 }
 
 void initInstances() {
 	time_to_find_the_one = 0.0;
-	selected_instance = -1;
+	selectInstance(-1);
+	instances.resize(std::stoi(vinstance_counts[instance_count]));
+	float spread = std::sqrt(instances.size()/256.f); // (so there are as many per unit of area)
 	std::srand(std::time(0));
 	int choosen_one = rand()%instances.size()*.7;
 	for(size_t i=0;i<instances.size();++i) {
@@ -238,9 +260,9 @@ void initInstances() {
 		};
 		constexpr float PI = 3.14159265359;
 		constexpr float GR = 1.61803398875;
-		inst.is_the_choosen_one = i == choosen_one;
+		inst.texture = i == choosen_one ? 1.f : 0.f;
 		auto mat = glm::mat4{1.f};
-		float dist = 0.15f+3.f*std::pow(float(i)/instances.size(),0.6f), ang = i*2*PI*GR;
+		float dist = 0.15f+3.f*spread*std::pow(float(i)/instances.size(),0.6f), ang = i*2*PI*GR;
 		mat = glm::translate(mat ,glm::vec3{std::sin(ang),0,std::cos(ang)}*dist);
 		mat = glm::scale(mat ,glm::vec3{1.f+rndf(.1f),1.f+rndf(.1f),1.f+rndf(.1f)}*.25f);
 		mat = glm::rotate(mat ,rndf(3.14f),{rndf(.20f),1.f,rndf(.20f)});
@@ -249,4 +271,5 @@ void initInstances() {
 		if (rand()%2) inst.rot_speed *= -1.f;
 		inst.color_var = {rndf(.1f),rndf(.1f),rndf(.1f)};
 	}
+	instance_buffer.update(instances);
 }
@@ -14,12 +14,14 @@ out vec3 fragNormal;
 out vec2 fragTexCoords;
 out vec4 lightVSPosition;
 
+#include "funcs/decodeVertex.vert"
+
 void main() {
 	mat4 vm = viewMatrix * modelMatrix;
-	vec4 vmp = vm * vec4(vertexPosition,1.f);
+	vec4 vmp = vm * vec4(decodePosition(vertexPosition),1.f);
 	gl_Position = projectionMatrix * vmp;
 	fragPosition = vec3(vmp);
-	fragNormal = mat3(transpose(inverse(vm))) * vertexNormal;
+	fragNormal = mat3(transpose(inverse(vm))) * decodeNormal(vertexNormal);
 	lightVSPosition = viewMatrix * lightPosition;
 	fragTexCoords = vertexTexCoords;
 }
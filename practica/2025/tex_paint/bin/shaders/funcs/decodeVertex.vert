@@ -0,0 +1,19 @@
+// attributes of a quantized GeometryRenderer (set by Shader::setBuffers):
+// positions are unorms relative to the bounding box, and normals come
+// octahedral-encoded in xy (texture coordinates need no decoding)
+uniform bool quantizedVertex;
+uniform vec3 positionsOffset;
+uniform vec3 positionsScale;
+
+vec3 decodePosition(vec3 p) {
+	return quantizedVertex ? positionsOffset + p*positionsScale : p;
+}
+
+vec3 decodeNormal(vec3 n) {
+	if (!quantizedVertex) return n;
+	n = vec3(n.xy, 1.f-abs(n.x)-abs(n.y));
+	float t = max(-n.z,0.f);
+	n.x += n.x>=0.f ? -t : t;
+	n.y += n.y>=0.f ? -t : t;
+	return normalize(n);
+}
@@ -5,7 +5,9 @@ in vec2 vertexTexCoords;
 
 out vec2 fragTexCoords;
 
+#include "funcs/decodeVertex.vert"
+
 void main() {
-	gl_Position = vec4(vertexPosition,1.f);
+	gl_Position = vec4(decodePosition(vertexPosition),1.f);
 	fragTexCoords = vertexTexCoords;
 }
@@ -0,0 +1,260 @@
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+#include "Archive.hpp"
+#include "MappedFile.hpp"
+#include "Debug.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// file layout: FileHeader, then entries_count times (EntryHeader + path,
+// padded so the next header stays aligned), then the data of every file, each one aligned to 16 bytes (so the arrays
+// in a .cgmesh or .glb can still be used in place)
+
+struct FileHeader {
+	char magic[8];
+	uint32_t version, entries_count;
+};
+
+struct EntryHeader {
+	uint64_t offset, size, stored_size; // stored_size<size if compressed
+	int64_t mtime;
+	uint32_t path_length, padding;
+};
+
+const char archive_magic[8] = { 'C','G','P','A','C','K','\0','\0' };
+
+size_t padded(size_t n, size_t alignment=alignof(EntryHeader)) { return (n+alignment-1)/alignment*alignment; }
+
+// lz4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md):
+// sequences of a token (literals count:4 | match length-4:4), extra length
+// bytes, the literals, a 2-byte offset and extra match length bytes; the
+// last sequence has only literals
+
+std::vector<char> lz4Compress(const char *src, size_t size) {
+	constexpr size_t min_match = 4, last_literals = 5, match_find_limit = 12;
+	std::vector<char> out;
+	out.reserve(size+size/255+16);
+	auto writeLength = [&](size_t length) {
+		for(; length>=255; length-=255) out.push_back(char(255));
+		out.push_back(char(length));
+	};
+	auto writeSequence = [&](size_t anchor, size_t literals, size_t match_length, size_t offset) {
+		size_t ml = match_length ? match_length-min_match : 0;
+		out.push_back(char((std::min<size_t>(literals,15)<<4)|std::min<size_t>(ml,15)));
+		if (literals>=15) writeLength(literals-15);
+		out.insert(out.end(),src+anchor,src+anchor+literals);
+		if (not match_length) return;
+		out.push_back(char(offset&0xff));
+		out.push_back(char(offset>>8));
+		if (ml>=15) writeLength(ml-15);
+	};
+
+	// greedy: the last position where each hash of 4 bytes was seen
+	std::vector<uint32_t> table(1<<16,UINT32_MAX);
+	auto hash = [](uint32_t v) { return (v*2654435761u)>>16; };
+	size_t anchor = 0;
+	for(size_t i=0; i+match_find_limit<=size; ) {
+		uint32_t v, cv;
+		std::memcpy(&v,src+i,4);
+		uint32_t candidate = table[hash(v)];
+		table[hash(v)] = i;
+		if (candidate!=UINT32_MAX and i-candidate<=0xffff
+			and (std::memcpy(&cv,src+candidate,4),cv==v))
+		{
+			size_t length = min_match;
+			while (i+length<size-last_literals and src[candidate+length]==src[i+length]) ++length;
+			writeSequence(anchor,i-anchor,length,i-candidate);
+			i += length;
+			anchor = i;
+		} else
+			++i;
+	}
+	writeSequence(anchor,size-anchor,0,0);
+	return out;
+}
+
+bool lz4Decompress(const char *src, size_t src_size, char *dst, size_t dst_size) {
+	auto in = reinterpret_cast<const unsigned char*>(src), in_end = in+src_size;
+	auto readLength = [&](size_t length) {
+		if (length!=15) return length;
+		for(unsigned char b=255; b==255 and in<in_end; length+=b) b = *in++;
+		return length;
+	};
+	size_t o = 0;
+	while (in<in_end) {
+		unsigned token = *in++;
+		size_t literals = readLength(token>>4);
+		if (literals>size_t(in_end-in) or literals>dst_size-o) return false;
+		std::memcpy(dst+o,in,literals);
+		in += literals; o += literals;
+		if (in==in_end) break; // the last sequence has no match
+		if (in_end-in<2) return false;
+		size_t offset = in[0]|(in[1]<<8);
+		in += 2;
+		size_t length = readLength(token&15)+4;
+		if (offset==0 or offset>o or length>dst_size-o) return false;
+		if (offset>=length) std::memcpy(dst+o,dst+o-offset,length);
+		else for(size_t i=0;i<length;++i) dst[o+i] = dst[o+i-offset]; // overlapping
+		o += length;
+	}
+	return o==dst_size;
+}
+
+struct Entry {
+	const EntryHeader *header;
+	std::unique_ptr<char[]> decompressed;
+};
+
+struct MountedArchive {
+	MappedFile file;
+	std::unordered_map<std::string,Entry> entries;
+	std::mutex mutex; // for decompressing on demand from several threads
+};
+
+std::unique_ptr<MountedArchive> mounted;
+
+std::string normalize(const std::string &path) {
+	return fs::path(path).lexically_normal().generic_string();
+}
+
+}
+
+bool Archive::mount(const std::string &archive_path) {
+	unmount();
+	auto archive = std::make_unique<MountedArchive>();
+	archive->file = MappedFile(archive_path);
+	const MappedFile &file = archive->file;
+	if (not file.isOk() or file.size()<sizeof(FileHeader)) return false;
+
+	auto header = reinterpret_cast<const FileHeader*>(file.data());
+	if (std::memcmp(header->magic,archive_magic,sizeof(archive_magic))!=0
+		or header->version!=version) return false;
+	size_t pos = sizeof(FileHeader);
+	static_assert(sizeof(FileHeader)%alignof(EntryHeader)==0,"Misaligned archive entries");
+	for(uint32_t i=0;i<header->entries_count;++i) {
+		if (pos+sizeof(EntryHeader)>file.size()) return false;
+		auto entry = reinterpret_cast<const EntryHeader*>(file.data()+pos);
+		pos += sizeof(EntryHeader);
+		if (pos+entry->path_length>file.size() or entry->offset>file.size()
+			or entry->stored_size>file.size()-entry->offset) return false;
+		std::string path(file.data()+pos,entry->path_length);
+		pos += padded(entry->path_length);
+		archive->entries[path] = Entry{entry,nullptr};
+	}
+	mounted = std::move(archive);
+	cg_info("Using archive: "+archive_path);
+	return true;
+}
+
+void Archive::unmount() {
+	mounted.reset();
+}
+
+bool Archive::isMounted() {
+	return mounted!=nullptr;
+}
+
+bool Archive::find(const std::string &path, std::string_view &contents) {
+	if (not mounted) return false;
+	auto it = mounted->entries.find(normalize(path));
+	if (it==mounted->entries.end()) return false;
+	Entry &entry = it->second;
+	const EntryHeader &header = *entry.header;
+	const char *stored = mounted->file.data()+header.offset;
+	if (header.stored_size==header.size) {
+		contents = {stored,header.size};
+		return true;
+	}
+	std::lock_guard<std::mutex> lock(mounted->mutex);
+	if (not entry.decompressed) {
+		auto data = std::make_unique<char[]>(header.size);
+		cg_assert(lz4Decompress(stored,header.stored_size,data.get(),header.size),
+				  "Corrupted file in archive: "+path);
+		entry.decompressed = std::move(data);
+	}
+	contents = {entry.decompressed.get(),header.size};
+	return true;
+}
+
+bool Archive::getFileStats(const std::string &path, uint64_t &size, int64_t &mtime) {
+	if (not mounted) return false;
+	auto it = mounted->entries.find(normalize(path));
+	if (it==mounted->entries.end()) return false;
+	size = it->second.header->size;
+	mtime = it->second.header->mtime;
+	return true;
+}
+
+bool Archive::write(const std::string &folder, const std::string &archive_path, bool compress) {
+	std::error_code ec, ec_eq;
+	std::string tmp_path = archive_path+".tmp";
+	std::vector<fs::path> files;
+	for(const auto &entry : fs::recursive_directory_iterator(folder,ec))
+		if (entry.is_regular_file() and not fs::equivalent(entry.path(),archive_path,ec_eq)
+			and not fs::equivalent(entry.path(),tmp_path,ec_eq))
+			files.push_back(entry.path());
+	if (ec) return false;
+	std::sort(files.begin(),files.end()); // so the same folder gives the same archive
+
+	struct Packed { std::string path; std::vector<char> data; EntryHeader header; };
+	std::vector<Packed> packed(files.size());
+	size_t offset = sizeof(FileHeader);
+	for(size_t i=0;i<files.size();++i) {
+		Packed &p = packed[i];
+		p.path = fs::relative(files[i],folder,ec).lexically_normal().generic_string();
+		// not through MappedFile, that could find it in a mounted archive
+		std::ifstream fin(files[i],std::ios::binary);
+		std::vector<char> contents((std::istreambuf_iterator<char>(fin)),std::istreambuf_iterator<char>());
+		if (ec or not fin.is_open()) return false;
+		p.header = EntryHeader{};
+		p.header.size = contents.size();
+		p.header.mtime = fs::last_write_time(files[i],ec).time_since_epoch().count();
+		p.header.path_length = p.path.size();
+		if (compress) p.data = lz4Compress(contents.data(),contents.size());
+		if (not compress or p.data.size()>contents.size()-contents.size()/10)
+			p.data = std::move(contents);
+		p.header.stored_size = p.data.size();
+		offset += sizeof(EntryHeader)+padded(p.path.size());
+	}
+	for(Packed &p : packed) {
+		offset = padded(offset,16);
+		p.header.offset = offset;
+		offset += p.data.size();
+	}
+
+	std::ofstream fout(tmp_path,std::ios::binary|std::ios::trunc);
+	if (not fout.is_open()) return false;
+	static const char zeros[16] = {};
+	FileHeader header;
+	std::memcpy(header.magic,archive_magic,sizeof(archive_magic));
+	header.version = version;
+	header.entries_count = packed.size();
+	fout.write(reinterpret_cast<const char*>(&header),sizeof(header));
+	for(const Packed &p : packed) {
+		fout.write(reinterpret_cast<const char*>(&p.header),sizeof(p.header));
+		fout.write(p.path.data(),p.path.size());
+		fout.write(zeros,padded(p.path.size())-p.path.size());
+	}
+	for(const Packed &p : packed) {
+		fout.write(zeros,p.header.offset-size_t(fout.tellp()));
+		fout.write(p.data.data(),p.data.size());
+	}
+	bool ok = static_cast<bool>(fout);
+	fout.close();
+
+	// write+rename, so a running instance never maps a half-written archive
+	if (ok) fs::rename(tmp_path,archive_path,ec);
+	if (not ok or ec) { fs::remove(tmp_path,ec); return false; }
+	cg_info("Archive written: "+archive_path);
+	return true;
+}
+
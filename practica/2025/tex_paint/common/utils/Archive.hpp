@@ -0,0 +1,37 @@
+#ifndef ARCHIVE_HPP
+#define ARCHIVE_HPP
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// single indexed file that bundles every file of a folder (usually a
+// practica's bin/), each one optionally lz4-compressed; while an archive is
+// mounted, MappedFile looks paths up in it before going to the disk, so the
+// obj, mtl, glb, shader and image loaders read from it transparently; paths
+// are relative to the packed folder (as the loaders get them when running
+// from it), and anything not found in the archive is still read from disk;
+// mount and unmount must not be called while something is being loaded
+class Archive {
+public:
+	static constexpr uint32_t version = 2;
+
+	// maps the archive (replacing the one that was mounted, if any); returns
+	// false, leaving nothing mounted, if it is missing or invalid
+	static bool mount(const std::string &archive_path);
+	static void unmount();
+	static bool isMounted();
+
+	// sets contents to the file's data (that lives until unmount: it points
+	// into the mapped archive, or to a buffer decompressed on the first
+	// access); returns false if path is not in the archive
+	static bool find(const std::string &path, std::string_view &contents);
+	// size and modification time that the file had when it was packed
+	static bool getFileStats(const std::string &path, uint64_t &size, int64_t &mtime);
+
+	// packs every file under folder in archive_path; with compress, files
+	// are stored lz4-compressed when that saves at least 10%
+	static bool write(const std::string &folder, const std::string &archive_path, bool compress=true);
+};
+
+#endif
+
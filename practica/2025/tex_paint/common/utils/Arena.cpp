@@ -0,0 +1,47 @@
+#include <new>
+#include <cstdint>
+#include <algorithm>
+#include "Arena.hpp"
+
+void *Arena::do_allocate(size_t bytes, size_t alignment) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	++m_allocations;
+	m_bytes_used += bytes;
+	auto align = [alignment](char *p) {
+		auto addr = reinterpret_cast<uintptr_t>(p);
+		return p+((alignment-addr%alignment)%alignment);
+	};
+	char *p = m_next ? align(m_next) : nullptr;
+	if (not p or p+bytes>m_end) { // a new block, big enough for this one
+		size_t size = std::max(m_block_size,bytes+alignment);
+		char *data = static_cast<char*>(::operator new(size));
+		m_blocks.push_back({data,size});
+		m_end = data+size;
+		p = align(data);
+	}
+	m_next = p+bytes;
+	return p;
+}
+
+void Arena::reset() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_allocations = m_bytes_used = 0;
+	if (m_blocks.empty()) return;
+	auto largest = std::max_element(m_blocks.begin(),m_blocks.end(),
+									[](const Block &a, const Block &b) { return a.size<b.size; });
+	Block keep = *largest;
+	m_blocks.erase(largest);
+	for(Block &b : m_blocks) 
+		::operator delete(b.data);
+	m_blocks.assign(1,keep);
+	m_next = keep.data;
+	m_end = keep.data+keep.size;
+}
+
+void Arena::release() {
+	for(Block &b : m_blocks) 
+		::operator delete(b.data);
+	m_blocks.clear();
+	m_next = m_end = nullptr;
+}
+
@@ -0,0 +1,48 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+#include <vector>
+#include <mutex>
+#include <memory_resource>
+
+// bump allocator for temporary data (such as what a loader needs while 
+// building a mesh): allocating just advances a pointer inside big blocks,
+// deallocating does nothing, and reset() releases everything at once;
+// it's a pmr memory_resource, so it can back any std::pmr container, and 
+// it can be shared by several threads (allocations are rare, since the
+// containers grow geometrically, so they just take a lock)
+class Arena : public std::pmr::memory_resource {
+public:
+	explicit Arena(size_t block_size = 1<<20) : m_block_size(block_size) {}
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+	~Arena() { release(); }
+	
+	// frees every allocation, but keeps the largest block for reuse
+	void reset();
+	
+	size_t getAllocationsCount() const { return m_allocations; }
+	size_t getBytesUsed() const { return m_bytes_used; }
+	size_t getBlocksCount() const { return m_blocks.size(); }
+	
+private:
+	void *do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void *, size_t, size_t) override { }
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+		return this==&other;
+	}
+	void release();
+	
+	struct Block { char *data; size_t size; };
+	std::vector<Block> m_blocks;
+	char *m_next = nullptr, *m_end = nullptr;
+	size_t m_block_size, m_allocations = 0, m_bytes_used = 0;
+	std::mutex m_mutex;
+};
+
+// the arena if there is one, the default (heap) resource otherwise
+inline std::pmr::memory_resource *getResource(Arena *arena) {
+	return arena ? static_cast<std::pmr::memory_resource*>(arena) : std::pmr::get_default_resource();
+}
+
+#endif
+
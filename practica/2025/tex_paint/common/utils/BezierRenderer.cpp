@@ -1,5 +1,6 @@
 #include "BezierRenderer.hpp"
 #include "Debug.hpp"
+#include "GpuMemory.hpp"
 
 BezierRenderer::BezierRenderer(int nsamples) : shader("shaders/curve") { 
 	glGenVertexArrays(1, &VAO);
@@ -12,11 +13,14 @@ BezierRenderer::BezierRenderer(int nsamples) : shader("shaders/curve") {
 	glBufferData(GL_ARRAY_BUFFER, v_curve.size() * sizeof(glm::vec3), v_curve.data(), GL_DYNAMIC_DRAW);  
 	glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
 	glBufferData(GL_ARRAY_BUFFER, 4*sizeof(glm::vec3), v_poly.data(), GL_DYNAMIC_DRAW);  
+	GpuMemory::track(GpuMemory::cBuffer,VBO[0],"BezierRenderer",v_curve.size()*sizeof(glm::vec3));
+	GpuMemory::track(GpuMemory::cBuffer,VBO[1],"BezierRenderer",4*sizeof(glm::vec3));
 }
 
 BezierRenderer::~BezierRenderer() {
 	glDeleteBuffers(2,VBO);
 	glDeleteVertexArrays(1,&VAO);
+	for(GLuint id : VBO) GpuMemory::release(GpuMemory::cBuffer,id);
 }
 
 Shader &BezierRenderer::getShader() {
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include "Bvh.hpp"
+
+namespace {
+
+struct Box {
+	glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+	void grow(const glm::vec3 &p) { min = glm::min(min,p); max = glm::max(max,p); }
+	void grow(const Box &b) { min = glm::min(min,b.min); max = glm::max(max,b.max); }
+	float area() const {
+		glm::vec3 d = max-min;
+		return d.x<0.f ? 0.f : d.x*d.y+d.y*d.z+d.z*d.x; // (half of it, only compared)
+	}
+};
+
+constexpr int bin_count = 16;
+constexpr int max_depth = 60; // (so queries' stacks have a fixed size)
+constexpr int min_parallel_triangles = 4096; // (smaller subtrees aren't worth a thread)
+
+// distance along the ray to where it enters the box, or infinity if it
+// misses it (or enters it after max_distance)
+float rayBox(const glm::vec3 &origin, const glm::vec3 &inv_direction,
+			 const glm::vec3 &box_min, const glm::vec3 &box_max, float max_distance)
+{
+	glm::vec3 t0 = (box_min-origin)*inv_direction, t1 = (box_max-origin)*inv_direction;
+	glm::vec3 near = glm::min(t0,t1), far = glm::max(t0,t1);
+	float enter = std::max(std::max(near.x,near.y),std::max(near.z,0.f));
+	float exit = std::min(std::min(far.x,far.y),std::min(far.z,max_distance));
+	return enter<=exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+float boxDistance2(const glm::vec3 &p, const glm::vec3 &box_min, const glm::vec3 &box_max) {
+	glm::vec3 d = glm::max(glm::max(box_min-p,p-box_max),glm::vec3(0.f));
+	return glm::dot(d,d);
+}
+
+// Möller-Trumbore, for both faces
+bool rayTriangle(const glm::vec3 &origin, const glm::vec3 &direction, const glm::vec3 *p, float &t, float &u, float &v) {
+	glm::vec3 e1 = p[1]-p[0], e2 = p[2]-p[0], pv = glm::cross(direction,e2);
+	float det = glm::dot(e1,pv);
+	if (det==0.f) return false;
+	float inv_det = 1.f/det;
+	glm::vec3 tv = origin-p[0];
+	u = glm::dot(tv,pv)*inv_det;
+	if (u<0.f or u>1.f) return false;
+	glm::vec3 qv = glm::cross(tv,e1);
+	v = glm::dot(direction,qv)*inv_det;
+	if (v<0.f or u+v>1.f) return false;
+	t = glm::dot(e2,qv)*inv_det;
+	return true;
+}
+
+// by regions of the triangle's plane (Ericson, Real-Time Collision Detection)
+glm::vec3 closestOnTriangle(const glm::vec3 &p, const glm::vec3 *t, glm::vec3 &barycentric) {
+	const glm::vec3 &a = t[0], &b = t[1], &c = t[2];
+	glm::vec3 ab = b-a, ac = c-a, ap = p-a;
+	float d1 = glm::dot(ab,ap), d2 = glm::dot(ac,ap);
+	if (d1<=0.f and d2<=0.f) { barycentric = {1.f,0.f,0.f}; return a; }
+	glm::vec3 bp = p-b;
+	float d3 = glm::dot(ab,bp), d4 = glm::dot(ac,bp);
+	if (d3>=0.f and d4<=d3) { barycentric = {0.f,1.f,0.f}; return b; }
+	float vc = d1*d4-d3*d2;
+	if (vc<=0.f and d1>=0.f and d3<=0.f) {
+		float v = d1/(d1-d3);
+		barycentric = {1.f-v,v,0.f}; return a+v*ab;
+	}
+	glm::vec3 cp = p-c;
+	float d5 = glm::dot(ab,cp), d6 = glm::dot(ac,cp);
+	if (d6>=0.f and d5<=d6) { barycentric = {0.f,0.f,1.f}; return c; }
+	float vb = d5*d2-d1*d6;
+	if (vb<=0.f and d2>=0.f and d6<=0.f) {
+		float w = d2/(d2-d6);
+		barycentric = {1.f-w,0.f,w}; return a+w*ac;
+	}
+	float va = d3*d6-d5*d4;
+	if (va<=0.f and d4-d3>=0.f and d5-d6>=0.f) {
+		float w = (d4-d3)/((d4-d3)+(d5-d6));
+		barycentric = {0.f,1.f-w,w}; return b+w*(c-b);
+	}
+	float sum = va+vb+vc;
+	if (sum<=0.f) { barycentric = {1.f,0.f,0.f}; return a; } // (degenerate)
+	float v = vb/sum, w = vc/sum;
+	barycentric = {1.f-v-w,v,w};
+	return a+v*ab+w*ac;
+}
+
+// separating axis test (Akenine-Möller): the box's axes, the triangle's
+// normal, and the cross products of their edges
+bool triangleBox(const glm::vec3 *t, const glm::vec3 &center, const glm::vec3 &half) {
+	glm::vec3 v[3] = { t[0]-center, t[1]-center, t[2]-center };
+	auto separates = [&](const glm::vec3 &axis) {
+		float p0 = glm::dot(v[0],axis), p1 = glm::dot(v[1],axis), p2 = glm::dot(v[2],axis);
+		float r = glm::dot(half,glm::abs(axis));
+		return std::max({p0,p1,p2})<-r or std::min({p0,p1,p2})>r;
+	};
+	glm::vec3 edges[3] = { v[1]-v[0], v[2]-v[1], v[0]-v[2] };
+	for(int i=0;i<3;++i) {
+		glm::vec3 axis(0.f); axis[i] = 1.f;
+		if (separates(axis)) return false;
+		for(int j=0;j<3;++j)
+			if (separates(glm::cross(axis,edges[j]))) return false;
+	}
+	return not separates(glm::cross(edges[0],edges[1]));
+}
+
+}
+
+// splits a range of m_order (triangle indexes, that it reorders) in nodes
+class BvhBuilder {
+public:
+	BvhBuilder(const std::vector<Box> &boxes, const std::vector<glm::vec3> &centroids,
+			   std::vector<int> &order, int max_leaf_triangles)
+		: m_boxes(boxes), m_centroids(centroids), m_order(order), m_max_leaf(max_leaf_triangles) { }
+	void build(int first, int count, int depth, int parallel_depth, std::vector<Bvh::Node> &nodes);
+private:
+	const std::vector<Box> &m_boxes;
+	const std::vector<glm::vec3> &m_centroids;
+	std::vector<int> &m_order;
+	int m_max_leaf;
+};
+
+void BvhBuilder::build(int first, int count, int depth, int parallel_depth, std::vector<Bvh::Node> &nodes) {
+	int index = nodes.size();
+	nodes.emplace_back();
+	Box box, centers;
+	for(int i=first;i<first+count;++i) {
+		box.grow(m_boxes[m_order[i]]);
+		centers.grow(m_centroids[m_order[i]]);
+	}
+	nodes[index].box_min = box.min;
+	nodes[index].box_max = box.max;
+	if (count<=m_max_leaf or depth==max_depth) {
+		nodes[index].first = first;
+		nodes[index].count = count;
+		return;
+	}
+
+	// the split (between bins of an axis) with the lowest area*triangles
+	// at both sides
+	glm::vec3 extent = centers.max-centers.min;
+	int axis = -1, split = 0;
+	float best_cost = std::numeric_limits<float>::max();
+	// (axes too thin to split, where the scale would overflow, are skipped)
+	float scale[3];
+	for(int a=0;a<3;++a) {
+		scale[a] = extent[a]>std::numeric_limits<float>::epsilon() ? bin_count/extent[a] : 0.f;
+		if (not std::isfinite(scale[a])) scale[a] = 0.f;
+	}
+	auto binOf = [&](int t, int a) {
+		int b = (m_centroids[t][a]-centers.min[a])*scale[a];
+		return std::max(0,std::min(b,bin_count-1));
+	};
+	for(int a=0;a<3;++a) {
+		if (scale[a]==0.f) continue;
+		Box bins[bin_count];
+		int counts[bin_count] = {0};
+		for(int i=first;i<first+count;++i) {
+			int b = binOf(m_order[i],a);
+			bins[b].grow(m_boxes[m_order[i]]);
+			++counts[b];
+		}
+		float right_area[bin_count]; int right_count[bin_count];
+		Box right; int n = 0;
+		for(int b=bin_count-1;b>0;--b) {
+			right.grow(bins[b]); n += counts[b];
+			right_area[b] = right.area(); right_count[b] = n;
+		}
+		Box left; n = 0;
+		for(int b=1;b<bin_count;++b) { // (b is the first bin at the right)
+			left.grow(bins[b-1]); n += counts[b-1];
+			if (n==0 or right_count[b]==0) continue;
+			float cost = left.area()*n+right_area[b]*right_count[b];
+			if (cost<best_cost) { best_cost = cost; axis = a; split = b; }
+		}
+	}
+	int mid = first+count/2; // (if no axis could be split)
+	if (axis!=-1)
+		mid = std::partition(m_order.begin()+first,m_order.begin()+first+count,
+							 [&](int t) { return binOf(t,axis)<split; }) - m_order.begin();
+
+	// the first child right after this node, the second one after the
+	// first one's subtree (built by another thread into its own vector,
+	// and then moved, near the root)
+	if (parallel_depth>0 and count>=min_parallel_triangles) {
+		std::vector<Bvh::Node> second;
+		std::thread worker([&]() { build(mid,first+count-mid,depth+1,parallel_depth-1,second); });
+		build(first,mid-first,depth+1,parallel_depth-1,nodes);
+		worker.join();
+		int offset = nodes.size();
+		for(Bvh::Node &n : second)
+			if (n.count==0) n.first += offset;
+		nodes.insert(nodes.end(),second.begin(),second.end());
+		nodes[index].first = offset;
+	} else {
+		build(first,mid-first,depth+1,0,nodes);
+		nodes[index].first = nodes.size();
+		build(mid,first+count-mid,depth+1,0,nodes);
+	}
+	nodes[index].count = 0;
+}
+
+Bvh::Bvh(const Geometry &geo, int threads, int max_leaf_triangles) {
+	bool indexed = not geo.triangles.empty();
+	int tri_count = (indexed ? geo.triangles.size() : geo.positions.size())/3;
+	if (tri_count==0) return;
+	auto vertex = [&](int t, int k) { return indexed ? geo.triangles[3*t+k] : 3*t+k; };
+
+	std::vector<Box> boxes(tri_count);
+	std::vector<glm::vec3> centroids(tri_count);
+	std::vector<int> order(tri_count);
+	for(int t=0;t<tri_count;++t) {
+		for(int k=0;k<3;++k) boxes[t].grow(geo.positions[vertex(t,k)]);
+		centroids[t] = (boxes[t].min+boxes[t].max)*.5f;
+		order[t] = t;
+	}
+
+	if (threads<=0) threads = std::max(1u,std::thread::hardware_concurrency());
+	int parallel_depth = 0; // (levels whose second child gets its own thread)
+	while ((1<<parallel_depth)<threads) ++parallel_depth;
+	m_nodes.reserve(2*tri_count/max_leaf_triangles+1);
+	BvhBuilder(boxes,centroids,order,std::max(1,max_leaf_triangles)).build(0,tri_count,0,parallel_depth,m_nodes);
+
+	// triangles in the leaves' order, so each leaf reads consecutive ones
+	bool tex_coords = not geo.tex_coords.empty();
+	m_positions.resize(3*tri_count);
+	if (tex_coords) m_tex_coords.resize(3*tri_count);
+	m_ids = std::move(order);
+	for(int i=0;i<tri_count;++i) {
+		for(int k=0;k<3;++k) {
+			m_positions[3*i+k] = geo.positions[vertex(m_ids[i],k)];
+			if (tex_coords) m_tex_coords[3*i+k] = geo.tex_coords[vertex(m_ids[i],k)];
+		}
+	}
+}
+
+RayHit Bvh::rayCast(const glm::vec3 &origin, const glm::vec3 &direction, float max_distance) const {
+	RayHit hit;
+	if (m_nodes.empty()) return hit;
+	glm::vec3 inv_direction(1.f/direction.x,1.f/direction.y,1.f/direction.z);
+	int stack[max_depth+1], top = 0, nearest = -1;
+	stack[top++] = 0;
+	while (top>0) {
+		int index = stack[--top];
+		const Node &node = m_nodes[index];
+		if (rayBox(origin,inv_direction,node.box_min,node.box_max,max_distance)>max_distance) continue;
+		if (node.count>0) {
+			for(int i=node.first;i<node.first+node.count;++i) {
+				float t, u, v;
+				if (not rayTriangle(origin,direction,&m_positions[3*i],t,u,v) or t<0.f or t>max_distance) continue;
+				max_distance = t;
+				nearest = i;
+				hit.barycentric = {1.f-u-v,u,v};
+			}
+		} else { // (the nearest child is pushed last, to be visited first)
+			int a = index+1, b = node.first;
+			float ta = rayBox(origin,inv_direction,m_nodes[a].box_min,m_nodes[a].box_max,max_distance);
+			float tb = rayBox(origin,inv_direction,m_nodes[b].box_min,m_nodes[b].box_max,max_distance);
+			if (ta>tb) { std::swap(a,b); std::swap(ta,tb); }
+			if (tb<=max_distance) stack[top++] = b;
+			if (ta<=max_distance) stack[top++] = a;
+		}
+	}
+	if (nearest==-1) return hit;
+	hit.triangle = m_ids[nearest];
+	hit.distance = max_distance;
+	if (not m_tex_coords.empty()) {
+		const glm::vec2 *uv = &m_tex_coords[3*nearest];
+		hit.tex_coords = hit.barycentric.x*uv[0]+hit.barycentric.y*uv[1]+hit.barycentric.z*uv[2];
+	}
+	return hit;
+}
+
+NearestPoint Bvh::nearestPoint(const glm::vec3 &p, float max_distance) const {
+	NearestPoint np;
+	if (m_nodes.empty()) return np;
+	float best2 = max_distance<std::sqrt(std::numeric_limits<float>::max())
+				  ? max_distance*max_distance : std::numeric_limits<float>::max();
+	int stack[max_depth+1], top = 0, nearest = -1;
+	stack[top++] = 0;
+	while (top>0) {
+		int index = stack[--top];
+		const Node &node = m_nodes[index];
+		if (boxDistance2(p,node.box_min,node.box_max)>best2) continue;
+		if (node.count>0) {
+			for(int i=node.first;i<node.first+node.count;++i) {
+				glm::vec3 barycentric, q = closestOnTriangle(p,&m_positions[3*i],barycentric);
+				float d2 = glm::dot(q-p,q-p);
+				if (d2>best2) continue;
+				best2 = d2; nearest = i;
+				np.point = q; np.barycentric = barycentric;
+			}
+		} else {
+			int a = index+1, b = node.first;
+			float da = boxDistance2(p,m_nodes[a].box_min,m_nodes[a].box_max);
+			float db = boxDistance2(p,m_nodes[b].box_min,m_nodes[b].box_max);
+			if (da>db) { std::swap(a,b); std::swap(da,db); }
+			if (db<=best2) stack[top++] = b;
+			if (da<=best2) stack[top++] = a;
+		}
+	}
+	if (nearest==-1) return np;
+	np.triangle = m_ids[nearest];
+	np.distance = std::sqrt(best2);
+	return np;
+}
+
+void Bvh::overlapping(const glm::vec3 &box_min, const glm::vec3 &box_max, std::vector<int> &triangles) const {
+	if (m_nodes.empty()) return;
+	glm::vec3 center = (box_min+box_max)*.5f, half = (box_max-box_min)*.5f;
+	int stack[max_depth+1], top = 0;
+	stack[top++] = 0;
+	while (top>0) {
+		const Node &node = m_nodes[stack[--top]];
+		bool apart = false;
+		for(int i=0;i<3;++i) apart = apart or node.box_max[i]<box_min[i] or node.box_min[i]>box_max[i];
+		if (apart) continue;
+		if (node.count>0) {
+			for(int i=node.first;i<node.first+node.count;++i)
+				if (triangleBox(&m_positions[3*i],center,half)) triangles.push_back(m_ids[i]);
+		} else {
+			stack[top++] = node.first;
+			stack[top++] = &node-m_nodes.data()+1;
+		}
+	}
+}
+
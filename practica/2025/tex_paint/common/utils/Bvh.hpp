@@ -0,0 +1,65 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+#include <vector>
+#include <limits>
+#include <glm/glm.hpp>
+#include "Geometry.hpp"
+
+// what a ray hit: the triangle (its indexes start at 3*triangle, -1 if it
+// hit nothing), how far along the ray (in lengths of its direction), the
+// weights of the triangle's three vertexes there, and the texture
+// coordinates they interpolate (0,0 if the geometry has none)
+struct RayHit {
+	int triangle = -1;
+	float distance = std::numeric_limits<float>::max();
+	glm::vec3 barycentric = {0.f,0.f,0.f};
+	glm::vec2 tex_coords = {0.f,0.f};
+};
+
+// the point of a geometry's surface that is nearest to another one
+struct NearestPoint {
+	int triangle = -1;
+	float distance = std::numeric_limits<float>::max();
+	glm::vec3 point = {0.f,0.f,0.f};
+	glm::vec3 barycentric = {0.f,0.f,0.f};
+};
+
+// bounding volume hierarchy over the triangles of a geometry, for picking
+// and other queries on the CPU (in the geometry's own space); nodes are
+// split where the surface area heuristic says, evaluated on 16 bins per
+// axis, and the subtrees of the first levels are built by up to threads
+// threads (0 for one per core); it keeps its own copy of the triangles, so
+// the geometry can change or go away, but then it must be built again
+class Bvh {
+public:
+	Bvh() = default;
+	Bvh(const Geometry &geo, int threads=0, int max_leaf_triangles=4);
+
+	// the first triangle along origin+t*direction, for 0<=t<=max_distance
+	// (both faces count)
+	RayHit rayCast(const glm::vec3 &origin, const glm::vec3 &direction,
+				   float max_distance=std::numeric_limits<float>::max()) const;
+
+	// the nearest point to p, if any is within max_distance
+	NearestPoint nearestPoint(const glm::vec3 &p, float max_distance=std::numeric_limits<float>::max()) const;
+
+	// the triangles that intersect the box (exactly, not only their boxes),
+	// appended to triangles in no particular order
+	void overlapping(const glm::vec3 &box_min, const glm::vec3 &box_max, std::vector<int> &triangles) const;
+
+	bool isEmpty() const { return m_nodes.empty(); }
+	int getNodeCount() const { return m_nodes.size(); }
+
+private:
+	friend class BvhBuilder;
+	// leaves have count>0 triangles from first on; inner nodes have their
+	// first child right after them and the second one at first
+	struct Node { glm::vec3 box_min; int first; glm::vec3 box_max; int count; };
+	std::vector<Node> m_nodes;
+	std::vector<glm::vec3> m_positions; // 3 per triangle, in the leaves' order
+	std::vector<glm::vec2> m_tex_coords; // the same, if the geometry has them
+	std::vector<int> m_ids; // triangle of the geometry each one came from
+};
+
+#endif
+
@@ -5,6 +5,8 @@
 #include "Callbacks.hpp"
 #include "DrawBuffers.hpp"
 #include "Debug.hpp"
+#include "GpuMemory.hpp"
+#include "embedded/texquad.hpp"
 
 static glm::vec4 hsv2rgb(float h, float s, float v, float a) {
 	
@@ -38,25 +40,31 @@ void DrawBuffers::init() {
 	shader_depth = Shader("shaders/depth");
 	glGenVertexArrays(1,&VAO);
 	glBindVertexArray(VAO);
-	std::vector<glm::vec3> vpos = {
-		{-1.f,-1.f,0.f}, {+1.f,-1.f,0.f},
-		{+1.f,+1.f,0.f}, {-1.f,+1.f,0.f} };
-	std::vector<glm::vec2> vtc = {
-		{0.f,0.f}, {1.f,0.f},
-		{1.f,1.f}, {0.f,1.f} };
-	glGenBuffers(2, VBO);
+	// texquad.obj, compiled in: [-1;1]^2 with tex coords [0;1]^2
+	const EmbeddedMesh &quad = embedded::texquad[0];
+	glGenBuffers(3, VBO);
+	// with the same fixed locations that Shader binds for GeometryRenderer
 	glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-	glBufferData(GL_ARRAY_BUFFER, vpos.size()*sizeof(glm::vec3), vpos.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, quad.vertex_count*sizeof(glm::vec3), quad.positions, GL_STATIC_DRAW);
+	glVertexAttribPointer(GeometryRenderer::aPosition, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(GeometryRenderer::aPosition);
 	glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-	glBufferData(GL_ARRAY_BUFFER, vpos.size()*sizeof(glm::vec2), vtc.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, quad.vertex_count*sizeof(glm::vec2), quad.tex_coords, GL_STATIC_DRAW);
+	glVertexAttribPointer(GeometryRenderer::aTexCoords, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(GeometryRenderer::aTexCoords);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, VBO[2]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, quad.index_count*sizeof(int), quad.triangles, GL_STATIC_DRAW);
 	glBindVertexArray(0);
+	GpuMemory::track(GpuMemory::cBuffer,VBO[0],"DrawBuffers",quad.vertex_count*sizeof(glm::vec3));
+	GpuMemory::track(GpuMemory::cBuffer,VBO[1],"DrawBuffers",quad.vertex_count*sizeof(glm::vec2));
+	GpuMemory::track(GpuMemory::cBuffer,VBO[2],"DrawBuffers",quad.index_count*sizeof(int));
 }
 
 void DrawBuffers::drawStencil(int max) {
 	if (VAO==0) init();
 	
 	glBindVertexArray(VAO);
-	Shader &shader = setShaderAndVBOs(true);
+	Shader &shader = useShader(true);
 	
 	bool depth_was_on = glIsEnabled(GL_DEPTH_TEST);
 	glDisable(GL_DEPTH_TEST);
@@ -65,7 +73,7 @@ void DrawBuffers::drawStencil(int max) {
 	for(int ref=0;ref<max;++ref) {
 		shader.setUniform("color",getColor(ref));
 		glStencilFunc(GL_EQUAL,ref,255);
-		glDrawArrays(GL_TRIANGLE_FAN,0,4);
+		glDrawElements(GL_TRIANGLES,embedded::texquad[0].index_count,GL_UNSIGNED_INT,nullptr);
 	}
 	glDisable(GL_STENCIL_TEST);
 	if (depth_was_on) glEnable(GL_DEPTH_TEST);
@@ -74,8 +82,13 @@ void DrawBuffers::drawStencil(int max) {
 
 DrawBuffers::~DrawBuffers() {
 	if (VAO==0) return;
-	glDeleteBuffers(2,VBO);
+	glDeleteBuffers(3,VBO);
 	glDeleteVertexArrays(1,&VAO);
+	for(GLuint id : VBO) GpuMemory::release(GpuMemory::cBuffer,id);
+	if (tex_id) {
+		glDeleteTextures(1,&tex_id);
+		GpuMemory::release(GpuMemory::cTexture,tex_id);
+	}
 }
 
 static int getStencilValueUnderMouseCursor(GLFWwindow *window) {
@@ -103,6 +116,7 @@ void DrawBuffers::drawDepth (int w, int h, float exp, unsigned int already_captu
 			glBindTexture(GL_TEXTURE_2D, tex_id);
 		}
 		glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, 0,0,w,h, 0);
+		GpuMemory::track(GpuMemory::cTexture,tex_id,"DrawBuffers",size_t(w)*h*4); // (its size follows the window's)
 //		glBindTexture(GL_TEXTURE_2D, 0);
 	} else {
 		glActiveTexture(GL_TEXTURE0);
@@ -110,7 +124,7 @@ void DrawBuffers::drawDepth (int w, int h, float exp, unsigned int already_captu
 	}
 	
 	// draw
-	Shader &shader = setShaderAndVBOs(false);
+	Shader &shader = useShader(false);
 	shader.setUniform("exp",exp);
 	
 	bool depth_was_on = glIsEnabled(GL_DEPTH_TEST);
@@ -119,26 +133,16 @@ void DrawBuffers::drawDepth (int w, int h, float exp, unsigned int already_captu
 	
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glDrawArrays(GL_TRIANGLE_FAN, 0,4);
+	glDrawElements(GL_TRIANGLES, embedded::texquad[0].index_count, GL_UNSIGNED_INT, nullptr);
 	glBindTexture(GL_TEXTURE_2D, 0); 
 	
 	if (depth_was_on) glEnable(GL_DEPTH_TEST);
 	glBindVertexArray(0);
 }
 
-Shader &DrawBuffers::setShaderAndVBOs(bool stencil) {
+Shader &DrawBuffers::useShader(bool stencil) {
 	Shader &shader = stencil ? shader_stencil : shader_depth;
 	shader.use();
-	int loc_pos = 0;
-	glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-	glVertexAttribPointer(loc_pos, 3, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(loc_pos);
-	if (not stencil) {
-		loc_pos = 1;
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-		glVertexAttribPointer(loc_pos, 2, GL_FLOAT, GL_FALSE, 0, 0);
-		glEnableVertexAttribArray(loc_pos);
-	}
 	return shader;
 }
 
@@ -16,8 +16,8 @@ public:
 	void setNextBuffer();
 	~DrawBuffers();
 private:
-	Shader &setShaderAndVBOs(bool stencil);
-	GLuint VAO=0, VBO[2]={0,0}, tex_id=0;
+	Shader &useShader(bool stencil);
+	GLuint VAO=0, VBO[3]={0,0,0}, tex_id=0; // VBO[2] is the EBO
 	Shader shader_stencil;
 	Shader shader_depth;
 	// para ImGui
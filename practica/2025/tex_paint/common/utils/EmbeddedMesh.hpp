@@ -0,0 +1,52 @@
+#ifndef EMBEDDED_MESH_HPP
+#define EMBEDDED_MESH_HPP
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include "Geometry.hpp"
+#include "Material.hpp"
+
+static_assert(sizeof(glm::vec3)==3*sizeof(float) and sizeof(glm::vec2)==2*sizeof(float),
+			  "EmbeddedMesh arrays are used as glm vectors");
+
+// one part of a mesh compiled into the program: its final geometry (already
+// deduplicated, fitted and with normals) as constexpr arrays, and its
+// material; the headers that define them (see embedded/) are generated with
+// Model::writeEmbedded, and uploaded with Model::fromEmbedded
+struct EmbeddedMesh {
+	const char *name;
+	float ka[3], kd[3], ks[3], ke[3];
+	float shininess, opacity;
+	const char *texture; // "" if none
+	const float (*positions)[3];
+	const float (*normals)[3]; // nullptr if there are no normals
+	const float (*tex_coords)[2]; // nullptr if there are no texture coordinates
+	int vertex_count;
+	const int *triangles; // nullptr if not indexed
+	int index_count;
+
+	GeometryView getGeometry() const {
+		GeometryView g;
+		g.positions = reinterpret_cast<const glm::vec3*>(positions);
+		g.normals = reinterpret_cast<const glm::vec3*>(normals);
+		g.tex_coords = reinterpret_cast<const glm::vec2*>(tex_coords);
+		g.triangles = triangles;
+		g.vertex_count = vertex_count;
+		g.index_count = index_count;
+		return g;
+	}
+
+	Material getMaterial() const {
+		Material m;
+		m.ka = {ka[0],ka[1],ka[2]};
+		m.kd = {kd[0],kd[1],kd[2]};
+		m.ks = {ks[0],ks[1],ks[2]};
+		m.ke = {ke[0],ke[1],ke[2]};
+		m.shininess = shininess;
+		m.opacity = opacity;
+		m.texture = texture;
+		return m;
+	}
+};
+
+#endif
+
@@ -1,5 +1,6 @@
 #include "FramebufferTexture.hpp"
 #include "Debug.hpp"
+#include "GpuMemory.hpp"
 
 FramebufferTexture::FramebufferTexture(int width, int height, Type type)
 	: m_width(width), m_height(height), m_type(type)
@@ -17,6 +18,8 @@ FramebufferTexture::FramebufferTexture(int width, int height, Type type)
 	};
 	glTexImage2D(GL_TEXTURE_2D, 0, get_component(),
 				 width, height, 0, get_component(), GL_FLOAT, NULL);
+	// (what drivers usually store: 24/32 bits depth, 8 bits stencil, rgb padded to rgba8)
+	GpuMemory::track(GpuMemory::cFramebuffer,m_tex,"FramebufferTexture",size_t(width)*height*(type==Stencil?1:4));
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -45,12 +48,19 @@ void FramebufferTexture::bindTexture(int tex_num) const {
 }
 
 FramebufferTexture::~FramebufferTexture() {
+	freeResources();
+}
+
+void FramebufferTexture::freeResources() {
 	if (m_type==None) return;
 	glDeleteTextures(1,&m_tex);
 	glDeleteFramebuffers(1,&m_fbo);
+	GpuMemory::release(GpuMemory::cFramebuffer,m_tex);
 }
 
 FramebufferTexture &FramebufferTexture::operator=(FramebufferTexture &&other) {
+	if (this==&other) return *this;
+	freeResources(); // (replacing one with another must not leak the first)
 	m_type = other.m_type;     other.m_type = None;
 	m_tex = other.m_tex;       other.m_tex = 0;
 	m_fbo = other.m_fbo;       other.m_fbo = 0;
@@ -20,6 +20,7 @@ public:
 	unsigned int getTexture() const { return m_tex; }
 	
 private:
+	void freeResources();
 	Type m_type = None;
 	int m_width = 0, m_height = 0;
 	unsigned int m_fbo = 0, m_tex = 0;
@@ -1,46 +1,269 @@
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <cstdint>
+#include <thread>
 #include <glm/ext.hpp>
+#include <glm/gtc/packing.hpp>
 #include "Geometry.hpp"
 #include "Debug.hpp"
+#include "GpuMemory.hpp"
+#include "MeshOptimizer.hpp"
 
-template<typename vector>
-static void updateBuffer(GLenum type, GLuint &id, vector &v, bool realloc, bool dynamic) {
+template<typename T>
+static void updateBuffer(GLenum type, GLuint &id, const T *data, size_t count, bool realloc, bool dynamic) {
 	if (id==0) {
 		cg_assert(realloc,"Texture coordinates not initialized");
 		glGenBuffers(1, &id);
 	}
 	glBindBuffer(type, id);
 	if (realloc) {
-		glBufferData(type, v.size()*sizeof(typename vector::value_type), v.data(), dynamic?GL_DYNAMIC_DRAW:GL_STATIC_DRAW);
+		glBufferData(type, count*sizeof(T), data, dynamic?GL_DYNAMIC_DRAW:GL_STATIC_DRAW);
+		GpuMemory::track(GpuMemory::cBuffer,id,"GeometryRenderer",count*sizeof(T));
 	} else
-		glBufferSubData(type, 0, v.size()*sizeof(typename vector::value_type), v.data());
+		glBufferSubData(type, 0, count*sizeof(T), data);
+}
+
+template<typename vector>
+static void updateBuffer(GLenum type, GLuint &id, vector &v, bool realloc, bool dynamic) {
+	updateBuffer(type,id,v.data(),v.size(),realloc,dynamic);
+}
+
+// resizes buffer id to hold capacity elements of T keeping the first count ones
+// (through a temporary copy, so the name doesn't change)
+template<typename T>
+static void growBuffer(GLenum type, GLuint id, size_t count, size_t capacity) {
+	GLuint tmp = 0;
+	if (count) {
+		glGenBuffers(1,&tmp);
+		glBindBuffer(GL_COPY_WRITE_BUFFER,tmp);
+		glBufferData(GL_COPY_WRITE_BUFFER,count*sizeof(T),nullptr,GL_STATIC_COPY);
+		glBindBuffer(GL_COPY_READ_BUFFER,id);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER,GL_COPY_WRITE_BUFFER,0,0,count*sizeof(T));
+	}
+	glBindBuffer(type,id);
+	glBufferData(type,capacity*sizeof(T),nullptr,GL_STATIC_DRAW);
+	GpuMemory::track(GpuMemory::cBuffer,id,"GeometryRenderer",capacity*sizeof(T));
+	if (count) {
+		glBindBuffer(GL_COPY_READ_BUFFER,tmp);
+		glBindBuffer(GL_COPY_WRITE_BUFFER,id);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER,GL_COPY_WRITE_BUFFER,0,0,count*sizeof(T));
+		glDeleteBuffers(1,&tmp);
+	}
+}
+
+template<typename T>
+static void appendToBuffer(GLenum type, GLuint id, const T *data, size_t offset, size_t count) {
+	glBindBuffer(type,id);
+	glBufferSubData(type,offset*sizeof(T),count*sizeof(T),data);
+}
+
+GeometryRenderer::GeometryRenderer(const Geometry &geo, bool dynamic, Layout layout, bool strips) 
+	: GeometryRenderer(GeometryView(geo),dynamic,layout,strips) 
+{
+	
 }
 
-GeometryRenderer::GeometryRenderer(const Geometry &geo, bool dynamic) {
+GeometryRenderer::GeometryRenderer(const GeometryView &geo, bool dynamic, Layout layout, bool strips) {
 	
-	cg_assert(geo.positions.size(),"Empty Geometry");
+	cg_assert(geo.vertex_count,"Empty Geometry");
+	allow_strips = strips;
 	
 	glGenVertexArrays(1,&VAO);
 	glBindVertexArray(VAO);
 	
-	updateBuffer(GL_ARRAY_BUFFER,VBO_pos,geo.positions,true,dynamic);
-	
-	if (not geo.normals.empty()) {
-		cg_assert(geo.normals.size()==geo.positions.size(),"Wrong normals count");
-		updateBuffer(GL_ARRAY_BUFFER,VBO_norms,geo.normals,true,dynamic);  
-	}
-	if (not geo.tex_coords.empty()) {
-		cg_assert(geo.tex_coords.size()==geo.positions.size(),"Wrong texture coordinates count");
-		updateBuffer(GL_ARRAY_BUFFER,VBO_tcs,geo.tex_coords,true, dynamic);  
+	if (layout==lQuantized) {
+		uploadQuantized(geo,dynamic);
+	} else if (layout==lInterleaved) {
+		uploadInterleaved(geo,dynamic);
+	} else {
+		updateBuffer(GL_ARRAY_BUFFER,VBO_pos,geo.positions,geo.vertex_count,true,dynamic);
+		if (geo.normals)
+			updateBuffer(GL_ARRAY_BUFFER,VBO_norms,geo.normals,geo.vertex_count,true,dynamic);  
+		if (geo.tex_coords)
+			updateBuffer(GL_ARRAY_BUFFER,VBO_tcs,geo.tex_coords,geo.vertex_count,true, dynamic);  
 	}
-	if (not geo.triangles.empty()) {
-		updateBuffer(GL_ELEMENT_ARRAY_BUFFER,EBO,geo.triangles,true,dynamic);
-		count = geo.triangles.size();
+	setAttributes(aPosition,aNormal,aTexCoords);
+	vertex_count = vertex_capacity = geo.vertex_count;
+	if (geo.triangles) {
+		uploadIndexes(geo.triangles,geo.index_count,dynamic);
 	} else 
-		count = geo.positions.size();
+		count = geo.vertex_count;
+	index_capacity = geo.index_count;
 	
 	glBindVertexArray(0);
 }
 
+void GeometryRenderer::uploadInterleaved(const GeometryView &geo, bool dynamic) {
+	// position, normal, tex_coords, position, normal...
+	int floats = 3;
+	if (geo.normals) { normals_offset = floats*sizeof(float); floats += 3; }
+	if (geo.tex_coords) { tcs_offset = floats*sizeof(float); floats += 2; }
+	stride = floats*sizeof(float);
+	std::vector<float> data(size_t(geo.vertex_count)*floats);
+	for(int i=0;i<geo.vertex_count;++i) {
+		float *v = data.data()+size_t(i)*floats;
+		v[0] = geo.positions[i].x; v[1] = geo.positions[i].y; v[2] = geo.positions[i].z; v += 3;
+		if (geo.normals) { v[0] = geo.normals[i].x; v[1] = geo.normals[i].y; v[2] = geo.normals[i].z; v += 3; }
+		if (geo.tex_coords) { v[0] = geo.tex_coords[i].x; v[1] = geo.tex_coords[i].y; }
+	}
+	updateBuffer(GL_ARRAY_BUFFER,VBO_pos,data,true,dynamic);
+}
+
+// octahedral mapping of a unit vector to [-1,1]^2 (a zero vector gives +z)
+static glm::vec2 octEncode(const glm::vec3 &n) {
+	float l1 = std::abs(n.x)+std::abs(n.y)+std::abs(n.z);
+	if (l1==0.f) return {0.f,0.f};
+	glm::vec2 p(n.x/l1,n.y/l1);
+	if (n.z<0.f) {
+		glm::vec2 s(p.x>=0.f?1.f:-1.f, p.y>=0.f?1.f:-1.f);
+		p = glm::vec2(1.f-std::abs(p.y),1.f-std::abs(p.x))*s;
+	}
+	return p;
+}
+
+void GeometryRenderer::uploadQuantized(const GeometryView &geo, bool dynamic) {
+	// 8 bytes of position (the 4th unorm is padding), 4 of normal, 4 of tex_coords
+	quantized = true;
+	int words = 2;
+	if (geo.normals) { normals_offset = words*sizeof(uint32_t); words += 1; }
+	if (geo.tex_coords) { tcs_offset = words*sizeof(uint32_t); words += 1; }
+	stride = words*sizeof(uint32_t);
+	
+	glm::vec3 pmin = geo.positions[0], pmax = geo.positions[0];
+	for(int i=1;i<geo.vertex_count;++i) {
+		pmin = glm::min(pmin,geo.positions[i]);
+		pmax = glm::max(pmax,geo.positions[i]);
+	}
+	positions_offset = pmin;
+	positions_scale = pmax-pmin;
+	glm::vec3 inv_scale;
+	for(int j=0;j<3;++j) inv_scale[j] = positions_scale[j]==0.f ? 0.f : 1.f/positions_scale[j];
+	
+	std::vector<uint32_t> data(size_t(geo.vertex_count)*words);
+	for(int i=0;i<geo.vertex_count;++i) {
+		uint32_t *v = data.data()+size_t(i)*words;
+		uint64_t p = glm::packUnorm4x16(glm::vec4((geo.positions[i]-pmin)*inv_scale,0.f));
+		v[0] = uint32_t(p); v[1] = uint32_t(p>>32); v += 2;
+		if (geo.normals) *(v++) = glm::packSnorm2x16(octEncode(geo.normals[i]));
+		if (geo.tex_coords) *v = glm::packHalf2x16(geo.tex_coords[i]);
+	}
+	updateBuffer(GL_ARRAY_BUFFER,VBO_pos,data,true,dynamic);
+}
+
+static GeometryRenderer::IndexStats index_stats;
+
+static void accountIndexes(int sign, size_t bytes, size_t saved_bytes, GLenum type, GLenum mode,
+						   size_t triangles=0, size_t transformed=0) {
+	index_stats.bytes += sign*bytes;
+	index_stats.saved_bytes += sign*saved_bytes;
+	index_stats.triangles += sign*triangles;
+	index_stats.transformed += sign*transformed;
+	if (type==GL_UNSIGNED_SHORT) index_stats.narrowed += sign;
+	if (mode==GL_TRIANGLE_STRIP) index_stats.strips += sign;
+}
+
+const GeometryRenderer::IndexStats &GeometryRenderer::getIndexStats() {
+	return index_stats;
+}
+
+// greedy conversion of a triangle list into strips separated by -1,
+// keeping every triangle's winding (in a strip, odd triangles are drawn as
+// v[i+1],v[i],v[i+2]); it continues each strip through the edge shared with
+// an unused triangle for as long as there is one among the next window
+// triangles that were not used yet, so the list's order (the one
+// optimizeMesh leaves for the vertex cache) is mostly kept
+static std::vector<int> makeStrips(const int *triangles, int index_count, int window=4) {
+	int tri_count = index_count/3;
+	auto edgeKey = [](uint32_t a, uint32_t b) { return (uint64_t(a)<<32)|b; };
+	// directed edge -> index where it starts (for non-manifold edges, the first one)
+	std::unordered_map<uint64_t,int> edges;
+	edges.reserve(size_t(index_count)*2);
+	for(int i=0;i<tri_count*3;++i)
+		edges.emplace(edgeKey(triangles[i],triangles[i-i%3+(i+1)%3]),i);
+	std::vector<bool> used(tri_count,false);
+	int first_unused = 0;
+	auto use = [&](int t) {
+		used[t] = true;
+		while(first_unused<tri_count and used[first_unused]) ++first_unused;
+	};
+	// unused triangle close enough with the directed edge a->b, and its 3rd vertex
+	auto next = [&](int a, int b, int &c) {
+		auto it = edges.find(edgeKey(a,b));
+		if (it==edges.end() or used[it->second/3] or it->second/3>first_unused+window) return -1;
+		int i = it->second;
+		c = triangles[i-i%3+(i+2)%3];
+		return i/3;
+	};
+	
+	std::vector<int> strips;
+	strips.reserve(index_count);
+	for(int t=0;t<tri_count;++t) {
+		if (used[t]) continue;
+		use(t);
+		// start by the rotation that can continue through its last edge
+		const int *v = triangles+3*t;
+		int r = 0, c;
+		for(int k=0;k<3;++k)
+			if (next(v[(k+2)%3],v[(k+1)%3],c)!=-1) { r = k; break; }
+		if (not strips.empty()) strips.push_back(-1);
+		size_t first = strips.size();
+		for(int k=0;k<3;++k) strips.push_back(v[(r+k)%3]);
+		for(;;) {
+			int x = strips[strips.size()-2], y = strips.back();
+			bool odd = (strips.size()-first)%2==1; // of the triangle that would come next
+			int nt = odd ? next(y,x,c) : next(x,y,c);
+			if (nt==-1) break;
+			use(nt);
+			strips.push_back(c);
+		}
+	}
+	return strips;
+}
+
+void GeometryRenderer::uploadIndexes(const int *triangles, int index_count, bool dynamic) {
+	accountIndexes(-1,index_bytes,index_saved_bytes,index_type,mode,index_triangles,index_transformed);
+	mode = GL_TRIANGLES; 
+	index_type = GL_UNSIGNED_INT;
+	index_triangles = index_transformed = 0;
+	size_t list_bytes = size_t(index_count)*sizeof(int);
+	// dynamic buffers keep 32-bit lists, so they can be updated and appended
+	if (dynamic or vertex_count>=0xffff) {
+		updateBuffer(GL_ELEMENT_ARRAY_BUFFER,EBO,triangles,index_count,true,dynamic);
+		count = index_count;
+		if (not dynamic) {
+			VertexCacheStats list = analyzeVertexCache(triangles,index_count,vertex_count);
+			index_triangles = index_count/3;
+			index_transformed = std::lround(list.acmr*index_triangles);
+		}
+	} else {
+		// strips only pay off if they save a good part of the indexes, and
+		// only if the vertex cache does not transform more vertexes for them
+		VertexCacheStats list = analyzeVertexCache(triangles,index_count,vertex_count), strip;
+		std::vector<int> strips;
+		if (allow_strips) strips = makeStrips(triangles,index_count);
+		bool use_strips = allow_strips and strips.size()*4<size_t(index_count)*3;
+		if (use_strips) {
+			strip = analyzeVertexCache(strips.data(),strips.size(),vertex_count,true);
+			use_strips = strip.acmr<=list.acmr;
+		}
+		if (use_strips) mode = GL_TRIANGLE_STRIP;
+		// (-1 becomes 0xffff, the restart index)
+		std::vector<uint16_t> indexes;
+		if (use_strips) indexes.assign(strips.begin(),strips.end());
+		else indexes.assign(triangles,triangles+index_count);
+		index_type = GL_UNSIGNED_SHORT;
+		updateBuffer(GL_ELEMENT_ARRAY_BUFFER,EBO,indexes,true,dynamic);
+		count = indexes.size();
+		index_triangles = index_count/3;
+		index_transformed = std::lround((use_strips?strip:list).acmr*index_triangles);
+	}
+	
+	index_bytes = size_t(count)*(index_type==GL_UNSIGNED_SHORT?2:4);
+	index_saved_bytes = list_bytes-std::min(list_bytes,index_bytes);
+	accountIndexes(+1,index_bytes,index_saved_bytes,index_type,mode,index_triangles,index_transformed);
+}
+
 GeometryRenderer::GeometryRenderer(GeometryRenderer &&geo) {
 	*this = static_cast<const GeometryRenderer&>(geo);
 	geo = static_cast<const GeometryRenderer&>(GeometryRenderer());
@@ -55,60 +278,286 @@ GeometryRenderer &GeometryRenderer::operator=(GeometryRenderer &&geo) {
 
 void GeometryRenderer::draw() const {
 	glBindVertexArray(VAO);
-	if (EBO) glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0);
+	if (mode==GL_TRIANGLE_STRIP) {
+		glEnable(GL_PRIMITIVE_RESTART);
+		glPrimitiveRestartIndex(index_type==GL_UNSIGNED_SHORT ? 0xffff : 0xffffffff);
+	}
+	if (EBO) glDrawElements(mode, count, index_type, 0);
 	else glDrawArrays(GL_TRIANGLES, 0,count);
+	if (mode==GL_TRIANGLE_STRIP) glDisable(GL_PRIMITIVE_RESTART);
+	glBindVertexArray(0);
+}
+
+void GeometryRenderer::draw(const std::vector<IndexRange> &ranges) const {
+	cg_assert(EBO and mode==GL_TRIANGLES,"Drawing ranges requires an indexed triangle list");
+	if (ranges.empty()) return;
+	size_t index_size = index_type==GL_UNSIGNED_SHORT ? 2 : 4;
+	std::vector<GLsizei> counts(ranges.size());
+	std::vector<const void*> offsets(ranges.size());
+	for(size_t i=0;i<ranges.size();++i) {
+		counts[i] = ranges[i].count;
+		offsets[i] = reinterpret_cast<const void*>(ranges[i].first*index_size);
+	}
+	glBindVertexArray(VAO);
+	glMultiDrawElements(GL_TRIANGLES, counts.data(), index_type, offsets.data(), ranges.size());
 	glBindVertexArray(0);
 }
 
+void GeometryRenderer::setAttributes(GLint loc_pos, GLint loc_norm, GLint loc_tc) const {
+	glBindVertexArray(VAO);
+	for(GLint loc : attrib_locations) 
+		if (loc!=-1) glDisableVertexAttribArray(loc);
+	auto set = [&](GLint loc, GLuint vbo, int size, GLenum type, int offset) {
+		if (loc==-1) return -1;
+		glBindBuffer(GL_ARRAY_BUFFER, stride ? VBO_pos : vbo);
+		glVertexAttribPointer(loc, size, type, type==GL_UNSIGNED_SHORT or type==GL_SHORT, 
+							  stride, reinterpret_cast<void*>(size_t(offset)));
+		glEnableVertexAttribArray(loc);
+		return loc;
+	};
+	attrib_locations[0] = set(loc_pos,VBO_pos,3,quantized?GL_UNSIGNED_SHORT:GL_FLOAT,0);
+	attrib_locations[1] = hasNormals() 
+		? set(loc_norm,VBO_norms,quantized?2:3,quantized?GL_SHORT:GL_FLOAT,stride?normals_offset:0) : -1;
+	attrib_locations[2] = hasTexCoords() 
+		? set(loc_tc,VBO_tcs,2,quantized?GL_HALF_FLOAT:GL_FLOAT,stride?tcs_offset:0) : -1;
+}
+
+void GeometryRenderer::useAttributes(GLint loc_pos, GLint loc_norm, GLint loc_tc) const {
+	if (loc_pos!=attrib_locations[0] 
+		or (loc_norm!=-1 and loc_norm!=attrib_locations[1])
+		or (loc_tc!=-1 and loc_tc!=attrib_locations[2]))
+	{
+		setAttributes(loc_pos,loc_norm,loc_tc);
+		glBindVertexArray(0);
+	}
+}
+
 void GeometryRenderer::freeResources() {
 	if (VAO==0) return;
-	if (VBO_pos) glDeleteBuffers(1,&VBO_pos);
-	if (VBO_norms) glDeleteBuffers(1,&VBO_norms);
-	if (VBO_tcs) glDeleteBuffers(1,&VBO_tcs);
-	if (EBO) glDeleteBuffers(1,&EBO);
+	for(GLuint id : {VBO_pos,VBO_norms,VBO_tcs,EBO}) {
+		if (id==0) continue;
+		glDeleteBuffers(1,&id);
+		GpuMemory::release(GpuMemory::cBuffer,id);
+	}
 	glDeleteVertexArrays(1,&VAO);
+	accountIndexes(-1,index_bytes,index_saved_bytes,index_type,mode,index_triangles,index_transformed);
 }
 GeometryRenderer::~GeometryRenderer() {
 	freeResources();
 }
 
 void GeometryRenderer::updateTexCoords (const std::vector<glm::vec2> &vtc, bool realloc, bool dynamic) {
+	cg_assert(not stride,"Cannot update an interleaved geometry");
+	GLuint prev = VBO_tcs;
 	updateBuffer(GL_ARRAY_BUFFER, VBO_tcs,vtc,realloc,dynamic);
+	if (VBO_tcs!=prev) { setAttributes(aPosition,aNormal,aTexCoords); glBindVertexArray(0); }
 }
 
 void GeometryRenderer::updatePositions (const std::vector<glm::vec3> &vp, bool realloc, bool dynamic) {
+	cg_assert(not stride,"Cannot update an interleaved geometry");
 	updateBuffer(GL_ARRAY_BUFFER, VBO_pos,vp,realloc,dynamic);
 }
 
 void GeometryRenderer::updateNormals (const std::vector<glm::vec3> &vn, bool realloc, bool dynamic) {
+	cg_assert(not stride,"Cannot update an interleaved geometry");
+	GLuint prev = VBO_norms;
 	updateBuffer(GL_ARRAY_BUFFER, VBO_norms,vn,realloc,dynamic);
+	if (VBO_norms!=prev) { setAttributes(aPosition,aNormal,aTexCoords); glBindVertexArray(0); }
 }
 
 void GeometryRenderer::updateElements(const std::vector<int> &ve, bool realloc, bool dynamic) {
-	updateBuffer(GL_ELEMENT_ARRAY_BUFFER,EBO,ve,realloc,dynamic);
+	glBindVertexArray(VAO);
+	if (realloc or index_type!=GL_UNSIGNED_INT or mode!=GL_TRIANGLES)
+		uploadIndexes(ve.data(),ve.size(),dynamic); // (narrowed again if it's static)
+	else
+		updateBuffer(GL_ELEMENT_ARRAY_BUFFER,EBO,ve,false,dynamic);
+	glBindVertexArray(0);
 }
 
-void Geometry::generateNormals() {
-	normals.clear();
-	normals.resize(positions.size());
-	if (triangles.empty()) {
-		for(size_t i=0;i<positions.size();i+=3)
-			normals[i] = normals[i+1] = normals[i+2] = 
-				glm::normalize(
-					glm::cross(
-						(positions[i+2]-positions[i+1]),
-						(positions[i+1]-positions[i+1]) ) );
-	} else {
-		for(size_t i=0;i<triangles.size();i+=3) {
-			auto n = glm::cross( (positions[triangles[i+2]]-positions[triangles[i+1]]),
-								 (positions[triangles[i+0]]-positions[triangles[i+1]]) );
-			normals[triangles[i+0]] += n;
-			normals[triangles[i+1]] += n;
-			normals[triangles[i+2]] += n;
+void GeometryRenderer::reserve(int vertexes, int indexes) {
+	cg_assert(VAO,"Cannot reserve space in an empty GeometryRenderer");
+	cg_assert(not stride,"Cannot grow an interleaved geometry");
+	cg_assert(index_type==GL_UNSIGNED_INT and mode==GL_TRIANGLES,"Cannot grow a static geometry's indexes");
+	glBindVertexArray(VAO);
+	if (vertexes>vertex_capacity) {
+		growBuffer<glm::vec3>(GL_ARRAY_BUFFER,VBO_pos,vertex_count,vertexes);
+		if (VBO_norms) growBuffer<glm::vec3>(GL_ARRAY_BUFFER,VBO_norms,vertex_count,vertexes);
+		if (VBO_tcs) growBuffer<glm::vec2>(GL_ARRAY_BUFFER,VBO_tcs,vertex_count,vertexes);
+		vertex_capacity = vertexes;
+	}
+	if (EBO and indexes>index_capacity) {
+		growBuffer<int>(GL_ELEMENT_ARRAY_BUFFER,EBO,count,indexes);
+		index_capacity = indexes;
+		accountIndexes(-1,index_bytes,0,index_type,mode);
+		index_bytes = size_t(indexes)*sizeof(int);
+		accountIndexes(+1,index_bytes,0,index_type,mode);
+	}
+	glBindVertexArray(0);
+}
+
+void GeometryRenderer::append(const GeometryView &geo) {
+	// (dynamic, so its indexes are a 32-bit list that can grow)
+	if (not VAO) { *this = GeometryRenderer(geo,true); return; }
+	cg_assert(not stride,"Cannot append to an interleaved geometry");
+	cg_assert((geo.normals!=nullptr)==(VBO_norms!=0) and (geo.tex_coords!=nullptr)==(VBO_tcs!=0)
+			  and (geo.triangles!=nullptr)==(EBO!=0), "Appended geometry has different attributes");
+	if (vertex_count+geo.vertex_count>vertex_capacity or (EBO and count+geo.index_count>index_capacity))
+		reserve(std::max(vertex_count+geo.vertex_count,vertex_capacity*2),
+				std::max(count+geo.index_count,index_capacity*2));
+	glBindVertexArray(VAO);
+	appendToBuffer(GL_ARRAY_BUFFER,VBO_pos,geo.positions,vertex_count,geo.vertex_count);
+	if (geo.normals) appendToBuffer(GL_ARRAY_BUFFER,VBO_norms,geo.normals,vertex_count,geo.vertex_count);
+	if (geo.tex_coords) appendToBuffer(GL_ARRAY_BUFFER,VBO_tcs,geo.tex_coords,vertex_count,geo.vertex_count);
+	if (geo.triangles) appendToBuffer(GL_ELEMENT_ARRAY_BUFFER,EBO,geo.triangles,count,geo.index_count);
+	glBindVertexArray(0);
+	vertex_count += geo.vertex_count;
+	count = EBO ? count+geo.index_count : vertex_count;
+}
+
+GeometryView::GeometryView(const Geometry &geo) 
+	: positions(geo.positions.data()),
+	  normals(geo.normals.empty() ? nullptr : geo.normals.data()),
+	  tex_coords(geo.tex_coords.empty() ? nullptr : geo.tex_coords.data()),
+	  triangles(geo.triangles.empty() ? nullptr : geo.triangles.data()),
+	  vertex_count(geo.positions.size()), index_count(geo.triangles.size())
+{
+	if (normals)
+		cg_assert(geo.normals.size()==geo.positions.size(),"Wrong normals count");
+	if (tex_coords)
+		cg_assert(geo.tex_coords.size()==geo.positions.size(),"Wrong texture coordinates count");
+}
+
+Geometry GeometryView::copy() const {
+	Geometry g;
+	g.positions.assign(positions,positions+vertex_count);
+	if (normals) g.normals.assign(normals,normals+vertex_count);
+	if (tex_coords) g.tex_coords.assign(tex_coords,tex_coords+vertex_count);
+	if (triangles) g.triangles.assign(triangles,triangles+index_count);
+	return g;
+}
+
+namespace {
+
+// calls f(begin,end) for consecutive chunks of [0,count), one per thread 
+// (this one included), with at least min_chunk elements each
+// threads that parallelChunks uses for count elements
+int chunkThreads(int count, int threads) {
+	constexpr int min_chunk = 16*1024;
+	if (threads<=0) threads = std::max(1u,std::thread::hardware_concurrency());
+	return std::max(1,std::min(threads,count/min_chunk));
+}
+
+template<typename TFunc>
+void parallelChunks(int count, int threads, TFunc f) {
+	threads = chunkThreads(count,threads);
+	int chunk = (count+threads-1)/threads;
+	std::vector<std::thread> workers;
+	for(int i=1;i<threads;++i)
+		workers.emplace_back(f,i*chunk,std::min(count,(i+1)*chunk));
+	f(0,std::min(count,chunk));
+	for(std::thread &w : workers) 
+		w.join();
+}
+
+// angle between two (not normalized) edges
+float cornerAngle(const glm::vec3 &a, const glm::vec3 &b) {
+	return std::atan2(glm::length(glm::cross(a,b)),glm::dot(a,b));
+}
+
+}
+
+void NormalsGenerator::buildAdjacency(const std::vector<int> &triangles, int vertex_count) {
+	m_vertex_count = vertex_count;
+	m_index_count = triangles.size();
+	m_begin.assign(m_vertex_count+1,0);
+	for(int v : triangles) ++m_begin[v+1];
+	for(int v=0;v<m_vertex_count;++v) m_begin[v+1] += m_begin[v];
+	m_corners.resize(triangles.size());
+	std::vector<int> filled(m_begin.begin(),m_begin.end()-1);
+	for(size_t i=0;i<triangles.size();++i) 
+		m_corners[filled[triangles[i]]++] = i;
+}
+
+void NormalsGenerator::generate(const std::vector<glm::vec3> &pos, const std::vector<int> &tris,
+								std::vector<glm::vec3> &normals) 
+{
+	normals.resize(pos.size());
+	if (tris.empty()) { // (each 3 consecutive vertexes are a face)
+		parallelChunks(pos.size()/3,m_threads,[&](int begin, int end) {
+			for(int t=begin;t<end;++t) {
+				glm::vec3 n = glm::cross(pos[3*t+2]-pos[3*t+1],pos[3*t]-pos[3*t+1]);
+				float len = glm::length(n);
+				normals[3*t] = normals[3*t+1] = normals[3*t+2] = len==0.f ? n : n/len;
+			}
+		});
+		return;
+	}
+	// what each corner of face t adds to its vertex
+	bool by_corner = m_weighting==wAngle;
+	auto cornerWeights = [&](int t, glm::vec3 w[3]) {
+		const glm::vec3 &p0 = pos[tris[3*t]], &p1 = pos[tris[3*t+1]], &p2 = pos[tris[3*t+2]];
+		glm::vec3 n = glm::cross(p2-p1,p0-p1);
+		if (m_weighting!=wArea) {
+			float len = glm::length(n);
+			if (len!=0.f) n /= len;
+		}
+		if (by_corner) {
+			float a0 = cornerAngle(p1-p0,p2-p0), a1 = cornerAngle(p2-p1,p0-p1);
+			w[0] = n*a0;
+			w[1] = n*a1;
+			w[2] = n*std::max(0.f,3.14159265f-a0-a1); // (they add up to pi)
+		} else 
+			w[0] = w[1] = w[2] = n;
+	};
+	auto normalize = [&](int begin, int end) {
+		for(int v=begin;v<end;++v) {
+			float len = glm::length(normals[v]);
+			if (len!=0.f) normals[v] /= len;
 		}
-		for(auto &n : normals) 
-			if (glm::dot(n,n)!=0) 
-				n = glm::normalize(n);
+	};
+	
+	// a single thread scatters the faces into their vertexes, which is
+	// faster than gathering and adds every sum in the same (triangles') order
+	if (chunkThreads(pos.size(),m_threads)==1) {
+		std::fill(normals.begin(),normals.end(),glm::vec3(0.f));
+		glm::vec3 w[3];
+		for(size_t t=0;t<tris.size()/3;++t) {
+			cornerWeights(t,w);
+			for(int k=0;k<3;++k) normals[tris[3*t+k]] += w[k];
+		}
+		normalize(0,pos.size());
+		return;
 	}
+	
+	if (m_vertex_count!=int(pos.size()) or m_index_count!=int(tris.size())) buildAdjacency(tris,pos.size());
+	// faces: what each corner adds to its vertex (the same for the three,
+	// and stored once, unless weighted by angle)
+	m_weighted.resize(by_corner ? tris.size() : tris.size()/3);
+	parallelChunks(tris.size()/3,m_threads,[&](int begin, int end) {
+		glm::vec3 w[3];
+		for(int t=begin;t<end;++t) {
+			cornerWeights(t,w);
+			if (by_corner) for(int k=0;k<3;++k) m_weighted[3*t+k] = w[k];
+			else m_weighted[t] = w[0];
+		}
+	});
+	
+	// vertexes: the sum of their corners'
+	parallelChunks(pos.size(),m_threads,[&](int begin, int end) {
+		for(int v=begin;v<end;++v) {
+			glm::vec3 n(0.f);
+			if (by_corner) {
+				for(int i=m_begin[v];i<m_begin[v+1];++i) n += m_weighted[m_corners[i]];
+			} else {
+				for(int i=m_begin[v];i<m_begin[v+1];++i) n += m_weighted[m_corners[i]/3];
+			}
+			normals[v] = n;
+		}
+		normalize(begin,end);
+	});
+}
+
+void Geometry::generateNormals() {
+	NormalsGenerator().generate(*this);
 }
 
@@ -11,27 +11,127 @@ struct Geometry {
 	std::vector<glm::vec3> normals;
 	std::vector<glm::vec2> tex_coords;
 	std::vector<int> triangles;
-	void generateNormals();
+	void generateNormals(); // (with a NormalsGenerator)
 	
 };
 
+// computes the normals of geometries that keep the same triangles, such as
+// one whose vertexes move every frame: the triangles around each vertex are
+// found on the first call, and reused until invalidate() is called (or the
+// vertex or index count changes); then faces and vertexes are processed in chunks by up to
+// threads threads (0 for one per core, fewer for small geometries), each
+// vertex gathering its faces instead of faces scattering into vertexes, so
+// no two threads write the same element (if only one thread would be used,
+// faces scatter, as that's faster and gives the same sums, and the
+// triangles around each vertex are not needed); wArea weights each face by its
+// area (as generateNormals does), wAngle by its corner's angle at the
+// vertex, and wUniform gives all of them the same weight
+class NormalsGenerator {
+public:
+	enum Weighting { wArea, wAngle, wUniform };
+	NormalsGenerator(Weighting weighting=wArea, int threads=0) 
+		: m_weighting(weighting), m_threads(threads) { }
+	// normals of the triangles (indexes into positions, or none if each 3
+	// consecutive positions are a face) at those positions
+	void generate(const std::vector<glm::vec3> &positions, const std::vector<int> &triangles,
+				  std::vector<glm::vec3> &normals);
+	void generate(Geometry &geo) { generate(geo.positions,geo.triangles,geo.normals); }
+	// to be called when the triangles change
+	void invalidate() { m_vertex_count = m_index_count = -1; }
+	void setWeighting(Weighting weighting) { m_weighting = weighting; }
+	Weighting getWeighting() const { return m_weighting; }
+private:
+	void buildAdjacency(const std::vector<int> &triangles, int vertex_count);
+	Weighting m_weighting;
+	int m_threads;
+	int m_vertex_count = -1, m_index_count = -1; // the adjacency was built for
+	std::vector<int> m_begin, m_corners; // corners (3*triangle+k) of each vertex, from m_begin[v] to m_begin[v+1]
+	std::vector<glm::vec3> m_weighted; // weighted face normals, by corner or by face
+};
+
+// non-owning view of the same data as a Geometry (that could be stored
+// somewhere else, such as in a memory-mapped cache file)
+struct GeometryView {
+	const glm::vec3 *positions = nullptr;
+	const glm::vec3 *normals = nullptr; // nullptr if there are no normals
+	const glm::vec2 *tex_coords = nullptr; // nullptr if there are no texture coordinates
+	const int *triangles = nullptr; // nullptr if not indexed
+	int vertex_count = 0, index_count = 0;
+	
+	GeometryView() = default;
+	GeometryView(const Geometry &geo);
+	Geometry copy() const;
+};
+
+// the VAO is configured once, when the buffers are created, for the fixed
+// attribute locations that every Shader binds vertexPosition, vertexNormal
+// and vertexTexCoords to; lInterleaved puts all the attributes in a single
+// buffer (positionsVBO), but then they can't be updated nor appended;
+// lQuantized is also interleaved, but with 16 bytes per vertex instead of 32:
+// positions as 16-bit unorms relative to the bounding box, octahedral
+// normals as 2 16-bit snorms and half-float texture coordinates (the
+// vertex shader decodes them, see shaders/funcs/decodeVertex.vert);
+// static geometry gets the narrowest index type that fits (16 bits with less
+// than 65535 vertexes), and is drawn as primitive-restart strips instead of
+// a triangle list when they take notably fewer indexes (unless strips is
+// false, as drawing index ranges requires a list)
 class GeometryRenderer {
 public:
+	enum Attribute { aPosition=0, aNormal=1, aTexCoords=2 };
+	enum Layout { lSeparate, lInterleaved, lQuantized };
+	
+	// index buffers of every live GeometryRenderer; saved_bytes is what
+	// narrowing and strips save with respect to 32-bit triangle lists, and
+	// transformed the vertexes a FIFO cache of 16 would transform to draw
+	// the triangles of the static ones in the order they were uploaded (so
+	// transformed/triangles is their acmr, see analyzeVertexCache)
+	struct IndexStats {
+		size_t bytes = 0, saved_bytes = 0; int narrowed = 0, strips = 0;
+		size_t triangles = 0, transformed = 0;
+	};
+	static const IndexStats &getIndexStats();
+	
 	GeometryRenderer() = default;
-	GeometryRenderer(const Geometry &geo, bool dynamic=false);
+	GeometryRenderer(const Geometry &geo, bool dynamic=false, Layout layout=lSeparate, bool strips=true);
+	GeometryRenderer(const GeometryView &geo, bool dynamic=false, Layout layout=lSeparate, bool strips=true);
 	GeometryRenderer(GeometryRenderer &&geo);
 	GeometryRenderer &operator=(GeometryRenderer &&geo);
 	void draw() const;
+	// draws only these ranges of the index buffer (first and count in
+	// indexes, of a triangle list), with a single call
+	struct IndexRange { int first, count; };
+	void draw(const std::vector<IndexRange> &ranges) const;
 	GLuint vertexArray() const { return VAO; }
 	GLuint positionsVBO() const { return VBO_pos; }
 	GLuint normalsVBO() const { return VBO_norms; }
 	GLuint texCoordsVBO() const { return VBO_tcs; }
+	bool hasNormals() const { return VBO_norms!=0 or normals_offset!=-1; }
+	bool hasTexCoords() const { return VBO_tcs!=0 or tcs_offset!=-1; }
+	bool isInterleaved() const { return stride!=0; }
+	bool isQuantized() const { return quantized; }
+	GLenum indexType() const { return index_type; } // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	bool isStrip() const { return mode==GL_TRIANGLE_STRIP; }
+	// to decode quantized positions: offset+position*scale
+	glm::vec3 positionsOffset() const { return positions_offset; }
+	glm::vec3 positionsScale() const { return positions_scale; }
+	
+	// makes the VAO feed these attribute locations (-1 for unused ones); it
+	// is only reconfigured if it was set for different ones, so with the
+	// fixed locations this does nothing
+	void useAttributes(GLint loc_pos, GLint loc_norm, GLint loc_tc) const;
 	
 	void updateTexCoords(const std::vector<glm::vec2> &vtc, bool realloc=false, bool dynamic=false);
 	void updatePositions(const std::vector<glm::vec3> &vp, bool realloc=false, bool dynamic=false);
 	void updateNormals(const std::vector<glm::vec3> &vn, bool realloc=false, bool dynamic=false);
 	void updateElements(const std::vector<int> &ve, bool realloc=false, bool dynamic=false);
 	
+	// appends the vertexes and triangles of geo after the current ones (geo's
+	// indexes must already account for the vertexes that were there); buffers
+	// grow as needed, keeping their names, so the VAO remains valid
+	void append(const GeometryView &geo);
+	// makes room for that many vertexes and indexes, to avoid regrowing
+	void reserve(int vertexes, int indexes);
+	
 	bool isOk() const { return VAO!=0; }
 	
 	~GeometryRenderer();
@@ -39,8 +139,22 @@ private:
 	GeometryRenderer(const GeometryRenderer &) = delete;
 	GeometryRenderer &operator=(const GeometryRenderer &) = default;
 	void freeResources();
+	void setAttributes(GLint loc_pos, GLint loc_norm, GLint loc_tc) const;
+	void uploadInterleaved(const GeometryView &geo, bool dynamic);
+	void uploadQuantized(const GeometryView &geo, bool dynamic);
+	void uploadIndexes(const int *triangles, int index_count, bool dynamic);
 	GLuint VAO=0, VBO_pos=0, VBO_tcs=0, VBO_norms=0, EBO=0;
+	GLsizei stride = 0; // of the interleaved buffer, 0 if not interleaved
+	int normals_offset = -1, tcs_offset = -1; // in the interleaved buffer
+	bool quantized = false;
+	glm::vec3 positions_offset = {0.f,0.f,0.f}, positions_scale = {1.f,1.f,1.f};
+	mutable GLint attrib_locations[3] = {-1,-1,-1}; // the ones the VAO is set for
+	GLenum mode = GL_TRIANGLES, index_type = GL_UNSIGNED_INT;
+	bool allow_strips = true;
+	size_t index_bytes = 0, index_saved_bytes = 0; // (accounted in IndexStats)
+	size_t index_triangles = 0, index_transformed = 0; // (the same)
 	int count = 0;
+	int vertex_count = 0, vertex_capacity = 0, index_capacity = 0;
 };
 
 #endif
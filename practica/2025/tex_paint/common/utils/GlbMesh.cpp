@@ -0,0 +1,360 @@
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <charconv>
+#include <string_view>
+#include <glm/glm.hpp>
+#include "GlbMesh.hpp"
+#include "Debug.hpp"
+#include "Misc.hpp"
+
+namespace {
+
+// minimal json tree, just what is needed to read a glTF's json chunk
+struct Json {
+	enum Type { tNull, tBool, tNumber, tString, tArray, tObject } type = tNull;
+	double number = 0;
+	std::string string;
+	std::vector<std::string> keys; // only for objects, same order as items
+	std::vector<Json> items; // elements of an array, or values of an object
+
+	// missing keys/indexes give a null value, so lookups can be chained
+	const Json &operator[](std::string_view key) const {
+		for(size_t i=0;i<keys.size();++i)
+			if (keys[i]==key) return items[i];
+		return null();
+	}
+	const Json &operator[](size_t i) const { return i<items.size() ? items[i] : null(); }
+	size_t size() const { return items.size(); }
+	bool isNull() const { return type==tNull; }
+	int asInt(int def=-1) const { return type==tNumber ? static_cast<int>(number) : def; }
+	float asFloat(float def) const { return type==tNumber ? static_cast<float>(number) : def; }
+	static const Json &null() { static const Json n; return n; }
+};
+
+class JsonParser {
+public:
+	JsonParser(std::string_view text) : m_text(text) {}
+	Json parse() { return parseValue(0); }
+private:
+	char peek() {
+		while (m_pos<m_text.size() and std::strchr(" \t\r\n",m_text[m_pos])) ++m_pos;
+		cg_assert(m_pos<m_text.size(),"Unexpected end of glTF json");
+		return m_text[m_pos];
+	}
+	bool accept(char c) { if (peek()!=c) return false; ++m_pos; return true; }
+	void expect(char c) { cg_assert(accept(c),"Expected '"<<c<<"' at "<<m_pos<<" in glTF json"); }
+
+	Json parseValue(int depth) {
+		cg_assert(depth<64,"glTF json nested too deep");
+		Json j;
+		char c = peek();
+		if (accept('{')) {
+			j.type = Json::tObject;
+			if (not accept('}')) {
+				do {
+					j.keys.push_back(parseString());
+					expect(':');
+					j.items.push_back(parseValue(depth+1));
+				} while (accept(','));
+				expect('}');
+			}
+		} else if (accept('[')) {
+			j.type = Json::tArray;
+			if (not accept(']')) {
+				do j.items.push_back(parseValue(depth+1)); while (accept(','));
+				expect(']');
+			}
+		} else if (c=='\"') {
+			j.type = Json::tString;
+			j.string = parseString();
+		} else if (m_text.substr(m_pos,4)=="true" or m_text.substr(m_pos,5)=="false") {
+			j.type = Json::tBool;
+			j.number = c=='t';
+			m_pos += c=='t' ? 4 : 5;
+		} else if (m_text.substr(m_pos,4)=="null") {
+			m_pos += 4;
+		} else {
+			j.type = Json::tNumber;
+			auto r = std::from_chars(m_text.data()+m_pos,m_text.data()+m_text.size(),j.number);
+			cg_assert(r.ec==std::errc(),"Invalid value at "<<m_pos<<" in glTF json");
+			m_pos = r.ptr-m_text.data();
+		}
+		return j;
+	}
+
+	// escapes other than the single-char ones are kept as they are (glTF
+	// names and uris are not expected to need them)
+	std::string parseString() {
+		expect('\"');
+		std::string s;
+		while (m_pos<m_text.size() and m_text[m_pos]!='\"') {
+			char c = m_text[m_pos++];
+			if (c=='\\' and m_pos<m_text.size()) {
+				c = m_text[m_pos++];
+				switch (c) {
+					case 'n': c = '\n'; break;
+					case 't': c = '\t'; break;
+					case 'r': c = '\r'; break;
+					case 'b': c = '\b'; break;
+					case 'f': c = '\f'; break;
+					case 'u': s += "\\"; break;
+				}
+			}
+			s += c;
+		}
+		expect('\"');
+		return s;
+	}
+
+	std::string_view m_text;
+	size_t m_pos = 0;
+};
+
+constexpr uint32_t glb_magic = 0x46546C67, json_chunk = 0x4E4F534A, bin_chunk = 0x004E4942;
+enum ComponentType { ctByte=5120, ctUByte=5121, ctShort=5122, ctUShort=5123, ctUInt=5125, ctFloat=5126 };
+
+int getComponentSize(int type) {
+	switch (type) {
+		case ctByte: case ctUByte: return 1;
+		case ctShort: case ctUShort: return 2;
+		case ctUInt: case ctFloat: return 4;
+	}
+	cg_error("Invalid glTF component type "<<type);
+}
+
+int getComponentsCount(const std::string &type) {
+	if (type=="SCALAR") return 1;
+	if (type=="VEC2") return 2;
+	if (type=="VEC3") return 3;
+	if (type=="VEC4") return 4;
+	cg_error("Unsupported glTF accessor type "<<type);
+}
+
+// an accessor resolved to where its elements are in the binary chunk
+struct Accessor {
+	const char *data = nullptr;
+	size_t count = 0, stride = 0;
+	int component_type = 0, components = 0;
+	bool normalized = false;
+
+	bool isTight(int type, int n) const {
+		return component_type==type and components==n
+			and stride==size_t(n*getComponentSize(type))
+			and reinterpret_cast<uintptr_t>(data)%getComponentSize(type)==0;
+	}
+
+	float get(size_t i, int c) const {
+		const char *p = data+i*stride+c*getComponentSize(component_type);
+		auto read = [p](auto v) { std::memcpy(&v,p,sizeof(v)); return v; };
+		switch (component_type) {
+			case ctFloat: return read(float());
+			case ctByte: { float v = read(int8_t()); return normalized ? std::max(v/127.f,-1.f) : v; }
+			case ctUByte: { float v = read(uint8_t()); return normalized ? v/255.f : v; }
+			case ctShort: { float v = read(int16_t()); return normalized ? std::max(v/32767.f,-1.f) : v; }
+			case ctUShort: { float v = read(uint16_t()); return normalized ? v/65535.f : v; }
+			default: return static_cast<float>(read(uint32_t()));
+		}
+	}
+	uint32_t getIndex(size_t i) const {
+		const char *p = data+i*stride;
+		switch (component_type) {
+			case ctUByte: { uint8_t v; std::memcpy(&v,p,1); return v; }
+			case ctUShort: { uint16_t v; std::memcpy(&v,p,2); return v; }
+			default: { uint32_t v; std::memcpy(&v,p,4); return v; }
+		}
+	}
+};
+
+Accessor getAccessor(const Json &json, std::string_view bin, int index) {
+	const Json &ja = json["accessors"][index];
+	cg_assert(not ja.isNull(),"Missing glTF accessor "<<index);
+	cg_assert(ja["sparse"].isNull(),"Sparse glTF accessors are not supported");
+	const Json &jv = json["bufferViews"][ja["bufferView"].asInt()];
+	cg_assert(not jv.isNull(),"glTF accessor "<<index<<" has no buffer view");
+	cg_assert(jv["buffer"].asInt()==0 and json["buffers"][0]["uri"].isNull(),
+			  "Only glb files with a single embedded buffer are supported");
+	Accessor a;
+	a.count = ja["count"].asInt(0);
+	a.component_type = ja["componentType"].asInt(0);
+	a.components = getComponentsCount(ja["type"].string);
+	a.normalized = ja["normalized"].number!=0;
+	size_t element_size = a.components*getComponentSize(a.component_type);
+	a.stride = jv["byteStride"].asInt(0);
+	if (a.stride==0) a.stride = element_size;
+	size_t offset = size_t(jv["byteOffset"].asInt(0))+size_t(ja["byteOffset"].asInt(0));
+	size_t view_end = size_t(jv["byteOffset"].asInt(0))+size_t(jv["byteLength"].asInt(0));
+	cg_assert(view_end<=bin.size() and (a.count==0 or offset+(a.count-1)*a.stride+element_size<=view_end),
+			  "glTF accessor "<<index<<" is out of its buffer");
+	a.data = bin.data()+offset;
+	return a;
+}
+
+// returns a node's local transform
+glm::mat4 getNodeMatrix(const Json &node) {
+	const Json &m = node["matrix"];
+	if (m.size()==16) {
+		glm::vec4 c[4];
+		for(int i=0;i<16;++i) c[i/4][i%4] = m[i].asFloat(0.f);
+		return glm::mat4(c[0],c[1],c[2],c[3]);
+	}
+	const Json &t = node["translation"], &r = node["rotation"], &s = node["scale"];
+	float x = r[0].asFloat(0.f), y = r[1].asFloat(0.f), z = r[2].asFloat(0.f), w = r[3].asFloat(1.f);
+	glm::vec3 rx(1-2*(y*y+z*z), 2*(x*y+w*z), 2*(x*z-w*y));
+	glm::vec3 ry(2*(x*y-w*z), 1-2*(x*x+z*z), 2*(y*z+w*x));
+	glm::vec3 rz(2*(x*z+w*y), 2*(y*z-w*x), 1-2*(x*x+y*y));
+	return glm::mat4(glm::vec4(rx*s[0].asFloat(1.f),0.f),
+					 glm::vec4(ry*s[1].asFloat(1.f),0.f),
+					 glm::vec4(rz*s[2].asFloat(1.f),0.f),
+					 glm::vec4(t[0].asFloat(0.f),t[1].asFloat(0.f),t[2].asFloat(0.f),1.f));
+}
+
+bool isIdentity(const glm::mat4 &m) {
+	for(int i=0;i<4;++i)
+		for(int j=0;j<4;++j)
+			if (m[i][j]!=(i==j?1.f:0.f)) return false;
+	return true;
+}
+
+// base color and emissive map directly; specular exponent is the inverse of
+// what blender's obj exporter does with the roughness
+Material getMaterial(const Json &json, int index, const std::string &folder) {
+	Material m;
+	const Json &jm = json["materials"][index];
+	const Json &pbr = jm["pbrMetallicRoughness"];
+	const Json &color = pbr["baseColorFactor"];
+	m.kd = m.ka = { color[0].asFloat(1.f), color[1].asFloat(1.f), color[2].asFloat(1.f) };
+	m.opacity = color[3].asFloat(1.f);
+	const Json &emissive = jm["emissiveFactor"];
+	m.ke = { emissive[0].asFloat(0.f), emissive[1].asFloat(0.f), emissive[2].asFloat(0.f) };
+	float roughness = pbr["roughnessFactor"].asFloat(1.f);
+	m.shininess = (1.f-roughness)*(1.f-roughness)*1000.f;
+	const Json &texture = json["textures"][pbr["baseColorTexture"]["index"].asInt()];
+	const Json &image = json["images"][texture["source"].asInt()];
+	if (image["uri"].type==Json::tString and not startsWith(image["uri"].string,"data:"))
+		m.texture = folder+image["uri"].string;
+	else if (not image.isNull())
+		cg_info("Embedded glTF images are not supported, ignoring texture for material "+std::to_string(index));
+	return m;
+}
+
+}
+
+GlbMesh::GlbMesh(const std::string &path) : m_file(path) {
+	cg_assert(m_file.isOk(),"Could not open glb file: "+path);
+	auto readU32 = [&](size_t offset) {
+		uint32_t v = 0;
+		if (offset+4<=m_file.size()) std::memcpy(&v,m_file.data()+offset,4);
+		return v;
+	};
+	cg_assert(readU32(0)==glb_magic and readU32(4)==2,"Not a glTF 2.0 binary file: "+path);
+
+	std::string_view json_text, bin;
+	for(size_t offset=12; offset+8<=m_file.size(); ) {
+		size_t length = readU32(offset), type = readU32(offset+4);
+		cg_assert(offset+8+length<=m_file.size(),"Truncated glb file: "+path);
+		if (type==json_chunk and json_text.empty()) json_text = {m_file.data()+offset+8,length};
+		else if (type==bin_chunk and bin.empty()) bin = {m_file.data()+offset+8,length};
+		offset += 8+((length+3)&~size_t(3));
+	}
+	cg_assert(not json_text.empty(),"Missing json chunk in glb file: "+path);
+	Json json = JsonParser(json_text).parse();
+	std::string folder = extractFolder(path);
+
+	auto addMesh = [&](const Json &mesh, const std::string &name, const glm::mat4 &matrix) {
+		bool identity = isIdentity(matrix);
+		glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(matrix)));
+
+		// returns the accessor as T[count], pointing into the file if it
+		// needs no conversion nor transformation
+		enum Transform { tNone, tPoint, tNormal };
+		auto getArray = [&](const Accessor &a, auto *type, int components, Transform transform) {
+			using T = std::remove_const_t<std::remove_pointer_t<decltype(type)>>;
+			if ((identity or transform==tNone) and a.isTight(ctFloat,components))
+				return reinterpret_cast<const T*>(a.data);
+			auto &buffer = m_converted.emplace_back(a.count*sizeof(T));
+			T *v = reinterpret_cast<T*>(buffer.data());
+			for(size_t i=0;i<a.count;++i)
+				for(int c=0;c<components;++c)
+					v[i][c] = c<a.components ? a.get(i,c) : 0.f;
+			if constexpr (std::is_same_v<T,glm::vec3>) {
+				if (not identity and transform!=tNone) {
+					for(size_t i=0;i<a.count;++i)
+						v[i] = transform==tNormal ? glm::normalize(normal_matrix*v[i])
+							                      : glm::vec3(matrix*glm::vec4(v[i],1.f));
+				}
+			}
+			return static_cast<const T*>(v);
+		};
+
+		for(size_t i=0;i<mesh["primitives"].size();++i) {
+			const Json &primitive = mesh["primitives"][i];
+			if (primitive["mode"].asInt(4)!=4) {
+				cg_info("Ignoring non-triangles glTF primitive in "+mesh["name"].string);
+				continue;
+			}
+			const Json &attributes = primitive["attributes"];
+			cg_assert(not attributes["POSITION"].isNull(),"glTF primitive without positions");
+			Part part;
+			part.name = name;
+			part.material = getMaterial(json,primitive["material"].asInt(),folder);
+			GeometryView &g = part.geometry;
+
+			Accessor positions = getAccessor(json,bin,attributes["POSITION"].asInt());
+			g.vertex_count = positions.count;
+			g.positions = getArray(positions,g.positions,3,tPoint);
+			// the other attributes are read for as many vertexes as there are positions
+			auto getAttribute = [&](const char *attribute) {
+				Accessor a = getAccessor(json,bin,attributes[attribute].asInt());
+				cg_assert(a.count==positions.count,std::string("glTF ")+attribute+" count differs from POSITION's in "+path);
+				return a;
+			};
+			if (not attributes["NORMAL"].isNull())
+				g.normals = getArray(getAttribute("NORMAL"),g.normals,3,tNormal);
+			if (not attributes["TEXCOORD_0"].isNull())
+				g.tex_coords = getArray(getAttribute("TEXCOORD_0"),g.tex_coords,2,tNone);
+			if (not primitive["indices"].isNull()) {
+				Accessor indices = getAccessor(json,bin,primitive["indices"].asInt());
+				g.index_count = indices.count;
+				if (indices.isTight(ctUInt,1)) {
+					g.triangles = reinterpret_cast<const int*>(indices.data);
+				} else {
+					auto &buffer = m_converted.emplace_back(indices.count*sizeof(int));
+					int *v = reinterpret_cast<int*>(buffer.data());
+					for(size_t j=0;j<indices.count;++j) v[j] = indices.getIndex(j);
+					g.triangles = v;
+				}
+				// every index, as the accessor's max (if any) is not the data itself
+				// (unsigned ones above INT_MAX are negative here)
+				for(int j=0;j<g.index_count;++j)
+					cg_assert(0<=g.triangles[j] and g.triangles[j]<g.vertex_count,"glTF index out of range in "+path);
+			}
+			m_parts.push_back(std::move(part));
+		}
+	};
+
+	// the default scene's nodes, or every mesh if there are no scenes
+	const Json &scene = json["scenes"][json["scene"].asInt(0)];
+	if (scene.isNull()) {
+		for(size_t i=0;i<json["meshes"].size();++i)
+			addMesh(json["meshes"][i],json["meshes"][i]["name"].string,glm::mat4(1.f));
+	} else {
+		// depth first, in the file's order (children pushed in reverse)
+		std::vector<std::pair<int,glm::mat4>> stack;
+		for(size_t i=scene["nodes"].size();i>0;--i)
+			stack.emplace_back(scene["nodes"][i-1].asInt(),glm::mat4(1.f));
+		for(size_t visited=0; not stack.empty(); ++visited) {
+			cg_assert(visited<=json["nodes"].size(),"Cycle in glTF nodes: "+path);
+			auto [index, parent] = stack.back();
+			stack.pop_back();
+			const Json &node = json["nodes"][index];
+			glm::mat4 matrix = parent*getNodeMatrix(node);
+			const Json &mesh = json["meshes"][node["mesh"].asInt()];
+			if (not mesh.isNull())
+				addMesh(mesh,node["name"].isNull()?mesh["name"].string:node["name"].string,matrix);
+			for(size_t i=node["children"].size();i>0;--i)
+				stack.emplace_back(node["children"][i-1].asInt(),matrix);
+		}
+	}
+}
+
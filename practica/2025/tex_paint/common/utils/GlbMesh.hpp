@@ -0,0 +1,39 @@
+#ifndef GLB_MESH_HPP
+#define GLB_MESH_HPP
+#include <string>
+#include <vector>
+#include "Geometry.hpp"
+#include "Material.hpp"
+#include "MappedFile.hpp"
+
+// binary glTF 2.0 (.glb) file, mapped in memory: every triangles primitive of
+// the default scene becomes a part whose arrays point straight into the
+// binary chunk, so they can be uploaded with no per-vertex work; only what a
+// GeometryView can't point to (interleaved or non-float attributes, 8/16-bit
+// indexes, or a node with a transform) is converted into a copy; note that
+// glTF's texture coordinates have v=0 on the top row of the image (obj's on
+// the bottom one), so their textures must be loaded with Texture::fY0OnTop
+class GlbMesh {
+public:
+	struct Part {
+		std::string name; // the node's, or the mesh's if the node has none
+		Material material; // pbr parameters approximated with phong ones
+		GeometryView geometry;
+	};
+
+	// throws if the file can't be opened or is not a valid glb
+	GlbMesh(const std::string &path);
+	bool isOk() const { return not m_parts.empty(); }
+	const std::vector<Part> &getParts() const { return m_parts; }
+
+	// how many arrays had to be copied instead of pointing into the file
+	int getConvertedCount() const { return m_converted.size(); }
+
+private:
+	MappedFile m_file;
+	std::vector<Part> m_parts;
+	std::vector<std::vector<char>> m_converted;
+};
+
+#endif
+
@@ -0,0 +1,80 @@
+#include <map>
+#include "GpuMemory.hpp"
+#include "Window.hpp"
+#include "Debug.hpp"
+
+namespace {
+
+struct Allocation { const char *owner; size_t bytes; };
+using Allocations = std::map<std::pair<int,GLuint>,Allocation>;
+
+// never destroyed, since global objects may release theirs after main returns
+Allocations &getAllocations() {
+	static Allocations *allocations = new Allocations;
+	return *allocations;
+}
+
+template<typename TFilter>
+GpuMemory::Usage sumUsage(TFilter filter) {
+	GpuMemory::Usage usage;
+	for(const auto &p : getAllocations()) {
+		if (not filter(p.first.first,p.second)) continue;
+		usage.bytes += p.second.bytes;
+		++usage.objects;
+	}
+	return usage;
+}
+
+}
+
+void GpuMemory::track(Category category, GLuint id, const char *owner, size_t bytes) {
+	cg_assert(id!=0,"Tracking a GL object that was not created");
+	getAllocations()[{category,id}] = {owner,bytes};
+}
+
+void GpuMemory::release(Category category, GLuint id) {
+	getAllocations().erase({category,id});
+}
+
+GpuMemory::Usage GpuMemory::getUsage() {
+	return sumUsage([](int, const Allocation &) { return true; });
+}
+
+GpuMemory::Usage GpuMemory::getUsage(Category category) {
+	return sumUsage([&](int c, const Allocation &) { return c==category; });
+}
+
+GpuMemory::Usage GpuMemory::getUsage(Category category, const std::string &owner) {
+	return sumUsage([&](int c, const Allocation &a) { return c==category and owner==a.owner; });
+}
+
+std::vector<std::pair<std::string,GpuMemory::Usage>> GpuMemory::getOwners(Category category) {
+	std::map<std::string,Usage> owners;
+	for(const auto &p : getAllocations()) {
+		if (p.first.first!=category) continue;
+		Usage &usage = owners[p.second.owner];
+		usage.bytes += p.second.bytes;
+		++usage.objects;
+	}
+	return {owners.begin(),owners.end()};
+}
+
+const char *GpuMemory::getCategoryName(Category category) {
+	static const char *names[cCount] = { "buffers", "textures", "framebuffers" };
+	return names[category];
+}
+
+void GpuMemory::addImGuiSettings() {
+	Usage total = getUsage();
+	if (not ImGui::TreeNode("gpu memory","GPU memory: %.2f MB in %i objects",total.bytes/1048576.0,total.objects))
+		return;
+	for(int c=0;c<cCount;++c) {
+		Category category = static_cast<Category>(c);
+		Usage usage = getUsage(category);
+		ImGui::Text("%s: %.2f MB (%i)",getCategoryName(category),usage.bytes/1048576.0,usage.objects);
+		for(const auto &owner : getOwners(category))
+			ImGui::BulletText("%s: %.2f MB (%i)",owner.first.c_str(),owner.second.bytes/1048576.0,owner.second.objects);
+	}
+	ImGui::TreePop();
+}
+
@@ -0,0 +1,36 @@
+#ifndef GPU_MEMORY_HPP
+#define GPU_MEMORY_HPP
+#include <string>
+#include <vector>
+#include <utility>
+#include <glad/glad.h>
+
+// registry of the GL memory allocated by the utils' classes, by category and
+// owner (the class that allocated it): every allocation site reports the
+// size of the object it (re)specified, and every deletion releases it, so an
+// objects count that keeps growing points to a leak; sizes are what was
+// requested to GL (drivers may pad them); only for the context thread, as
+// the allocations themselves
+class GpuMemory {
+public:
+	enum Category { cBuffer, cTexture, cFramebuffer, cCount };
+	struct Usage { size_t bytes = 0; int objects = 0; };
+
+	// id is the GL name, so tracking the same object again updates its size;
+	// owner must be a string literal (it is kept as a pointer)
+	static void track(Category category, GLuint id, const char *owner, size_t bytes);
+	static void release(Category category, GLuint id);
+
+	static Usage getUsage(); // all the categories
+	static Usage getUsage(Category category);
+	static Usage getUsage(Category category, const std::string &owner);
+	// (sorted by name)
+	static std::vector<std::pair<std::string,Usage>> getOwners(Category category);
+	static const char *getCategoryName(Category category);
+
+	// a tree node with the usage of each category and owner
+	static void addImGuiSettings();
+};
+
+#endif
+
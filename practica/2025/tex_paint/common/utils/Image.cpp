@@ -1,10 +1,14 @@
 #include <stb_image.h>
 #include "Image.hpp"
 #include "Debug.hpp"
+#include "MappedFile.hpp"
 
 Image::Image(const std::string &fname, bool flipY) {
 	stbi_set_flip_vertically_on_load(flipY); // tell stb_image.h to flip loaded texture's on the y-axis.
-	m_data = stbi_load(fname.c_str(), &m_width, &m_height, &m_channels, 0);
+	MappedFile file(fname); // maybe from an Archive
+	cg_assert(file.isOk(),"Could not open texture: "+fname);
+	m_data = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.data()), file.size(),
+								   &m_width, &m_height, &m_channels, 0);
 	cg_assert(m_data,"Could not load texture: "+fname);
 }
 
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include "MappedFile.hpp"
+#include "Archive.hpp"
+
+#ifdef _WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
+
+static const char empty_file[] = "";
+
+#ifdef _WIN32
+
+void MappedFile::map(const std::string &fname) {
+	HANDLE file = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+							  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file==INVALID_HANDLE_VALUE) return;
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file,&size)) {
+		if (size.QuadPart==0) {
+			m_data = empty_file;
+		} else {
+			HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping) {
+				m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				if (m_data) { m_size = size.QuadPart; m_handle = mapping; }
+				else CloseHandle(mapping);
+			}
+		}
+	}
+	CloseHandle(file);
+}
+
+void MappedFile::discard(size_t end) {
+	if (m_in_archive) return;
+	// unlocking pages that are not locked removes them from the working set
+	if (m_size and end>0) VirtualUnlock(const_cast<char*>(m_data), std::min(end,m_size));
+}
+
+void MappedFile::unmap() {
+	if (m_size and not m_in_archive) {
+		UnmapViewOfFile(m_data);
+		CloseHandle(static_cast<HANDLE>(m_handle));
+	}
+	m_data = nullptr; m_size = 0; m_handle = nullptr; m_in_archive = false;
+}
+
+#else
+
+void MappedFile::map(const std::string &fname) {
+	int fd = open(fname.c_str(), O_RDONLY);
+	if (fd==-1) return;
+	struct stat st;
+	if (fstat(fd,&st)==0) {
+		if (st.st_size==0) {
+			m_data = empty_file;
+		} else {
+			void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p!=MAP_FAILED) {
+				madvise(p, st.st_size, MADV_SEQUENTIAL);
+				m_data = static_cast<const char*>(p);
+				m_size = st.st_size;
+			}
+		}
+	}
+	close(fd); // the mapping remains valid after closing the descriptor
+}
+
+void MappedFile::discard(size_t end) {
+	if (m_in_archive) return; // could be a decompressed copy, not a file mapping
+	static const size_t page_size = sysconf(_SC_PAGESIZE);
+	end = std::min(end,m_size)/page_size*page_size; // only whole pages
+	if (end) madvise(const_cast<char*>(m_data), end, MADV_DONTNEED);
+}
+
+void MappedFile::unmap() {
+	if (m_size and not m_in_archive) munmap(const_cast<char*>(m_data), m_size);
+	m_data = nullptr; m_size = 0; m_handle = nullptr; m_in_archive = false;
+}
+
+#endif
+
+MappedFile::MappedFile(const std::string &fname) {
+	std::string_view contents;
+	if (Archive::find(fname,contents)) {
+		m_data = contents.data(); m_size = contents.size();
+		m_in_archive = true;
+	} else
+		map(fname);
+}
+
+MappedFile::MappedFile(MappedFile &&other) {
+	*this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) {
+	if (this==&other) return *this;
+	unmap();
+	m_data = other.m_data;     other.m_data = nullptr;
+	m_size = other.m_size;     other.m_size = 0;
+	m_handle = other.m_handle; other.m_handle = nullptr;
+	m_in_archive = other.m_in_archive; other.m_in_archive = false;
+	return *this;
+}
+
+MappedFile::~MappedFile() {
+	unmap();
+}
+
@@ -0,0 +1,39 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+#include <string>
+#include <string_view>
+
+// read-only view of a whole file mapped in memory (no copies, no
+// per-line allocations); isOk() is false if the file could not be opened;
+// if an Archive is mounted and has the file, the view points into it
+class MappedFile {
+public:
+	MappedFile() = default;
+	MappedFile(const std::string &fname);
+	MappedFile(MappedFile &&other);
+	MappedFile &operator=(MappedFile &&other);
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	~MappedFile();
+
+	const char *data() const { return m_data; }
+	size_t size() const { return m_size; }
+	std::string_view view() const { return {m_data,m_size}; }
+	bool isOk() const { return m_data!=nullptr; }
+	bool isInArchive() const { return m_in_archive; }
+	
+	// hints that [0,end) won't be read again, so its pages can leave the
+	// working set (they are reloaded from the file if they are read anyway)
+	void discard(size_t end);
+
+private:
+	void map(const std::string &fname);
+	void unmap();
+	const char *m_data = nullptr;
+	size_t m_size = 0;
+	void *m_handle = nullptr; // file mapping handle (only used on Windows)
+	bool m_in_archive = false; // then the data is owned by the Archive
+};
+
+#endif
+
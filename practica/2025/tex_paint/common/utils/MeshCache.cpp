@@ -0,0 +1,258 @@
+#include <fstream>
+#include <cstring>
+#include <filesystem>
+#include <climits>
+#include "MeshCache.hpp"
+#include "Debug.hpp"
+#include "Archive.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// file layout: FileHeader, then sources_count times (SourceHeader + path),
+// then parts_count times (PartHeader + name + texture + positions + normals
+// + tex_coords + triangles + clusters); every block is padded to a multiple of 8 bytes,
+// so the headers after a name or path are still aligned for their 64 bits fields
+
+struct FileHeader {
+	char magic[8];
+	uint32_t version, flags;
+	float weld_epsilon; uint32_t padding;
+	uint32_t sources_count, parts_count;
+};
+
+struct SourceHeader {
+	uint64_t size, hash;
+	int64_t mtime;
+	uint32_t path_length, padding;
+};
+
+struct PartHeader {
+	float ka[3], kd[3], ks[3], ke[3];
+	float shininess, opacity;
+	uint32_t name_length, texture_length;
+	uint32_t vertex_count, index_count;
+	uint32_t has_normals, has_tex_coords;
+	uint32_t cluster_count, padding;
+};
+
+const char cache_magic[8] = { 'C','G','M','E','S','H','\0','\0' };
+
+constexpr size_t block_alignment = 8;
+static_assert(alignof(SourceHeader)<=block_alignment and alignof(PartHeader)<=block_alignment
+			  and sizeof(FileHeader)%block_alignment==0,"Misaligned cache blocks");
+
+size_t padded(size_t n) { return (n+block_alignment-1)&~(block_alignment-1); }
+
+uint64_t hashData(const char *data, size_t size) { // FNV-1a
+	uint64_t h = 14695981039346656037ull;
+	for(size_t i=0;i<size;++i)
+		h = (h^static_cast<unsigned char>(data[i]))*1099511628211ull;
+	return h;
+}
+
+// the stats of the file that MappedFile would read (maybe an Archive's)
+bool getFileStats(const std::string &path, uint64_t &size, int64_t &mtime) {
+	if (Archive::getFileStats(path,size,mtime)) return true;
+	std::error_code ec;
+	size = fs::file_size(path,ec);
+	if (ec) return false;
+	mtime = fs::last_write_time(path,ec).time_since_epoch().count();
+	return not ec;
+}
+
+// sequential reader over the mapped cache that fails instead of reading
+// past the end of the file
+class Reader {
+public:
+	Reader(const MappedFile &file) : m_p(file.data()), m_end(file.data()+file.size()) {}
+	template<typename T> const T *get(size_t count=1) {
+		size_t bytes = padded(count*sizeof(T));
+		if (static_cast<size_t>(m_end-m_p)<bytes) { m_ok = false; return nullptr; }
+		auto ret = reinterpret_cast<const T*>(m_p);
+		m_p += bytes;
+		return ret;
+	}
+	bool isOk() const { return m_ok; }
+private:
+	const char *m_p, *m_end;
+	bool m_ok = true;
+};
+
+// mtime is the source's current one, that may differ from the stored one
+// even if it is up to date (touched but not modified)
+bool isSourceUpToDate(const SourceHeader &source, const std::string &path, int64_t &mtime) {
+	uint64_t size;
+	if (not getFileStats(path,size,mtime) or size!=source.size) return false;
+	if (mtime==source.mtime) return true;
+	MappedFile file(path);
+	return file.isOk() and hashData(file.data(),file.size())==source.hash;
+}
+
+template<typename T>
+void writeBlock(std::ofstream &fout, const T *data, size_t count) {
+	static const char zeros[block_alignment] = {};
+	size_t bytes = count*sizeof(T);
+	fout.write(reinterpret_cast<const char*>(data),bytes);
+	fout.write(zeros,padded(bytes)-bytes);
+}
+
+}
+
+std::string MeshCache::getCachePath(const std::string &obj_path) {
+	std::string path = obj_path;
+	size_t p = path.rfind('.');
+	if (p!=std::string::npos and path.find_first_of("/\\",p)==std::string::npos)
+		path.erase(p);
+	return path+".cgmesh";
+}
+
+MeshCache::MeshCache(const std::string &obj_path, uint32_t flags, float weld_epsilon)
+	: m_file(getCachePath(obj_path)), m_path(getCachePath(obj_path))
+{
+	if (not m_file.isOk()) return;
+	Reader reader(m_file);
+
+	auto header = reader.get<FileHeader>();
+	if (not header or std::memcmp(header->magic,cache_magic,sizeof(cache_magic))!=0
+		or header->version!=version or header->flags!=flags or header->weld_epsilon!=weld_epsilon) return;
+
+	std::vector<std::pair<size_t,int64_t>> touched;
+	for(uint32_t i=0;i<header->sources_count;++i) {
+		auto source = reader.get<SourceHeader>();
+		auto path = source ? reader.get<char>(source->path_length) : nullptr;
+		int64_t mtime;
+		if (not path or not isSourceUpToDate(*source,std::string(path,source->path_length),mtime))
+			return;
+		if (mtime!=source->mtime)
+			touched.emplace_back(reinterpret_cast<const char*>(&source->mtime)-m_file.data(),mtime);
+	}
+
+	std::vector<Part> parts(header->parts_count);
+	for(Part &part : parts) {
+		auto ph = reader.get<PartHeader>();
+		if (not ph) return;
+		Material &m = part.material;
+		m.ka = {ph->ka[0],ph->ka[1],ph->ka[2]};
+		m.kd = {ph->kd[0],ph->kd[1],ph->kd[2]};
+		m.ks = {ph->ks[0],ph->ks[1],ph->ks[2]};
+		m.ke = {ph->ke[0],ph->ke[1],ph->ke[2]};
+		m.shininess = ph->shininess;
+		m.opacity = ph->opacity;
+		auto name = reader.get<char>(ph->name_length);
+		auto texture = reader.get<char>(ph->texture_length);
+		GeometryView &g = part.geometry;
+		if (ph->vertex_count>INT_MAX or ph->index_count>INT_MAX or ph->index_count%3) return;
+		g.vertex_count = ph->vertex_count;
+		g.index_count = ph->index_count;
+		g.positions = reader.get<glm::vec3>(g.vertex_count);
+		if (ph->has_normals) g.normals = reader.get<glm::vec3>(g.vertex_count);
+		if (ph->has_tex_coords) g.tex_coords = reader.get<glm::vec2>(g.vertex_count);
+		if (g.index_count) g.triangles = reader.get<int>(g.index_count);
+		auto clusters = reader.get<int>(ph->cluster_count);
+		if (not reader.isOk()) return;
+		// (every index, as the file may be damaged)
+		for(int i=0;i<g.index_count;++i)
+			if (g.triangles[i]<0 or g.triangles[i]>=g.vertex_count) return;
+		for(uint32_t i=0;i<ph->cluster_count;++i)
+			if (clusters[i]<0 or clusters[i]>=g.index_count/3 or (i and clusters[i]<=clusters[i-1])) return;
+		part.clusters.assign(clusters,clusters+ph->cluster_count);
+		part.name.assign(name,ph->name_length);
+		m.texture.assign(texture,ph->texture_length);
+	}
+	m_parts = std::move(parts);
+	// archives are read-only, so those sources will be hashed again
+	if (not m_file.isInArchive()) m_touched = std::move(touched);
+	cg_info("Using geometry cache: "+getCachePath(obj_path));
+}
+
+MeshCache::~MeshCache() {
+	if (m_touched.empty()) return;
+	// stores the new mtimes, so the sources are hashed only once after
+	// being touched; it's done here because the file can't be written while
+	// it's mapped on every system
+	m_file = MappedFile();
+	std::fstream fio(m_path,std::ios::binary|std::ios::in|std::ios::out);
+	for(const auto &t : m_touched) {
+		fio.seekp(t.first);
+		fio.write(reinterpret_cast<const char*>(&t.second),sizeof(t.second));
+	}
+	if (not fio) cg_info("Could not update the source mtimes in "+m_path);
+}
+
+bool MeshCache::write(const std::string &obj_path, uint32_t flags, float weld_epsilon,
+					  const std::vector<std::string> &sources,
+					  const std::vector<std::string> &names,
+					  const std::vector<Geometry> &geometries,
+					  const std::vector<Material> &materials,
+					  const std::vector<std::vector<int>> &clusters)
+{
+	cg_assert(names.size()==geometries.size() and materials.size()==geometries.size(),
+			  "Wrong number of names or materials for MeshCache");
+	std::string cache_path = getCachePath(obj_path), tmp_path = cache_path+".tmp";
+	std::ofstream fout(tmp_path,std::ios::binary|std::ios::trunc);
+	if (not fout.is_open()) return false;
+	
+	auto writeAll = [&]() {
+		FileHeader header;
+		std::memcpy(header.magic,cache_magic,sizeof(cache_magic));
+		header.version = version;
+		header.flags = flags;
+		header.weld_epsilon = weld_epsilon;
+		header.padding = 0;
+		header.sources_count = sources.size();
+		header.parts_count = geometries.size();
+		writeBlock(fout,&header,1);
+		
+		for(const std::string &path : sources) {
+			SourceHeader source{};
+			MappedFile file(path);
+			if (not file.isOk() or not getFileStats(path,source.size,source.mtime)) return false;
+			source.hash = hashData(file.data(),file.size());
+			source.path_length = path.size();
+			writeBlock(fout,&source,1);
+			writeBlock(fout,path.data(),path.size());
+		}
+		
+		for(size_t i=0;i<geometries.size();++i) {
+			const Geometry &g = geometries[i];
+			const Material &m = materials[i];
+			static const std::vector<int> no_clusters;
+			const std::vector<int> &c = i<clusters.size() ? clusters[i] : no_clusters;
+			PartHeader ph{};
+			for(int j=0;j<3;++j) {
+				ph.ka[j] = m.ka[j]; ph.kd[j] = m.kd[j];
+				ph.ks[j] = m.ks[j]; ph.ke[j] = m.ke[j];
+			}
+			ph.shininess = m.shininess;
+			ph.opacity = m.opacity;
+			ph.name_length = names[i].size();
+			ph.texture_length = m.texture.size();
+			ph.vertex_count = g.positions.size();
+			ph.index_count = g.triangles.size();
+			ph.has_normals = not g.normals.empty();
+			ph.has_tex_coords = not g.tex_coords.empty();
+			ph.cluster_count = c.size();
+			writeBlock(fout,&ph,1);
+			writeBlock(fout,names[i].data(),names[i].size());
+			writeBlock(fout,m.texture.data(),m.texture.size());
+			writeBlock(fout,g.positions.data(),g.positions.size());
+			writeBlock(fout,g.normals.data(),g.normals.size());
+			writeBlock(fout,g.tex_coords.data(),g.tex_coords.size());
+			writeBlock(fout,g.triangles.data(),g.triangles.size());
+			writeBlock(fout,c.data(),c.size());
+		}
+		return static_cast<bool>(fout);
+	};
+	bool ok = writeAll();
+	fout.close();
+	
+	// write+rename, so a running instance never maps a half-written cache
+	std::error_code ec;
+	if (ok) fs::rename(tmp_path,cache_path,ec);
+	if (not ok or ec) { fs::remove(tmp_path,ec); return false; }
+	cg_info("Geometry cache written: "+cache_path);
+	return true;
+}
+
@@ -0,0 +1,55 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Geometry.hpp"
+#include "Material.hpp"
+#include "MappedFile.hpp"
+
+// binary cache of the final geometry of every part of an obj file (after
+// parsing, toGeometry, generateNormals and optimizeMesh), and of where its
+// meshlet clusters start (see optimizeMeshlets, if it was used), stored as 
+// name.cgmesh next to the obj; it is discarded when its version, or the flags
+// or the weld epsilon (see cleanMesh) used to build it differ, or when the obj
+// file changes (size and mtime, or hash if only the mtime changed, and then
+// the new mtime is stored when the cache is released and unmapped); caches
+// with indexes out of range are discarded too
+class MeshCache {
+public:
+	static constexpr uint32_t version = 6;
+
+	struct Part {
+		std::string name;
+		Material material;
+		GeometryView geometry; // points into the mapped file
+		std::vector<int> clusters;
+	};
+
+	// maps obj_path's cache, isOk() will be false if it is missing or stale
+	MeshCache(const std::string &obj_path, uint32_t flags, float weld_epsilon);
+	~MeshCache();
+	bool isOk() const { return not m_parts.empty(); }
+	const std::vector<Part> &getParts() const { return m_parts; }
+
+	// (over)writes obj_path's cache, sources are the files the geometry was 
+	// built from (the obj and its mtls), and clusters can be empty (or have
+	// empty vectors); returns false if it could not be written
+	static bool write(const std::string &obj_path, uint32_t flags, float weld_epsilon,
+					  const std::vector<std::string> &sources,
+					  const std::vector<std::string> &names,
+					  const std::vector<Geometry> &geometries,
+					  const std::vector<Material> &materials,
+					  const std::vector<std::vector<int>> &clusters={});
+
+	static std::string getCachePath(const std::string &obj_path);
+
+private:
+	MappedFile m_file;
+	std::vector<Part> m_parts;
+	std::string m_path;
+	std::vector<std::pair<size_t,int64_t>> m_touched; // (offset of a stored mtime, new one)
+};
+
+#endif
+
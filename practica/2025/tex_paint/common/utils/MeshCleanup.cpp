@@ -0,0 +1,126 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "MeshCleanup.hpp"
+
+CleanupStats &CleanupStats::operator+=(const CleanupStats &s) {
+	vertexes_before += s.vertexes_before; vertexes_after += s.vertexes_after;
+	triangles_before += s.triangles_before; triangles_after += s.triangles_after;
+	return *this;
+}
+
+namespace {
+
+// cells are 2*epsilon wide, so anything within epsilon of a point is in
+// its cell or in the neighbour at the side of the half the point is in
+// (side, -1 or +1 for each axis); with epsilon=0 cells are exact positions
+struct Cell { int64_t c[3]; int side[3]; };
+
+Cell getCell(const glm::vec3 &p, float epsilon) {
+	Cell cell;
+	if (epsilon==0.f) {
+		uint32_t bits[3];
+		std::memcpy(bits,&p,sizeof(bits));
+		for(int i=0;i<3;++i) { cell.c[i] = bits[i]; cell.side[i] = 0; }
+		return cell;
+	}
+	for(int i=0;i<3;++i) {
+		double x = p[i]/(2.0*epsilon), f = std::floor(x);
+		cell.c[i] = int64_t(f);
+		cell.side[i] = x-f<0.5 ? -1 : +1;
+	}
+	return cell;
+}
+
+uint64_t hashCell(const Cell &cell, int dx, int dy, int dz) {
+	return uint64_t(cell.c[0]+dx)*73856093u ^ uint64_t(cell.c[1]+dy)*19349663u ^ uint64_t(cell.c[2]+dz)*83492791u;
+}
+
+bool near(const glm::vec2 &a, const glm::vec2 &b, float epsilon) {
+	return std::fabs(a.x-b.x)<=epsilon and std::fabs(a.y-b.y)<=epsilon;
+}
+
+bool near(const glm::vec3 &a, const glm::vec3 &b, float epsilon) {
+	return std::fabs(a.x-b.x)<=epsilon and std::fabs(a.y-b.y)<=epsilon and std::fabs(a.z-b.z)<=epsilon;
+}
+
+}
+
+CleanupStats cleanMesh(Geometry &geo, float epsilon) {
+	CleanupStats stats;
+	stats.vertexes_before = stats.vertexes_after = geo.positions.size();
+	stats.triangles_before = stats.triangles_after = geo.triangles.size()/3;
+	if (geo.triangles.empty()) return stats;
+	const int vertex_count = geo.positions.size();
+	bool normals = not geo.normals.empty(), tex_coords = not geo.tex_coords.empty();
+
+	// weld: each vertex is replaced by the first one before it that is near
+	// enough (searched in the up to 8 cells that can hold it)
+	std::vector<int> weld(vertex_count), next(vertex_count,-1); // (next in the same bucket)
+	std::unordered_map<uint64_t,int> buckets;
+	buckets.reserve(vertex_count);
+	for(int v=0;v<vertex_count;++v) {
+		const glm::vec3 &p = geo.positions[v];
+		Cell cell = getCell(p,epsilon);
+		weld[v] = v;
+		int cells = epsilon==0.f ? 1 : 2; // (per axis)
+		for(int i=0;i<cells and weld[v]==v;++i) {
+			for(int j=0;j<cells and weld[v]==v;++j) {
+				for(int k=0;k<cells and weld[v]==v;++k) {
+					auto it = buckets.find(hashCell(cell,i*cell.side[0],j*cell.side[1],k*cell.side[2]));
+					for(int w = it==buckets.end() ? -1 : it->second;w!=-1;w=next[w]) {
+						if (near(p,geo.positions[w],epsilon)
+							and (not normals or near(geo.normals[v],geo.normals[w],epsilon))
+							and (not tex_coords or near(geo.tex_coords[v],geo.tex_coords[w],epsilon)))
+						{
+							weld[v] = w;
+							break;
+						}
+					}
+				}
+			}
+		}
+		if (weld[v]!=v) continue;
+		int &head = buckets.emplace(hashCell(cell,0,0,0),-1).first->second;
+		next[v] = head;
+		head = v;
+	}
+
+	// drop the triangles that collapsed, or that had no area already
+	std::vector<int> &tris = geo.triangles;
+	float min_area2 = 4.f*epsilon*epsilon*epsilon*epsilon; // (|cross| is twice the area)
+	size_t kept = 0;
+	for(size_t i=0;i<tris.size();i+=3) {
+		int a = weld[tris[i]], b = weld[tris[i+1]], c = weld[tris[i+2]];
+		if (a==b or b==c or c==a) continue;
+		glm::vec3 n = glm::cross(geo.positions[b]-geo.positions[a],geo.positions[c]-geo.positions[a]);
+		if (glm::dot(n,n)<=min_area2) continue;
+		tris[kept] = a; tris[kept+1] = b; tris[kept+2] = c;
+		kept += 3;
+	}
+	tris.resize(kept);
+
+	// compact: the vertexes still used, in their order
+	std::vector<int> remap(vertex_count,-1);
+	for(int v : tris) remap[v] = 0;
+	int count = 0;
+	for(int v=0;v<vertex_count;++v)
+		if (remap[v]!=-1) remap[v] = count++;
+	auto compact = [&](auto &attribute) {
+		if (attribute.empty()) return;
+		for(int v=0;v<vertex_count;++v)
+			if (remap[v]!=-1) attribute[remap[v]] = attribute[v];
+		attribute.resize(count);
+	};
+	compact(geo.positions);
+	compact(geo.normals);
+	compact(geo.tex_coords);
+	for(int &v : tris) v = remap[v];
+
+	stats.vertexes_after = count;
+	stats.triangles_after = tris.size()/3;
+	return stats;
+}
+
@@ -0,0 +1,21 @@
+#ifndef MESH_CLEANUP_HPP
+#define MESH_CLEANUP_HPP
+#include "Geometry.hpp"
+
+// vertex and triangle counts of a geometry before and after cleanMesh
+struct CleanupStats {
+	int vertexes_before = 0, vertexes_after = 0;
+	int triangles_before = 0, triangles_after = 0;
+	CleanupStats &operator+=(const CleanupStats &s);
+};
+
+// welds the vertexes whose positions, normals and texture coordinates are
+// all within epsilon of another one's (found through a hash grid of cells
+// 2*epsilon wide, so only 8 are searched; 0 welds exact copies), so UV and normal seams
+// are kept; then drops the triangles left with a repeated vertex or an
+// area of at most epsilon^2, and the vertexes no triangle uses (keeping
+// the order of the rest); non-indexed geometries are left as they are
+CleanupStats cleanMesh(Geometry &geo, float epsilon=1e-6f);
+
+#endif
+
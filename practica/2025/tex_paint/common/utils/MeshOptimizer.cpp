@@ -0,0 +1,275 @@
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <glm/glm.hpp>
+#include "MeshOptimizer.hpp"
+
+namespace {
+
+// FIFO post-transform cache: a vertex is still in it if less than size
+// misses happened since it was loaded (so a reset is just size+1 misses)
+class FifoCache {
+public:
+	FifoCache(int vertex_count, int size) : m_loaded_at(vertex_count,-size-1), m_size(size) { }
+	int add(int v) { // returns 1 if it was a miss
+		if (m_misses-m_loaded_at[v]<=m_size) return 0;
+		m_loaded_at[v] = ++m_misses;
+		return 1;
+	}
+	int addTriangle(const int *t) { return add(t[0])+add(t[1])+add(t[2]); }
+	void reset() { m_misses += m_size+1; }
+private:
+	std::vector<int> m_loaded_at;
+	int m_misses = 0, m_size;
+};
+
+// Forsyth's scoring
+constexpr int lru_size = 32;
+
+float vertexScore(int cache_position, int remaining_triangles) {
+	if (remaining_triangles==0) return -1.f;
+	float score = 0.f;
+	if (cache_position>=0) // the last triangle's vertexes get a fixed score, so its 3 are equally good
+		score = cache_position<3 ? 0.75f : std::pow(1.f-(cache_position-3)/float(lru_size-3),1.5f);
+	return score + 2.f/std::sqrt(float(remaining_triangles)); // favour finishing almost done vertexes
+}
+
+}
+
+VertexCacheStats analyzeVertexCache(const int *indexes, int index_count, int vertex_count, bool strip, int cache_size) {
+	VertexCacheStats stats;
+	FifoCache cache(vertex_count,cache_size);
+	std::vector<bool> used(vertex_count,false);
+	int misses = 0, used_count = 0, triangles = 0, run = 0;
+	for(int i=0;i<index_count;++i) {
+		int v = indexes[i];
+		if (strip and v==-1) { run = 0; continue; }
+		// in a strip, the two vertexes shared with the previous triangle are
+		// still in the cache, so only the new one can miss
+		if (strip) { if (++run>=3) ++triangles; }
+		else if (i%3==2) ++triangles;
+		misses += cache.add(v);
+		if (not used[v]) { used[v] = true; ++used_count; }
+	}
+	if (triangles==0) return stats;
+	stats.acmr = misses/float(triangles);
+	stats.atvr = misses/float(used_count);
+	return stats;
+}
+
+VertexCacheStats analyzeVertexCache(const Geometry &geo, int cache_size) {
+	return analyzeVertexCache(geo.triangles.data(),geo.triangles.size(),geo.positions.size(),false,cache_size);
+}
+
+float analyzeOverdraw(const Geometry &geo, int resolution) {
+	const int tri_count = geo.triangles.size()/3;
+	if (tri_count==0) return 0.f;
+	std::vector<float> depth(resolution*resolution);
+	long shaded = 0, covered = 0;
+	for(int view=0;view<14;++view) {
+		glm::vec3 dir = view<6 ? glm::vec3(0.f) : glm::vec3(view&1?1.f:-1.f,view&2?1.f:-1.f,view&4?1.f:-1.f);
+		if (view<6) dir[view/2] = view%2 ? 1.f : -1.f;
+		dir = glm::normalize(dir);
+		glm::vec3 up = std::fabs(dir.y)>.9f ? glm::vec3(1.f,0.f,0.f) : glm::vec3(0.f,1.f,0.f);
+		glm::vec3 u = glm::normalize(glm::cross(dir,up)), v = glm::cross(u,dir);
+		
+		// project the vertexes to pixel coordinates (x,y) and depth (z)
+		std::vector<glm::vec3> proj(geo.positions.size());
+		glm::vec2 pmin(std::numeric_limits<float>::max()), pmax(-std::numeric_limits<float>::max());
+		for(size_t i=0;i<proj.size();++i) {
+			proj[i] = glm::vec3(glm::dot(geo.positions[i],u),glm::dot(geo.positions[i],v),glm::dot(geo.positions[i],dir));
+			glm::vec2 xy(proj[i].x,proj[i].y);
+			pmin = glm::min(pmin,xy); pmax = glm::max(pmax,xy);
+		}
+		float scale = (resolution-1)/std::max(1e-6f,std::max(pmax.x-pmin.x,pmax.y-pmin.y));
+		for(glm::vec3 &p : proj) { p.x = (p.x-pmin.x)*scale; p.y = (p.y-pmin.y)*scale; }
+		
+		std::fill(depth.begin(),depth.end(),std::numeric_limits<float>::max());
+		for(int t=0;t<tri_count;++t) {
+			glm::vec3 a = proj[geo.triangles[3*t]], b = proj[geo.triangles[3*t+1]], c = proj[geo.triangles[3*t+2]];
+			float area = (b.x-a.x)*(c.y-a.y)-(b.y-a.y)*(c.x-a.x);
+			if (area==0.f) continue;
+			if (area<0.f) { std::swap(b,c); area = -area; }
+			int x0 = std::max(0,int(std::ceil(std::min({a.x,b.x,c.x})-.5f))), x1 = std::min(resolution-1,int(std::floor(std::max({a.x,b.x,c.x})-.5f)));
+			int y0 = std::max(0,int(std::ceil(std::min({a.y,b.y,c.y})-.5f))), y1 = std::min(resolution-1,int(std::floor(std::max({a.y,b.y,c.y})-.5f)));
+			for(int y=y0;y<=y1;++y) {
+				for(int x=x0;x<=x1;++x) { // (pixel centers are at .5)
+					float px = x+.5f, py = y+.5f;
+					float wa = (b.x-px)*(c.y-py)-(b.y-py)*(c.x-px);
+					float wb = (c.x-px)*(a.y-py)-(c.y-py)*(a.x-px);
+					float wc = area-wa-wb;
+					if (wa<0.f or wb<0.f or wc<0.f) continue;
+					float z = (wa*a.z+wb*b.z+wc*c.z)/area;
+					float &d = depth[y*resolution+x];
+					if (z<d) { 
+						if (d==std::numeric_limits<float>::max()) ++covered;
+						d = z; ++shaded;
+					}
+				}
+			}
+		}
+	}
+	return covered ? shaded/float(covered) : 0.f;
+}
+
+void optimizeVertexCache(Geometry &geo) {
+	const int tri_count = geo.triangles.size()/3, vertex_count = geo.positions.size();
+	const std::vector<int> &tris = geo.triangles;
+	if (tri_count==0) return;
+
+	// triangles of each vertex that were not emitted yet (in adjacency,
+	// from adjacency_begin[v], remaining[v] of them)
+	std::vector<int> remaining(vertex_count,0), adjacency_begin(vertex_count+1,0), adjacency(tri_count*3);
+	for(int v : tris) ++remaining[v];
+	for(int v=0;v<vertex_count;++v) adjacency_begin[v+1] = adjacency_begin[v]+remaining[v];
+	std::vector<int> filled(adjacency_begin.begin(),adjacency_begin.end()-1);
+	for(int i=0;i<tri_count*3;++i) adjacency[filled[tris[i]]++] = i/3;
+
+	std::vector<float> vertex_score(vertex_count), tri_score(tri_count,0.f);
+	for(int v=0;v<vertex_count;++v) vertex_score[v] = vertexScore(-1,remaining[v]);
+	for(int t=0;t<tri_count;++t)
+		tri_score[t] = vertex_score[tris[3*t]]+vertex_score[tris[3*t+1]]+vertex_score[tris[3*t+2]];
+	std::vector<bool> emitted(tri_count,false);
+
+	std::vector<int> result; result.reserve(tris.size());
+	std::vector<int> cache, new_cache;
+	int best = std::max_element(tri_score.begin(),tri_score.end())-tri_score.begin();
+	int cursor = 0; // for when no triangle in the cache is left (Forsyth's full search is O(n^2))
+	while (true) {
+		if (best==-1) {
+			while (cursor<tri_count and emitted[cursor]) ++cursor;
+			if (cursor==tri_count) break;
+			best = cursor;
+		}
+		const int *t = tris.data()+3*best;
+		emitted[best] = true;
+		result.insert(result.end(),t,t+3);
+
+		for(int k=0;k<3;++k) { // remove best from its vertexes' lists
+			int *b = adjacency.data()+adjacency_begin[t[k]], *e = b+remaining[t[k]];
+			std::iter_swap(std::find(b,e,best),e-1);
+			--remaining[t[k]];
+		}
+
+		// best's vertexes go to the front
+		new_cache.clear();
+		for(int k=0;k<3;++k)
+			if (std::find(new_cache.begin(),new_cache.end(),t[k])==new_cache.end()) new_cache.push_back(t[k]);
+		auto front_end = new_cache.size();
+		for(int v : cache)
+			if (std::find(new_cache.begin(),new_cache.begin()+front_end,v)==new_cache.begin()+front_end)
+				new_cache.push_back(v);
+
+		// rescore the vertexes that moved (or left) and their triangles
+		best = -1;
+		float best_score = -1.f;
+		for(size_t i=0;i<new_cache.size();++i) {
+			int v = new_cache[i];
+			int position = i<lru_size ? int(i) : -1;
+			float score = vertexScore(position,remaining[v]), delta = score-vertex_score[v];
+			vertex_score[v] = score;
+			for(int j=0;j<remaining[v];++j) {
+				int nt = adjacency[adjacency_begin[v]+j];
+				tri_score[nt] += delta;
+				if (position!=-1 and tri_score[nt]>best_score) { best_score = tri_score[nt]; best = nt; }
+			}
+		}
+		if (new_cache.size()>size_t(lru_size)) new_cache.resize(lru_size);
+		std::swap(cache,new_cache);
+	}
+	geo.triangles = std::move(result);
+}
+
+void optimizeOverdraw(Geometry &geo, float threshold) {
+	const int tri_count = geo.triangles.size()/3;
+	const int *tris = geo.triangles.data();
+	if (tri_count<2) return;
+
+	// hard boundaries: where the cache order restarts (a triangle with 3 misses)
+	FifoCache cache(geo.positions.size(),16);
+	std::vector<int> hard = {0};
+	for(int t=0;t<tri_count;++t)
+		if (cache.addTriangle(tris+3*t)==3 and t>0) hard.push_back(t);
+	hard.push_back(tri_count);
+
+	// soft boundaries: split a hard cluster wherever the part before the split
+	// (with the cache reset at its start) stays within threshold of its acmr
+	std::vector<int> clusters;
+	for(size_t h=0;h+1<hard.size();++h) {
+		int begin = hard[h], end = hard[h+1], misses = 0;
+		cache.reset();
+		for(int t=begin;t<end;++t) misses += cache.addTriangle(tris+3*t);
+		float limit = threshold*misses/float(end-begin);
+
+		cache.reset();
+		clusters.push_back(begin);
+		int start = begin; misses = 0;
+		for(int t=begin;t<end;++t) {
+			misses += cache.addTriangle(tris+3*t);
+			if (t+1<end and misses<=limit*(t+1-start)) {
+				clusters.push_back(t+1);
+				start = t+1; misses = 0;
+				cache.reset();
+			}
+		}
+	}
+	clusters.push_back(tri_count);
+
+	// sort the clusters by how much they face outwards from the mesh's center
+	auto centroidAndNormal = [&](int begin, int end, glm::vec3 &centroid, glm::vec3 &normal) {
+		float area = 0.f;
+		centroid = normal = glm::vec3(0.f);
+		for(int t=begin;t<end;++t) {
+			const glm::vec3 &p0 = geo.positions[tris[3*t]], &p1 = geo.positions[tris[3*t+1]], &p2 = geo.positions[tris[3*t+2]];
+			glm::vec3 n = glm::cross(p1-p0,p2-p0);
+			float a = glm::length(n);
+			centroid += (p0+p1+p2)*(a/3.f);
+			normal += n;
+			area += a;
+		}
+		if (area>0.f) centroid /= area;
+	};
+	glm::vec3 mesh_center, mesh_normal;
+	centroidAndNormal(0,tri_count,mesh_center,mesh_normal);
+	struct Cluster { int begin, end; float sort_key; };
+	std::vector<Cluster> sorted(clusters.size()-1);
+	for(size_t i=0;i+1<clusters.size();++i) {
+		glm::vec3 centroid, normal;
+		centroidAndNormal(clusters[i],clusters[i+1],centroid,normal);
+		float length = glm::length(normal);
+		sorted[i] = { clusters[i], clusters[i+1], length>0.f ? glm::dot(centroid-mesh_center,normal/length) : 0.f };
+	}
+	std::stable_sort(sorted.begin(),sorted.end(),[](const Cluster &a, const Cluster &b) { return a.sort_key>b.sort_key; });
+
+	std::vector<int> result; result.reserve(geo.triangles.size());
+	for(const Cluster &c : sorted) result.insert(result.end(),tris+3*c.begin,tris+3*c.end);
+	geo.triangles = std::move(result);
+}
+
+void optimizeVertexFetch(Geometry &geo) {
+	if (geo.triangles.empty()) return;
+	std::vector<int> remap(geo.positions.size(),-1);
+	int next = 0;
+	for(int &v : geo.triangles) {
+		if (remap[v]==-1) remap[v] = next++;
+		v = remap[v];
+	}
+	for(int &r : remap) if (r==-1) r = next++; // unused vertexes go to the end
+
+	auto permute = [&](auto &attribute) {
+		if (attribute.empty()) return;
+		std::remove_reference_t<decltype(attribute)> permuted(attribute.size());
+		for(size_t i=0;i<attribute.size();++i) permuted[remap[i]] = attribute[i];
+		attribute = std::move(permuted);
+	};
+	permute(geo.positions);
+	permute(geo.normals);
+	permute(geo.tex_coords);
+}
+
+void optimizeMesh(Geometry &geo, bool overdraw) {
+	optimizeVertexCache(geo);
+	if (overdraw) optimizeOverdraw(geo);
+	optimizeVertexFetch(geo);
+}
+
@@ -0,0 +1,48 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+#include "Geometry.hpp"
+
+// passes that reorder an indexed Geometry for the GPU without changing what
+// is drawn (same triangles, with the same winding); non-indexed geometries
+// are left as they are
+
+// post-transform cache behaviour of geo's triangle order, simulating a FIFO
+// cache of cache_size vertexes: acmr is the average count of vertexes
+// transformed per triangle (from 0.5 on a regular grid to 3) and atvr the
+// same per vertex (from 1 to 6)
+struct VertexCacheStats { float acmr = 0.f, atvr = 0.f; };
+VertexCacheStats analyzeVertexCache(const Geometry &geo, int cache_size=16);
+// the same for the indexes as they are drawn: a triangle list, or strips
+// separated by -1 (as GeometryRenderer uploads them)
+VertexCacheStats analyzeVertexCache(const int *indexes, int index_count, int vertex_count,
+									bool strip=false, int cache_size=16);
+
+// overdraw of geo's triangle order: the fragments that pass the depth test
+// when the triangles are drawn in order (both faces, as GeometryRenderer
+// draws them) divided by the pixels covered, averaged over orthographic views
+// from the 6 axes and the 8 diagonals at resolution x resolution (1 means
+// every covered pixel is shaded once)
+float analyzeOverdraw(const Geometry &geo, int resolution=256);
+
+// reorders the triangles so consecutive ones share vertexes (Forsyth's
+// "Linear-speed vertex cache optimisation", with an LRU cache of 32)
+void optimizeVertexCache(Geometry &geo);
+
+// splits the (already cache-optimized) triangles in clusters and sorts them
+// so the ones more likely to occlude the rest are drawn first (Sander et al.
+// "Fast triangle reordering for vertex locality and reduced overdraw");
+// threshold is how much worse than their original order's acmr clusters
+// can get by splitting them
+void optimizeOverdraw(Geometry &geo, float threshold=1.05f);
+
+// renumbers the vertexes in the order the triangles use them first, so
+// they are fetched sequentially
+void optimizeVertexFetch(Geometry &geo);
+
+// the three passes, in that order, but optimizeOverdraw only if overdraw
+// is true: it costs about 5% of acmr, and on the parts of the repo's models
+// analyzeOverdraw gives from 9% less to 12% more overdraw with it than without
+void optimizeMesh(Geometry &geo, bool overdraw=false);
+
+#endif
+
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+#include "MeshSimplifier.hpp"
+#include "Debug.hpp"
+
+namespace {
+
+// symmetric 4x4 matrix, as the sum of the planes' outer products, so
+// evaluating it at a point gives the sum of squared distances to them
+struct Quadric {
+	double a2=0, ab=0, ac=0, ad=0, b2=0, bc=0, bd=0, c2=0, cd=0, d2=0;
+	void addPlane(const glm::dvec3 &n, double d) {
+		a2 += n.x*n.x; ab += n.x*n.y; ac += n.x*n.z; ad += n.x*d;
+		b2 += n.y*n.y; bc += n.y*n.z; bd += n.y*d;
+		c2 += n.z*n.z; cd += n.z*d; d2 += d*d;
+	}
+	Quadric &operator+=(const Quadric &q) {
+		a2+=q.a2; ab+=q.ab; ac+=q.ac; ad+=q.ad; b2+=q.b2;
+		bc+=q.bc; bd+=q.bd; c2+=q.c2; cd+=q.cd; d2+=q.d2;
+		return *this;
+	}
+	double eval(const glm::vec3 &p) const {
+		double x = p.x, y = p.y, z = p.z;
+		return a2*x*x + 2*ab*x*y + 2*ac*x*z + 2*ad*x
+			 + b2*y*y + 2*bc*y*z + 2*bd*y
+			 + c2*z*z + 2*cd*z + d2;
+	}
+};
+
+// ids such that vertexes at the same exact position get the same one
+std::vector<int> weldPositions(const std::vector<glm::vec3> &positions, int &count) {
+	std::vector<int> order(positions.size()), ids(positions.size());
+	for(size_t i=0;i<order.size();++i) order[i] = i;
+	auto less = [&](int a, int b) {
+		const glm::vec3 &pa = positions[a], &pb = positions[b];
+		return pa.x!=pb.x ? pa.x<pb.x : (pa.y!=pb.y ? pa.y<pb.y : pa.z<pb.z);
+	};
+	std::sort(order.begin(),order.end(),less);
+	count = 0;
+	for(size_t i=0;i<order.size();++i) {
+		if (i>0 and positions[order[i]]!=positions[order[i-1]]) ++count;
+		ids[order[i]] = count;
+	}
+	if (not order.empty()) ++count;
+	return ids;
+}
+
+struct Collapse { int from, to; double cost; };
+
+}
+
+float simplifyMesh(Geometry &geo, int target_triangles, float max_error) {
+	cg_assert(not geo.triangles.empty(),"simplifyMesh requires an indexed geometry");
+	std::vector<int> &tris = geo.triangles;
+	const int tri_count = tris.size()/3;
+	if (tri_count<=target_triangles) return 0.f;
+
+	// positions (instead of vertexes) are what collapses
+	int pos_count;
+	std::vector<int> pos_of = weldPositions(geo.positions,pos_count);
+	std::vector<glm::vec3> pos(pos_count);
+	std::vector<int> wedges(pos_count,0); // vertexes at each position
+	for(size_t v=0;v<geo.positions.size();++v) { pos[pos_of[v]] = geo.positions[v]; ++wedges[pos_of[v]]; }
+
+	// seams and borders are locked: a position with several vertexes, or on
+	// an edge that doesn't have exactly two triangles
+	std::vector<bool> locked(pos_count,false);
+	for(int p=0;p<pos_count;++p) locked[p] = wedges[p]>1;
+	std::vector<std::pair<int,int>> edges; edges.reserve(tris.size());
+	for(int t=0;t<tri_count;++t) {
+		for(int k=0;k<3;++k) {
+			int a = pos_of[tris[3*t+k]], b = pos_of[tris[3*t+(k+1)%3]];
+			edges.emplace_back(std::min(a,b),std::max(a,b));
+		}
+	}
+	std::sort(edges.begin(),edges.end());
+	for(size_t i=0,j;i<edges.size();i=j) {
+		for(j=i+1;j<edges.size() and edges[j]==edges[i];++j);
+		if (j-i!=2) locked[edges[i].first] = locked[edges[i].second] = true;
+	}
+
+	// each position's quadric: the planes of its triangles
+	std::vector<Quadric> quadrics(pos_count);
+	for(int t=0;t<tri_count;++t) {
+		glm::dvec3 p0(pos[pos_of[tris[3*t]]]), p1(pos[pos_of[tris[3*t+1]]]), p2(pos[pos_of[tris[3*t+2]]]);
+		glm::dvec3 n = glm::cross(p1-p0,p2-p0);
+		double len = glm::length(n);
+		if (len==0.0) continue;
+		n /= len;
+		for(int k=0;k<3;++k) quadrics[pos_of[tris[3*t+k]]].addPlane(n,-glm::dot(n,p0));
+	}
+
+	// in passes: each one collapses the cheapest edges whose neighbourhoods
+	// don't overlap (so what was checked for one stays valid), and then
+	// updates the adjacency for the next
+	std::vector<bool> alive(tri_count,true);
+	int alive_count = tri_count;
+	double max_cost = double(max_error)*max_error, reached_cost = 0.0;
+	std::vector<int> adjacency_begin(pos_count+1), adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<bool> touched(pos_count);
+	std::vector<int> neighbours_a, neighbours_b;
+	bool done = false;
+	while (not done and alive_count>target_triangles) {
+		// live triangles of each position
+		std::fill(adjacency_begin.begin(),adjacency_begin.end(),0);
+		for(int t=0;t<tri_count;++t)
+			if (alive[t]) for(int k=0;k<3;++k) ++adjacency_begin[pos_of[tris[3*t+k]]+1];
+		for(int p=0;p<pos_count;++p) adjacency_begin[p+1] += adjacency_begin[p];
+		adjacency.resize(adjacency_begin[pos_count]);
+		std::vector<int> filled(adjacency_begin.begin(),adjacency_begin.end()-1);
+		for(int t=0;t<tri_count;++t)
+			if (alive[t]) for(int k=0;k<3;++k) adjacency[filled[pos_of[tris[3*t+k]]]++] = t;
+
+		collapses.clear();
+		for(int t=0;t<tri_count;++t) {
+			if (not alive[t]) continue;
+			for(int k=0;k<3;++k) {
+				int a = pos_of[tris[3*t+k]], b = pos_of[tris[3*t+(k+1)%3]];
+				for(int dir=0;dir<2;++dir,std::swap(a,b)) {
+					if (locked[a]) continue;
+					Quadric q = quadrics[a]; q += quadrics[b];
+					collapses.push_back({a,b,std::max(q.eval(pos[b]),0.0)});
+				}
+			}
+		}
+		std::sort(collapses.begin(),collapses.end(),[](const Collapse &x, const Collapse &y) { return x.cost<y.cost; });
+
+		std::fill(touched.begin(),touched.end(),false);
+		int collapsed = 0;
+		for(const Collapse &c : collapses) {
+			if (c.cost>max_cost) { done = true; break; }
+			if (alive_count<=target_triangles) break;
+			if (touched[c.from] or touched[c.to]) continue;
+			const int *a_begin = adjacency.data()+adjacency_begin[c.from],
+			          *a_end = adjacency.data()+adjacency_begin[c.from+1];
+
+			// link condition: a and b can only share the neighbours of the
+			// two triangles on their edge (or the surface would pinch)
+			auto getNeighbours = [&](int p, std::vector<int> &v) {
+				v.clear();
+				for(int i=adjacency_begin[p];i<adjacency_begin[p+1];++i)
+					for(int k=0;k<3;++k) v.push_back(pos_of[tris[3*adjacency[i]+k]]);
+				std::sort(v.begin(),v.end());
+				v.erase(std::unique(v.begin(),v.end()),v.end());
+			};
+			getNeighbours(c.from,neighbours_a);
+			getNeighbours(c.to,neighbours_b);
+			std::vector<int> shared;
+			std::set_intersection(neighbours_a.begin(),neighbours_a.end(),
+								  neighbours_b.begin(),neighbours_b.end(),std::back_inserter(shared));
+			if (shared.size()!=4) continue; // (a, b and the two opposite ones)
+
+			// no triangle can flip, and the moving vertex's one must be at b's
+			// side of each of them (its only vertex there, since a is not on a seam)
+			bool flips = false;
+			int from_vertex = -1, to_vertex = -1;
+			for(const int *t=a_begin;t!=a_end and not flips;++t) {
+				const int *tv = tris.data()+3*(*t);
+				int ka = 0, kb = -1;
+				for(int k=0;k<3;++k) {
+					if (pos_of[tv[k]]==c.from) ka = k;
+					if (pos_of[tv[k]]==c.to) kb = k;
+				}
+				from_vertex = tv[ka];
+				if (kb!=-1) { to_vertex = tv[kb]; continue; } // (it will disappear)
+				glm::vec3 p1 = pos[pos_of[tv[(ka+1)%3]]], p2 = pos[pos_of[tv[(ka+2)%3]]];
+				glm::vec3 n_old = glm::cross(p1-pos[c.from],p2-pos[c.from]);
+				glm::vec3 n_new = glm::cross(p1-pos[c.to],p2-pos[c.to]);
+				flips = glm::dot(n_old,n_new)<=0.f;
+			}
+			if (flips or to_vertex==-1) continue;
+
+			// collapse: a's vertex is replaced by b's one in its triangles
+			for(const int *t=a_begin;t!=a_end;++t) {
+				int *tv = tris.data()+3*(*t);
+				bool degenerate = false;
+				for(int k=0;k<3;++k) {
+					if (tv[k]==from_vertex) tv[k] = to_vertex;
+					else degenerate = degenerate or pos_of[tv[k]]==c.to;
+				}
+				if (degenerate) { alive[*t] = false; --alive_count; }
+			}
+			quadrics[c.to] += quadrics[c.from];
+			reached_cost = std::max(reached_cost,c.cost);
+			for(int p : neighbours_a) touched[p] = true;
+			++collapsed;
+		}
+		if (collapsed==0) done = true;
+	}
+
+	// keep the live triangles and the vertexes they still use, in their order
+	std::vector<int> remap(geo.positions.size(),-1);
+	std::vector<int> new_tris; new_tris.reserve(alive_count*3);
+	int vertex_count = 0;
+	for(int t=0;t<tri_count;++t) {
+		if (not alive[t]) continue;
+		for(int k=0;k<3;++k) {
+			int &r = remap[tris[3*t+k]];
+			if (r==-1) r = vertex_count++;
+			new_tris.push_back(r);
+		}
+	}
+	auto compact = [&](auto &attribute) {
+		if (attribute.empty()) return;
+		std::remove_reference_t<decltype(attribute)> kept(vertex_count);
+		for(size_t v=0;v<attribute.size();++v)
+			if (remap[v]!=-1) kept[remap[v]] = attribute[v];
+		attribute = std::move(kept);
+	};
+	compact(geo.positions);
+	compact(geo.normals);
+	compact(geo.tex_coords);
+	tris = std::move(new_tris);
+	return std::sqrt(reached_cost);
+}
+
+std::vector<MeshLod> buildLodChain(const Geometry &geo, int max_levels, float ratio, int min_triangles) {
+	std::vector<MeshLod> lods;
+	lods.reserve(max_levels);
+	const Geometry *prev = &geo;
+	float error = 0.f;
+	while (int(lods.size())<max_levels) {
+		int prev_count = prev->triangles.size()/3, target = prev_count*ratio;
+		if (target<min_triangles) break;
+		Geometry lod = *prev;
+		error += simplifyMesh(lod,target); // (an upper bound, errors of each step add up)
+		// stop when locked seams and borders keep it from getting much simpler
+		if (lod.triangles.size()/3 > prev_count*(1.f+ratio)/2.f) break;
+		lods.push_back({std::move(lod),error});
+		prev = &lods.back().geometry;
+	}
+	return lods;
+}
+
@@ -0,0 +1,32 @@
+#ifndef MESH_SIMPLIFIER_HPP
+#define MESH_SIMPLIFIER_HPP
+#include <vector>
+#include <cfloat>
+#include "Geometry.hpp"
+
+// Garland and Heckbert's "Surface simplification using quadric error
+// metrics", with half-edge collapses (a vertex moves onto a neighbour, so
+// the kept vertexes keep their exact normals and texture coordinates);
+// vertexes on UV or normal seams (several vertexes at the same position)
+// and on borders never move, so seams stay where they were and charts don't
+// tear, at the cost of simplifying less along them; geo must be indexed
+
+// collapses edges of geo, cheapest first, until it has target_triangles or
+// the next collapse would move the surface more than max_error (in geo's
+// units); returns the error reached (0 if nothing changed)
+float simplifyMesh(Geometry &geo, int target_triangles, float max_error=FLT_MAX);
+
+// a level of detail and its geometric error with respect to the original
+struct MeshLod {
+	Geometry geometry;
+	float error;
+};
+
+// geo's simplified versions, each one with ratio times the triangles of the
+// previous one, until there are max_levels, one would have less than
+// min_triangles, or the seams don't let it simplify enough (geo itself is
+// not included, it would be level 0)
+std::vector<MeshLod> buildLodChain(const Geometry &geo, int max_levels=4, float ratio=.5f, int min_triangles=32);
+
+#endif
+
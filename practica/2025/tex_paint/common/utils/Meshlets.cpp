@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cmath>
+#include "Meshlets.hpp"
+#include "MeshOptimizer.hpp"
+#include "Debug.hpp"
+
+namespace {
+
+void finishMeshlet(const GeometryView &geo, Meshlet &m) {
+	const int *tris = geo.triangles+m.first_index;
+	// sphere: the center of the bounding box, and the farthest vertex
+	glm::vec3 pmin = geo.positions[tris[0]], pmax = pmin;
+	for(int i=1;i<m.index_count;++i) {
+		pmin = glm::min(pmin,geo.positions[tris[i]]);
+		pmax = glm::max(pmax,geo.positions[tris[i]]);
+	}
+	m.center = (pmin+pmax)/2.f;
+	m.radius = 0.f;
+	for(int i=0;i<m.index_count;++i)
+		m.radius = std::max(m.radius,glm::length(geo.positions[tris[i]]-m.center));
+
+	// cone: the average normal, and the one that is farthest from it
+	std::vector<glm::vec3> normals;
+	glm::vec3 sum(0.f);
+	for(int i=0;i<m.index_count;i+=3) {
+		const glm::vec3 &p0 = geo.positions[tris[i]], &p1 = geo.positions[tris[i+1]], &p2 = geo.positions[tris[i+2]];
+		glm::vec3 n = glm::cross(p1-p0,p2-p0);
+		float len = glm::length(n);
+		if (len==0.f) continue;
+		normals.push_back(n/len);
+		sum += normals.back();
+	}
+	float sum_len = glm::length(sum);
+	m.cone_axis = sum_len==0.f ? glm::vec3(0.f,0.f,1.f) : sum/sum_len;
+	float min_dot = 1.f;
+	for(const glm::vec3 &n : normals)
+		min_dot = std::min(min_dot,glm::dot(n,m.cone_axis));
+	// (wider than a hemisphere, or nearly, it would hardly ever be culled)
+	m.cone_cutoff = (normals.empty() or min_dot<=0.1f) ? 1.f : std::sqrt(1.f-min_dot*min_dot);
+}
+
+}
+
+std::vector<int> optimizeMeshlets(Geometry &geo, int max_vertexes, int max_triangles) {
+	const std::vector<int> &tris = geo.triangles;
+	int tri_count = tris.size()/3, vertex_count = geo.positions.size();
+	
+	// triangles of each vertex, and each triangle's normal
+	std::vector<int> adjacency_begin(vertex_count+1,0), adjacency(tris.size());
+	for(int v : tris) ++adjacency_begin[v+1];
+	for(int v=0;v<vertex_count;++v) adjacency_begin[v+1] += adjacency_begin[v];
+	std::vector<int> filled(adjacency_begin.begin(),adjacency_begin.end()-1);
+	for(int t=0;t<tri_count;++t)
+		for(int k=0;k<3;++k) adjacency[filled[tris[3*t+k]]++] = t;
+	std::vector<glm::vec3> normals(tri_count);
+	for(int t=0;t<tri_count;++t) {
+		const glm::vec3 &p0 = geo.positions[tris[3*t]], &p1 = geo.positions[tris[3*t+1]], &p2 = geo.positions[tris[3*t+2]];
+		glm::vec3 n = glm::cross(p1-p0,p2-p0);
+		float len = glm::length(n);
+		normals[t] = len==0.f ? glm::vec3(0.f) : n/len;
+	}
+	
+	std::vector<bool> used(tri_count,false);
+	std::vector<int> owner(vertex_count,-1), new_tris, vertexes, starts;
+	new_tris.reserve(tris.size());
+	Geometry local; // a cluster, with its own vertex numbers
+	for(int seed=0, cluster=0;seed<tri_count;++seed) {
+		if (used[seed]) continue;
+		size_t first = new_tris.size();
+		starts.push_back(first);
+		vertexes.clear();
+		glm::vec3 normal(0.f);
+		int t = seed;
+		for(int count=1;;++count) {
+			used[t] = true;
+			normal += normals[t];
+			for(int k=0;k<3;++k) {
+				int v = tris[3*t+k];
+				new_tris.push_back(v);
+				if (owner[v]!=cluster) { owner[v] = cluster; vertexes.push_back(v); }
+			}
+			if (count==max_triangles) break;
+			
+			// next: the cheapest unused triangle around the cluster's vertexes
+			float normal_len = glm::length(normal);
+			glm::vec3 axis = normal_len==0.f ? glm::vec3(0.f) : normal/normal_len;
+			int best = -1;
+			float best_cost = 0.f;
+			for(int v : vertexes) {
+				for(int i=adjacency_begin[v];i<adjacency_begin[v+1];++i) {
+					int c = adjacency[i];
+					if (used[c]) continue;
+					int new_vertexes = 0;
+					for(int k=0;k<3;++k) 
+						if (owner[tris[3*c+k]]!=cluster) ++new_vertexes;
+					if (int(vertexes.size())+new_vertexes>max_vertexes) continue;
+					float cost = new_vertexes+2.f*(1.f-glm::dot(axis,normals[c]));
+					if (best==-1 or cost<best_cost) { best = c; best_cost = cost; }
+				}
+			}
+			if (best==-1) break;
+			t = best;
+		}
+		
+		// the cluster's order was for growing it, this one is for the cache
+		local.positions.resize(vertexes.size());
+		local.triangles.clear();
+		for(size_t i=first;i<new_tris.size();++i)
+			local.triangles.push_back(std::find(vertexes.begin(),vertexes.end(),new_tris[i])-vertexes.begin());
+		optimizeVertexCache(local);
+		for(size_t i=first;i<new_tris.size();++i) new_tris[i] = vertexes[local.triangles[i-first]];
+		++cluster;
+	}
+	geo.triangles = std::move(new_tris);
+	return starts;
+}
+
+std::vector<Meshlet> buildMeshlets(const GeometryView &geo, const std::vector<int> &cluster_starts,
+								   int max_vertexes, int max_triangles)
+{
+	cg_assert(geo.triangles,"buildMeshlets requires an indexed geometry");
+	cg_assert(max_vertexes>=3 and max_triangles>=1,"Meshlets are too small");
+	std::vector<Meshlet> meshlets;
+	std::vector<int> owner(geo.vertex_count,-1); // last meshlet that used each vertex
+	int vertexes = 0;
+	size_t next_start = 0;
+	for(int i=0;i<geo.index_count;i+=3) {
+		const int *t = geo.triangles+i;
+		int current = meshlets.size()-1, new_vertexes = 0;
+		for(int k=0;k<3;++k) // (a vertex repeated in t counts once)
+			if (owner[t[k]]!=current and (k<1 or t[k]!=t[0]) and (k<2 or t[k]!=t[1])) ++new_vertexes;
+		bool cluster_start = false;
+		for(; next_start<cluster_starts.size() and cluster_starts[next_start]<=i; ++next_start)
+			cluster_start = cluster_start or cluster_starts[next_start]==i;
+		if (meshlets.empty() or cluster_start or vertexes+new_vertexes>max_vertexes
+			or meshlets.back().index_count==3*max_triangles)
+		{
+			if (not meshlets.empty()) finishMeshlet(geo,meshlets.back());
+			meshlets.push_back({i,0,{},0.f,{},1.f});
+			vertexes = 0;
+			++current;
+		}
+		for(int k=0;k<3;++k) {
+			if (owner[t[k]]==current) continue;
+			owner[t[k]] = current;
+			++vertexes;
+		}
+		meshlets.back().index_count += 3;
+	}
+	if (not meshlets.empty()) finishMeshlet(geo,meshlets.back());
+	return meshlets;
+}
+
+MeshletCulling cullMeshlets(const std::vector<Meshlet> &meshlets, const glm::mat4 &model_view,
+							const glm::mat4 &projection, std::vector<GeometryRenderer::IndexRange> &ranges)
+{
+	// everything in view space, where the camera is at the origin; the
+	// frustum's planes are sums of the projection's rows (Gribb and Hartmann)
+	glm::vec4 planes[6];
+	for(int i=0;i<3;++i) {
+		glm::vec4 row(projection[0][i],projection[1][i],projection[2][i],projection[3][i]);
+		glm::vec4 w(projection[0][3],projection[1][3],projection[2][3],projection[3][3]);
+		planes[2*i] = w+row;
+		planes[2*i+1] = w-row;
+	}
+	float scale = glm::length(glm::vec3(model_view[0]));
+	bool perspective = projection[3][3]==0.f;
+
+	MeshletCulling stats;
+	stats.total = meshlets.size();
+	ranges.clear();
+	for(const Meshlet &m : meshlets) {
+		glm::vec3 center = glm::vec3(model_view*glm::vec4(m.center,1.f));
+		float radius = m.radius*scale;
+		bool outside = false;
+		for(int i=0;i<6 and not outside;++i)
+			outside = glm::dot(glm::vec3(planes[i]),center)+planes[i].w < -radius*glm::length(glm::vec3(planes[i]));
+		if (outside) { ++stats.frustum; continue; }
+
+		// backfacing if every normal in the cone points away from the camera
+		// (for every point of the sphere), seen from the camera; with an
+		// orthographic projection every view direction is -z
+		if (m.cone_cutoff<1.f) {
+			glm::vec3 axis = glm::normalize(glm::vec3(model_view*glm::vec4(m.cone_axis,0.f)));
+			bool back = perspective
+				? glm::dot(center,axis) >= m.cone_cutoff*glm::length(center)+radius
+				: -axis.z >= m.cone_cutoff;
+			if (back) { ++stats.backface; continue; }
+		}
+
+		if (not ranges.empty() and ranges.back().first+ranges.back().count==m.first_index)
+			ranges.back().count += m.index_count;
+		else
+			ranges.push_back({m.first_index,m.index_count});
+	}
+	return stats;
+}
+
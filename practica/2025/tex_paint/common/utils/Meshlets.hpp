@@ -0,0 +1,44 @@
+#ifndef MESHLETS_HPP
+#define MESHLETS_HPP
+#include <vector>
+#include <glm/glm.hpp>
+#include "Geometry.hpp"
+
+// a cluster of consecutive triangles of a geometry, with what's needed to
+// discard it as a whole before drawing it: a bounding sphere, and a cone
+// that contains the normals of all its triangles (with cone_cutoff being
+// the sine of its half angle, or 1 if it is too wide to ever cull)
+struct Meshlet {
+	int first_index, index_count;
+	glm::vec3 center; float radius;
+	glm::vec3 cone_axis; float cone_cutoff;
+};
+
+// reorders geo's triangles so consecutive ones form compact clusters with
+// similar normals, and returns the first index of each cluster; each one
+// grows from the first triangle not used yet by adding the neighbour that
+// brings the fewest new vertexes and deviates the least from the cluster's
+// normal, until a limit is reached or no neighbour fits; then its
+// triangles are reordered for the vertex cache (see MeshOptimizer)
+std::vector<int> optimizeMeshlets(Geometry &geo, int max_vertexes=64, int max_triangles=124);
+
+// splits geo's triangle list, in its current order, in meshlets of up to
+// max_vertexes distinct vertexes and max_triangles triangles, also starting
+// a new one at each of cluster_starts; with the ones optimizeMeshlets gave
+// (for the same limits) each cluster is exactly one meshlet, without them
+// it works best after optimizeVertexCache; triangles are not moved, so
+// each meshlet is a range of the same index buffer
+std::vector<Meshlet> buildMeshlets(const GeometryView &geo, const std::vector<int> &cluster_starts={},
+								   int max_vertexes=64, int max_triangles=124);
+
+// how many meshlets the last cull discarded, and for what
+struct MeshletCulling { int total = 0, frustum = 0, backface = 0; };
+
+// the index ranges of the meshlets that may be visible with these matrixes
+// (consecutive ones merged into a single range); the backface test assumes
+// counter-clockwise front faces and a model_view with uniform scale
+MeshletCulling cullMeshlets(const std::vector<Meshlet> &meshlets, const glm::mat4 &model_view,
+							const glm::mat4 &projection, std::vector<GeometryRenderer::IndexRange> &ranges);
+
+#endif
+
@@ -1,5 +1,14 @@
 #include "Misc.hpp"
 #include "Debug.hpp"
+#ifdef _WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	define PSAPI_VERSION 2 // GetProcessMemoryInfo from kernel32, no need for psapi.lib
+#	include <windows.h>
+#	include <psapi.h>
+#else
+#	include <sys/resource.h>
+#endif
 
 std::string extractFolder(const std::string &filename) {
 	int i = static_cast<int>(filename.size())-1;
@@ -9,7 +18,7 @@ std::string extractFolder(const std::string &filename) {
 	return filename.substr(0,i+1);
 }
 
-bool startsWith(const std::string str, const char *con) {
+bool startsWith(std::string_view str, const char *con) {
 	int i=0, l=str.size();
 	for(;con[i] && i<l;++i)
 		if (con[i]!=str[i]) return false;
@@ -32,3 +41,18 @@ std::pair<glm::vec3,glm::vec3> getBoundingBox(const std::vector<glm::vec3> &v) {
 	}
 	return {pmin,pmax};
 }
+
+size_t getPeakMemoryUsage() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	return GetProcessMemoryInfo(GetCurrentProcess(),&pmc,sizeof(pmc)) ? pmc.PeakWorkingSetSize : 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF,&usage)!=0) return 0;
+#	ifdef __APPLE__
+	return usage.ru_maxrss; // already in bytes
+#	else
+	return static_cast<size_t>(usage.ru_maxrss)*1024;
+#	endif
+#endif
+}
@@ -1,6 +1,7 @@
 #ifndef MISC_HPP
 #define MISC_HPP
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 #include <glm/glm.hpp>
@@ -9,9 +10,12 @@ std::string extractFolder(const std::string &filename);
 
 void fixEOL(std::string &s);
 
-bool startsWith(const std::string str, const char *con);
+bool startsWith(std::string_view str, const char *con);
 
 std::pair<glm::vec3,glm::vec3> getBoundingBox(const std::vector<glm::vec3> &v);
 
+// peak resident memory of the process so far, in bytes (0 if unknown)
+size_t getPeakMemoryUsage();
+
 #endif
 
@@ -1,37 +1,293 @@
 #include <tuple>
 #include <cmath>
 #include <algorithm>
+#include <limits>
+#include <cstdio>
+#include <cctype>
+#include <fstream>
 #include "Model.hpp"
 #include "Debug.hpp"
 #include "ObjMesh.hpp"
 #include "Misc.hpp"
+#include "MeshCache.hpp"
+#include "GlbMesh.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshCleanup.hpp"
 
-Model Model::loadSingle(const std::string &name, int flags) {
-	ObjMesh obj = readObj(name+".obj");
-	if (!(flags&fDontFit)) centerAndResize(obj.positions);
-	Geometry geometry = toGeometry(obj,0);
-	if (flags&fRegenerateNormals or geometry.normals.empty()) geometry.generateNormals();
-	return Model(std::move(geometry), obj.parts[0].material, flags);
+namespace {
+
+// the flags that change the resulting geometry, a cache built with 
+// different ones must be discarded
+constexpr int geometry_flags = Model::fDontFit|Model::fRegenerateNormals|Model::fDontOptimize|Model::fMeshlets|Model::fDontClean|Model::fOptimizeOverdraw;
+
+// the weld epsilon the cache is built with (0 if the geometry is not cleaned,
+// so changing it does not discard those)
+float cacheEpsilon(int flags) {
+	return flags&Model::fDontClean ? 0.f : Model::weld_epsilon;
 }
 
-std::vector<Model> Model::load(const std::string &name, int flags) {
-	auto obj = readObj(name+".obj");
-	if (!(flags&fDontFit)) centerAndResize(obj.positions);
+// final geometry and material for each part of an obj file (the same data 
+// a MeshCache stores)
+struct LoadedParts {
+	std::vector<std::string> sources, names;
+	std::vector<Geometry> geometries;
+	std::vector<Material> materials;
+	std::vector<std::vector<int>> clusters; // (empty without fMeshlets)
+};
+
+// triangles in clusters for buildMeshlets (returning where each one
+// starts), and vertexes in their new order
+std::vector<int> groupMeshlets(Geometry &geometry, int flags) {
+	std::vector<int> clusters = optimizeMeshlets(geometry);
+	if (not (flags&Model::fDontOptimize)) optimizeVertexFetch(geometry);
+	return clusters;
+}
+
+LoadedParts loadParts(const std::string &obj_path, int flags, bool only_first) {
+	Arena arena; // for the temporaries of readObj and toGeometry
+	ObjMesh obj = readObj(obj_path,(flags&Model::fParallelLoad)?0:1,&arena);
+	if (!(flags&Model::fDontFit)) centerAndResize(obj.positions);
 	
-	std::vector<Model> vret; vret.reserve(obj.parts.size());
+	LoadedParts lp;
+	lp.sources.push_back(obj_path);
+	lp.sources.insert(lp.sources.end(),obj.material_libs.begin(),obj.material_libs.end());
+	CleanupStats cleanup;
 	for (auto &part : obj.parts) {
-		Geometry geometry = toGeometry(obj,part);
-		if (flags&fRegenerateNormals or geometry.normals.empty()) geometry.generateNormals();
-		vret.emplace_back(std::move(geometry), part.material, flags);
+		arena.reset();
+		Geometry geometry = toGeometry(obj,part,&arena);
+		if (not (flags&Model::fDontClean)) cleanup += cleanMesh(geometry,Model::weld_epsilon);
+		if (flags&Model::fRegenerateNormals or geometry.normals.empty()) geometry.generateNormals();
+		if (not (flags&Model::fDontOptimize)) optimizeMesh(geometry,flags&Model::fOptimizeOverdraw);
+		lp.clusters.push_back(flags&Model::fMeshlets ? groupMeshlets(geometry,flags) : std::vector<int>());
+		lp.names.push_back(part.name);
+		lp.geometries.push_back(std::move(geometry));
+		lp.materials.push_back(part.material);
+		if (only_first) break;
+	}
+	if (not (flags&Model::fDontClean))
+		cg_info("Cleanup of "+obj_path+": "+std::to_string(cleanup.vertexes_before)+" -> "
+				+std::to_string(cleanup.vertexes_after)+" vertexes, "+std::to_string(cleanup.triangles_before)
+				+" -> "+std::to_string(cleanup.triangles_after)+" triangles");
+	if (not (flags&Model::fNoCache) and not only_first)
+		if (not MeshCache::write(obj_path,flags&geometry_flags,cacheEpsilon(flags),lp.sources,lp.names,lp.geometries,lp.materials,lp.clusters))
+			cg_info("Could not write geometry cache for "+obj_path);
+	return lp;
+}
+
+// glb parts are uploaded straight from the mapped file, unless they must
+// be fitted, get new normals or be grouped in meshlets
+std::vector<Model> loadGlb(const std::string &glb_path, int flags, bool only_first) {
+	GlbMesh glb(glb_path);
+	cg_assert(glb.isOk(),"No triangles found in "+glb_path);
+	
+	// the same box centerAndResize would use if the parts were one obj
+	glm::vec3 pmin(std::numeric_limits<float>::max()), pmax(-std::numeric_limits<float>::max());
+	bool fit = not (flags&Model::fDontFit);
+	for (const GlbMesh::Part &part : glb.getParts()) {
+		for(int i=0;fit and i<part.geometry.vertex_count;++i) {
+			pmin = glm::min(pmin,part.geometry.positions[i]);
+			pmax = glm::max(pmax,part.geometry.positions[i]);
+		}
+	}
+	
+	// glTF's v=0 is already the top row, the opposite of obj's
+	int model_flags = flags^Model::fTextureDontFlipV;
+	std::vector<Model> vret;
+	for (const GlbMesh::Part &part : glb.getParts()) {
+		if (fit or flags&Model::fRegenerateNormals or not part.geometry.normals or flags&Model::fMeshlets) {
+			Geometry geometry = part.geometry.copy();
+			if (fit) centerAndResize(geometry.positions,pmin,pmax);
+			if (flags&Model::fRegenerateNormals or geometry.normals.empty()) geometry.generateNormals();
+			std::vector<int> clusters;
+			if (flags&Model::fMeshlets) clusters = groupMeshlets(geometry,flags);
+			vret.emplace_back(std::move(geometry),part.material,model_flags,clusters);
+		} else
+			vret.emplace_back(part.geometry,part.material,model_flags);
+		if (only_first) break;
 	}
 	return vret;
 }
 
+bool isGlb(const std::string &name) {
+	return name.size()>4 and name.compare(name.size()-4,4,".glb")==0;
+}
+
+}
+
+float Model::weld_epsilon = 1e-6f;
+
+Model Model::loadSingle(const std::string &name, int flags) {
+	if (isGlb(name)) return std::move(loadGlb(name,flags,true)[0]);
+	std::string obj_path = name+".obj";
+	if (not (flags&fNoCache)) {
+		MeshCache cache(obj_path,flags&geometry_flags,cacheEpsilon(flags));
+		if (cache.isOk()) {
+			const MeshCache::Part &part = cache.getParts()[0];
+			return Model(part.geometry, part.material, flags, part.clusters);
+		}
+	}
+	// the cache holds every part, so it must be built with all of them
+	LoadedParts lp = loadParts(obj_path,flags,flags&fNoCache);
+	return Model(std::move(lp.geometries[0]), lp.materials[0], flags, lp.clusters[0]);
+}
+
+std::vector<Model> Model::load(const std::string &name, int flags) {
+	if (isGlb(name)) return loadGlb(name,flags,false);
+	std::string obj_path = name+".obj";
+	std::vector<Model> vret;
+	if (not (flags&fNoCache)) {
+		MeshCache cache(obj_path,flags&geometry_flags,cacheEpsilon(flags));
+		if (cache.isOk()) {
+			vret.reserve(cache.getParts().size());
+			for (const MeshCache::Part &part : cache.getParts())
+				vret.emplace_back(part.geometry, part.material, flags, part.clusters);
+			return vret;
+		}
+	}
+	LoadedParts lp = loadParts(obj_path,flags,false);
+	vret.reserve(lp.geometries.size());
+	for (size_t i=0;i<lp.geometries.size();++i)
+		vret.emplace_back(std::move(lp.geometries[i]), lp.materials[i], flags, lp.clusters[i]);
+	return vret;
+}
+
+Model Model::fromEmbedded(const EmbeddedMesh &part, int flags) {
+	return Model(part.getGeometry(), part.getMaterial(), flags);
+}
+
+void Model::buildLods(const Geometry &g, int flags) {
+	if (g.triangles.empty()) return; // (only indexed geometries simplify)
+	glm::vec3 pmin, pmax;
+	std::tie(pmin,pmax) = getBoundingBox(g.positions);
+	lod_center = (pmin+pmax)/2.f;
+	for(MeshLod &lod : buildLodChain(g)) {
+		if (not (flags&fDontOptimize)) optimizeMesh(lod.geometry,flags&fOptimizeOverdraw);
+		std::vector<int> clusters;
+		if (flags&fMeshlets) clusters = groupMeshlets(lod.geometry,flags);
+		lods.emplace_back(lod.geometry,flags&fDynamic,model2layout(flags),not (flags&fMeshlets));
+		if (flags&fMeshlets) meshlets.push_back(buildMeshlets(lod.geometry,clusters));
+		lod_errors.push_back(lod.error);
+		lod_triangles.push_back(lod.geometry.triangles.size()/3);
+	}
+}
+
+int Model::selectLod(const glm::mat4 &model_view, const glm::mat4 &projection, 
+					 int viewport_height, float max_pixels) const 
+{
+	// pixels per model unit at the center: the model_view's largest scale, 
+	// and the projection's one (that, with perspective, shrinks with depth)
+	float scale = std::max({ glm::length(glm::vec3(model_view[0])),
+							 glm::length(glm::vec3(model_view[1])),
+							 glm::length(glm::vec3(model_view[2])) });
+	scale *= projection[1][1]*viewport_height/2.f;
+	if (projection[3][3]==0.f) { // (perspective)
+		float depth = -(model_view*glm::vec4(lod_center,1.f)).z;
+		if (depth<=0.f) return 0; // (the center is behind the camera, too close to tell)
+		scale /= depth;
+	}
+	int level = 0;
+	while (level+1<int(lod_errors.size()) and lod_errors[level+1]*scale<=max_pixels) ++level;
+	return level;
+}
+
+namespace {
+
+// shortest literal that gives back exactly the same float
+std::string toLiteral(float f) {
+	char buf[32];
+	std::snprintf(buf,sizeof(buf),"%.9g",f);
+	std::string s = buf;
+	return s+(s.find_first_of(".e")==std::string::npos ? ".f" : "f");
+}
+
+template<typename TVec>
+void writeArray(std::ofstream &fout, const std::string &name, const std::vector<TVec> &v, int components) {
+	fout << "inline constexpr float " << name << "[][" << components << "] = {\n";
+	for(const TVec &e : v) {
+		fout << "\t{";
+		for(int j=0;j<components;++j) fout << (j?",":"") << toLiteral(e[j]);
+		fout << "},\n";
+	}
+	fout << "};\n";
+}
+
+std::string toLiteral(const glm::vec3 &v) {
+	return "{"+toLiteral(v.x)+","+toLiteral(v.y)+","+toLiteral(v.z)+"}";
+}
+
+// a C string literal, escaping quotes, backslashes (as in windows paths)
+// and control characters
+std::string toLiteral(const std::string &str) {
+	std::string s = "\"";
+	for(char c : str) {
+		if (c=='"' or c=='\\') s += '\\';
+		if (static_cast<unsigned char>(c)<' ') {
+			char buf[8];
+			std::snprintf(buf,sizeof(buf),"\\%03o",static_cast<unsigned char>(c));
+			s += buf;
+		} else
+			s += c;
+	}
+	return s+"\"";
+}
+
+}
+
+bool Model::writeEmbedded(const std::string &name, const std::string &header_path, int flags) {
+	LoadedParts lp = loadParts(name+".obj",flags|fNoCache,false);
+	std::string id = header_path.substr(extractFolder(header_path).size());
+	id = id.substr(0,id.find('.'));
+	for(char &c : id) if (not std::isalnum(static_cast<unsigned char>(c))) c = '_';
+	std::string guard = "EMBEDDED_"+id+"_HPP";
+	for(char &c : guard) c = std::toupper(static_cast<unsigned char>(c));
+	
+	std::ofstream fout(header_path,std::ios::trunc);
+	if (not fout.is_open()) return false;
+	fout << "// generated with Model::writeEmbedded(\"" << name << "\",...,"<< flags << "), do not edit\n"
+		 << "// (" << (flags&fDontClean ? "not cleaned" : "cleaned with weld_epsilon="+std::to_string(weld_epsilon)) << ", "
+		 << (flags&fDontOptimize ? "not optimized" : flags&fOptimizeOverdraw ? "optimized, with overdraw" : "optimized") << ")\n"
+		 << "#ifndef " << guard << "\n#define " << guard << "\n"
+		 << "#include \"../EmbeddedMesh.hpp\"\n\n"
+		 << "namespace embedded {\n\nnamespace " << id << "_data {\n\n";
+	for(size_t i=0;i<lp.geometries.size();++i) {
+		const Geometry &g = lp.geometries[i];
+		std::string n = std::to_string(i);
+		writeArray(fout,"positions_"+n,g.positions,3);
+		if (not g.normals.empty()) writeArray(fout,"normals_"+n,g.normals,3);
+		if (not g.tex_coords.empty()) writeArray(fout,"tex_coords_"+n,g.tex_coords,2);
+		if (not g.triangles.empty()) {
+			fout << "inline constexpr int triangles_" << n << "[] = {";
+			for(size_t j=0;j<g.triangles.size();++j) fout << (j%3?",":"\n\t") << g.triangles[j] << (j%3==2?",":"");
+			fout << "\n};\n";
+		}
+		fout << "\n";
+	}
+	fout << "}\n\ninline constexpr EmbeddedMesh " << id << "[] = {\n";
+	for(size_t i=0;i<lp.geometries.size();++i) {
+		const Geometry &g = lp.geometries[i];
+		const Material &m = lp.materials[i];
+		std::string n = std::to_string(i), data = id+"_data::";
+		fout << "\t{ " << toLiteral(lp.names[i]) << ", "
+			 << toLiteral(m.ka) << ", " << toLiteral(m.kd) << ", " << toLiteral(m.ks) << ", " << toLiteral(m.ke) << ", "
+			 << toLiteral(m.shininess) << ", " << toLiteral(m.opacity) << ", " << toLiteral(m.texture) << ",\n\t  "
+			 << data << "positions_" << n << ", "
+			 << (g.normals.empty() ? "nullptr" : data+"normals_"+n) << ", "
+			 << (g.tex_coords.empty() ? "nullptr" : data+"tex_coords_"+n) << ", " << g.positions.size() << ",\n\t  "
+			 << (g.triangles.empty() ? "nullptr" : data+"triangles_"+n) << ", " << g.triangles.size() << " },\n";
+	}
+	fout << "};\n\n}\n\n#endif\n";
+	return static_cast<bool>(fout);
+}
+
 void centerAndResize(std::vector<glm::vec3> &v) {
 	// get global bb
 	glm::vec3 pmin, pmax;
 	std::tie(pmin,pmax) = getBoundingBox(v);
-	
+	centerAndResize(v,pmin,pmax);
+}
+
+void centerAndResize(std::vector<glm::vec3> &v, glm::vec3 pmin, glm::vec3 pmax) {
 	// center on 0,0,0
 	glm::vec3 center = (pmax+pmin)/2.f;
 	for(glm::vec3 &p : v) 
@@ -4,6 +4,8 @@
 #include "Geometry.hpp"
 #include "Material.hpp"
 #include "Texture.hpp"
+#include "EmbeddedMesh.hpp"
+#include "Meshlets.hpp"
 
 // auxiliar struct for loading all model-related data
 struct Model {
@@ -11,30 +13,113 @@ struct Model {
 	GeometryRenderer buffers;
 	Material material;
 	Texture texture;
+	// simplified versions of buffers, with fLods (see selectLod)
+	std::vector<GeometryRenderer> lods;
 	
 	Model() = default;
 	
-	Model(Geometry &&g, const Material &m, int flags) 
-		: buffers(g,flags&fDynamic), material(m), 
-		  texture(m.texture.empty() or (flags&fNoTextures) 
-	           ? Texture() 
-			   : Texture(m.texture, model2texture(flags)) )
+	// (clusters are optimizeMeshlets' ones, if it was applied to g)
+	Model(Geometry &&g, const Material &m, int flags, const std::vector<int> &clusters={}) 
+		: buffers(g,flags&fDynamic,model2layout(flags),not (flags&fMeshlets)), material(m), 
+		  texture(loadTexture(m,flags))
 	{
+		lod_triangles[0] = (g.triangles.empty() ? g.positions.size() : g.triangles.size())/3;
+		if (flags&fMeshlets and not g.triangles.empty()) meshlets.push_back(buildMeshlets(g,clusters));
+		if (flags&fLods) buildLods(g,flags);
 		if (flags&fKeepGeometry) geometry = std::move(g);
 	}
 	
+	Model(const GeometryView &g, const Material &m, int flags, const std::vector<int> &clusters={}) 
+		: buffers(g,flags&fDynamic,model2layout(flags),not (flags&fMeshlets)), material(m), 
+		  texture(loadTexture(m,flags))
+	{
+		lod_triangles[0] = (g.triangles ? g.index_count : g.vertex_count)/3;
+		if (flags&fMeshlets and g.triangles) meshlets.push_back(buildMeshlets(g,clusters));
+		if (flags&fLods or flags&fKeepGeometry) {
+			Geometry copy = g.copy();
+			if (flags&fLods) buildLods(copy,flags);
+			if (flags&fKeepGeometry) geometry = std::move(copy);
+		}
+	}
+	
 	// flags meanings are such that 0 is default behaviour and it matches 
 	// what obj (texture repeat and flipV) and most examples (fit, static data 
-	// and discard geometry) expects
+	// and discard geometry) expects; the final geometry is cached in a .cgmesh
+	// file next to the .obj unless fNoCache is given (see MeshCache); 
+	// fInterleaved stores the vertexes in a single buffer, and fQuantized
+	// does it with half the size (static geometry only, see GeometryRenderer,
+	// and quantized needs shaders that decode it); obj triangles and vertexes
+	// are reordered for the GPU (see MeshOptimizer) unless fDontOptimize is 
+	// given, fOptimizeOverdraw adds optimizeOverdraw to that; fLods also builds coarser versions of the geometry (see 
+	// selectLod and MeshSimplifier); fMeshlets splits each level in 
+	// clusters that can be culled before drawing (see getMeshlets); obj
+	// parts get their vertexes welded and degenerate triangles dropped (see
+	// cleanMesh and weld_epsilon) unless fDontClean is given; a name
+	// ending in .glb is loaded as binary glTF instead (see GlbMesh)
 	enum Flags { fNone=0, fDontFit=1, fKeepGeometry=2, 
 				 fRegenerateNormals=4, fDynamic=8,
-		         fNoTextures=16, fTextureDontFlipV=32, fTextureClamp=64 };
+		         fNoTextures=16, fTextureDontFlipV=32, fTextureClamp=64,
+		         fParallelLoad=128, fNoCache=256, fInterleaved=512,
+		         fQuantized=1024, fDontOptimize=2048, fLods=4096,
+		         fMeshlets=8192, fDontClean=16384, fOptimizeOverdraw=32768 };
+	// epsilon for that cleanup (positions are already fitted to the unit
+	// cube, unless fDontFit); caches built with another one are discarded
+	static float weld_epsilon;
 	static std::vector<Model> load(const std::string &name, int flags = 0);
 	static Model loadSingle(const std::string &name, int flags = 0);
 	
+	// uploads a part compiled into the program, with no file access nor
+	// parsing (except for its texture, if any); the geometry is used as it
+	// was when generated, so fit and normals flags are ignored here
+	static Model fromEmbedded(const EmbeddedMesh &part, int flags = 0);
+	template<size_t N> 
+	static std::vector<Model> fromEmbedded(const EmbeddedMesh (&parts)[N], int flags = 0) {
+		std::vector<Model> vret;
+		vret.reserve(N);
+		for (const EmbeddedMesh &part : parts)
+			vret.push_back(fromEmbedded(part,flags));
+		return vret;
+	}
+	// writes a header that defines embedded::<header's file name> as the
+	// array of parts of name's obj (after loading it with these flags, so
+	// cleanMesh and optimizeMesh run unless they say otherwise), to be used
+	// with fromEmbedded; returns false if it could not be written
+	static bool writeEmbedded(const std::string &name, const std::string &header_path, int flags = 0);
+	
 	bool isOk() const { return buffers.isOk(); }
+	
+	// the coarsest level whose error, projected with these matrixes on a 
+	// viewport that is viewport_height pixels tall, is at most max_pixels;
+	// level 0 is buffers, and level i is lods[i-1]
+	int selectLod(const glm::mat4 &model_view, const glm::mat4 &projection, 
+				  int viewport_height, float max_pixels=1.f) const;
+	const GeometryRenderer &getLod(int level) const { return level==0 ? buffers : lods[level-1]; }
+	int getLodCount() const { return lods.size()+1; }
+	int getLodTriangles(int level) const { return lod_triangles[level]; }
+	// with fMeshlets, the ones of that level (with cullMeshlets giving the
+	// ranges of getLod(level) to draw)
+	const std::vector<Meshlet> &getMeshlets(int level) const { return meshlets[level]; }
+	bool hasMeshlets() const { return not meshlets.empty(); }
 		
 private:
+	void buildLods(const Geometry &g, int flags);
+	// for each level (0 included, whose error is always 0): its error (in
+	// model units) and triangles
+	std::vector<float> lod_errors = {0.f};
+	std::vector<int> lod_triangles = {0};
+	glm::vec3 lod_center = {0.f,0.f,0.f}; // (of the bounding box)
+	std::vector<std::vector<Meshlet>> meshlets; // (by level)
+
+	static Texture loadTexture(const Material &m, int flags) {
+		return m.texture.empty() or (flags&fNoTextures) 
+			? Texture() 
+			: Texture(m.texture, model2texture(flags));
+	}
+	static GeometryRenderer::Layout model2layout(int flags) {
+		return (flags&fQuantized) ? GeometryRenderer::lQuantized
+			: (flags&fInterleaved) ? GeometryRenderer::lInterleaved 
+			: GeometryRenderer::lSeparate;
+	}
 	static int model2texture(int flags) {
 		return 
 			((flags&fTextureClamp)?(Texture::fClampS|Texture::fClampT):0)
@@ -43,6 +128,8 @@ private:
 };
 
 void centerAndResize(std::vector<glm::vec3> &v);
+// same, but with an already known bounding box (that can include more points)
+void centerAndResize(std::vector<glm::vec3> &v, glm::vec3 pmin, glm::vec3 pmax);
 
 #endif
 
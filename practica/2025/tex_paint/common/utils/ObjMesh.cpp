@@ -1,60 +1,116 @@
-#include <fstream>
 #include <map>
+#include <memory_resource>
 #include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <exception>
 #include <glm/glm.hpp>
 #include "ObjMesh.hpp"
 #include "Debug.hpp"
 #include "Misc.hpp"
-#include <unordered_map>
+#include "MappedFile.hpp"
+#include "VertexTable.hpp"
 
 namespace {
 
-float readInt(const std::string &s, int &i) {
-	char *p = const_cast<char*>(s.c_str())+i;
-	int r = std::strtol(p,&p,10);
-	i = p-s.c_str();
+// helpers for parsing numbers from a line of a mapped file: i is the position
+// of the next char to read, leading blanks are skipped (as strtof/strtol did)
+
+void skipBlanks(std::string_view s, size_t &i) {
+	while (i<s.size() and (s[i]==' ' or s[i]=='\t')) ++i;
+}
+
+int readInt(std::string_view s, size_t &i) {
+	skipBlanks(s,i);
+	if (i<s.size() and s[i]=='+') ++i;
+	int r = 0;
+	i = std::from_chars(s.data()+i,s.data()+s.size(),r).ptr-s.data();
 	return r;
 }
 
-float readFloat(const std::string &s, int &i) {
-	char *p = const_cast<char*>(s.c_str())+i;
-	float r = std::strtof(p,&p);
-	i = p-s.c_str();
+float readFloat(std::string_view s, size_t &i) {
+	skipBlanks(s,i);
+	if (i<s.size() and s[i]=='+') ++i;
+	float r = 0.f;
+	i = std::from_chars(s.data()+i,s.data()+s.size(),r).ptr-s.data();
 	return r;
 }
 
-float readFloat(const std::string &s, const int &i) {
-	int j = i; return readFloat(s,j);
+float readFloat(std::string_view s, const size_t &i) {
+	size_t j = i; return readFloat(s,j);
 }
 
-glm::vec3 readVec3(const std::string &s, int i) {
+glm::vec3 readVec3(std::string_view s, size_t i) {
 	glm::vec3 v;
-	v.x = readFloat(s,i); ++i;
-	v.y = readFloat(s,i); ++i;
+	v.x = readFloat(s,i);
+	v.y = readFloat(s,i);
 	v.z = readFloat(s,i);
 	return v;
 }
 
-glm::vec2 readVec2(const std::string &s, int i) {
+glm::vec2 readVec2(std::string_view s, size_t i) {
 	glm::vec2 v;
-	v.x = readFloat(s,i); ++i;
+	v.x = readFloat(s,i);
 	v.y = readFloat(s,i);
 	return v;
 }
 
-std::map<std::string,Material> loadMaterialsLib(const std::string &path, const std::string &filename) {
-	cg_info( "Reading mtl file: " + path+filename + "...");
-	std::ifstream file(path+filename);
-	cg_assert(file.is_open(),"Could not open mtl file");
+// gets the next non-empty, non-comment line of the text starting at pos, with
+// the end-of-line chars already removed (lines are views into the mapping);
+// returns false if there were no more lines
+bool nextLine(std::string_view text, size_t &pos, std::string_view &line) {
+	while (pos<text.size()) {
+		auto p = text.data()+pos, end = text.data()+text.size();
+		auto eol = static_cast<const char*>(std::memchr(p,'\n',end-p));
+		if (not eol) eol = end;
+		line = std::string_view(p,eol-p);
+		pos = eol==end ? text.size() : eol+1-text.data();
+		if (line.empty() or line[0]=='#' or line[0]=='\r') continue;
+		if (line.back()=='\r') line.remove_suffix(1);
+		return true;
+	}
+	return false;
+}
+
+// calls func(line) for every line that nextLine would return
+template<typename TFunc>
+void forEachLine(std::string_view text, TFunc func) {
+	size_t pos = 0;
+	std::string_view line;
+	while (nextLine(text,pos,line))
+		func(line);
+}
+
+// as forEachLine, but dropping the pages already read every few MBs, so a
+// pass over a huge file doesn't keep all of it in memory
+template<typename TFunc>
+void forEachLine(MappedFile &file, TFunc func) {
+	constexpr size_t discard_step = 16<<20;
+	size_t pos = 0, discarded = 0;
+	std::string_view line;
+	while (nextLine(file.view(),pos,line)) {
+		func(line);
+		if (pos-discarded>=discard_step) file.discard(discarded = pos);
+	}
+	file.discard(pos);
+}
+
+std::pmr::map<std::string,Material> loadMaterialsLib(const std::string &path, std::string_view filename,
+													 std::pmr::memory_resource *resource) {
+	std::string full_path = path+std::string(filename);
+	cg_info( "Reading mtl file: " + full_path + "...");
+	MappedFile file(full_path);
+	cg_assert(file.isOk(),"Could not open mtl file");
 	
-	std::map<std::string,Material> lib;
+	std::pmr::map<std::string,Material> lib(resource);
 	Material *current_material = nullptr;
-	for(std::string line; std::getline(file,line); ) {
-		if (line.empty() or line[0]=='#' or line[0]=='\r') continue;
-		if (line[line.size()-1]=='\r') line.erase(line.size()-1);
+	forEachLine(file.view(), [&](std::string_view line) {
 		if (startsWith(line,"newmtl ")) {
-			cg_assert(lib.count(line.substr(7))==0,"Duplicate material name");
-			current_material = &lib[line.substr(7)];
+			std::string name(line.substr(7));
+			cg_assert(lib.count(name)==0,"Duplicate material name");
+			current_material = &lib[name];
 		} else {
 			cg_assert(current_material,"Material property before command newmtl");
 			if (startsWith(line,"Ks ")) {
@@ -72,85 +128,197 @@ std::map<std::string,Material> loadMaterialsLib(const std::string &path, const s
 			} else if (startsWith(line,"Tr ")) {
 				current_material->opacity = 1.f-readFloat(line,3);				
 			} else if (startsWith(line,"map_Kd ")) {
-				current_material->texture = path+line.substr(7);
+				current_material->texture = path+std::string(line.substr(7));
 			}
 		}
-	}
+	});
 	return lib;
 }
 
+ObjMesh::Element readFace(std::string_view line) {
+	ObjMesh::Element e; 
+	size_t is = 2, l = line.size(); int in = 0;
+	skipBlanks(line,is);
+	while(is<l) {
+		cg_assert(in<4,"Face with more than 4 vertexes are not supported yet");
+		e.pos[in] = readInt(line,is)-1;
+		if (is<l and line[is]=='/') {
+			if (++is<l and line[is]=='/') {
+				e.tcs[in] = -1;
+				e.norms[in] = readInt(line,++is)-1;
+			} else {
+				e.tcs[in] = readInt(line,is)-1;
+				if (is<l and line[is]=='/') {
+					e.norms[in] = readInt(line,++is)-1;
+				} else {
+					e.norms[in] = -1;
+				}
+			}
+		} else {
+			e.tcs[in] = -1;
+			e.norms[in] = -1;
+		}
+		++in;
+		skipBlanks(line,is);
+	}
+	cg_assert(in>2,"Face with less than 3 vertexes");
+	if (in==3) e.pos[3] = e.norms[3] = e.tcs[3] = -1;
+	return e;
 }
 
-ObjMesh readObj(const std::string &full_path) {
-	cg_info( "Reading obj file: " + full_path + "..." );
-	std::string path = extractFolder(full_path);
-	std::ifstream file(full_path);
-	cg_assert(file.is_open(),"Could not open obj file: "+full_path);
-	
-	ObjMesh meshes;
-	ObjMesh::Part *current_part = nullptr;
-	std::map<std::string,Material> materials_lib;
-	std::string current_name;
-	
-	for(std::string line; std::getline(file,line); ) {
-		if (line.empty() or line[0]=='#' or line[0]=='\r') continue;
-		if (line[line.size()-1]=='\r') line.erase(line.size()-1);
+// what a worker extracts from a range of lines of the obj file; records that
+// define the parts are kept as events to be replayed in order while stitching
+struct ObjChunk {
+	ObjChunk(std::pmr::memory_resource *resource) : elements(resource), events(resource) {}
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> tex_coords;
+	std::pmr::vector<ObjMesh::Element> elements; // only needed until they're copied to the parts
+	struct Event {
+		enum Type { Object, MtlLib, UseMtl, Touch } type; // Touch: a line that needs a part to exist
+		size_t first_element; // number of this chunk's elements that come before the event
+		std::string_view arg;
+	};
+	std::pmr::vector<Event> events;
+	std::exception_ptr error;
+};
+
+void parseChunk(std::string_view text, ObjChunk &chunk) {
+	bool has_part = false; // after an "o" or a Touch, the current part can't be null
+	auto addEvent = [&chunk](ObjChunk::Event::Type type, std::string_view arg) {
+		chunk.events.push_back({type,chunk.elements.size(),arg});
+	};
+	forEachLine(text, [&](std::string_view line) {
 		if (startsWith(line,"o ")) {
-			meshes.parts.push_back({}); 
-			current_part = &meshes.parts.back();
-			current_name = current_part->name = line.substr(2);
+			addEvent(ObjChunk::Event::Object,line.substr(2));
+			has_part = true;
 		} else if (startsWith(line,"mtllib ")) {
-			materials_lib = loadMaterialsLib(path,line.substr(7));
+			addEvent(ObjChunk::Event::MtlLib,line.substr(7));
 		} else {
-			if (not current_part) {
-				meshes.parts.push_back({});
-				current_part = &meshes.parts.back();
+			if (not has_part) {
+				addEvent(ObjChunk::Event::Touch,{});
+				has_part = true;
 			}
 			if (startsWith(line,"v ")) {
-				meshes.positions.push_back(readVec3(line,2));
+				chunk.positions.push_back(readVec3(line,2));
 			} else if (startsWith(line,"vn ")) {
-				meshes.normals.push_back(readVec3(line,3));
+				chunk.normals.push_back(readVec3(line,3));
 			} else if (startsWith(line,"vt ")) {
-				meshes.tex_coords.push_back(readVec2(line,3));
+				chunk.tex_coords.push_back(readVec2(line,3));
 			} else if (startsWith(line,"f ")) {
-				ObjMesh::Element e; 
-				int is = 2, in = 0, l = line.size();
-				while(is<l) {
-					cg_assert(in<4,"Face with more than 4 vertexes are not supported yet");
-					e.pos[in] = readInt(line,is)-1;
-					if (line[is]=='/') {
-						if (line[++is]=='/') {
-							e.tcs[in] = -1;
-							e.norms[in] = readInt(line,++is)-1;
-						} else {
-							e.tcs[in] = readInt(line,is)-1;
-							if (line[is]=='/') {
-								e.norms[in] = readInt(line,++is)-1;
-							} else {
-								e.norms[in] = -1;
-							}
-						}
-					} else {
-						e.tcs[in] = -1;
-						e.norms[in] = -1;
-					}
-					++in;
-				}
-				cg_assert(in>2,"Face with less than 3 vertexes");
-				if (in==3) e.pos[3] = e.norms[3] = e.tcs[3] = -1;
-				current_part->elements.push_back(e);
+				chunk.elements.push_back(readFace(line));
 			} else if (startsWith(line,"usemtl ")) {
+				addEvent(ObjChunk::Event::UseMtl,line.substr(7));
+			}
+		}
+	});
+}
+
+// splits the text in n ranges of similar size, cutting only at line ends
+std::vector<std::string_view> splitLines(std::string_view text, int n) {
+	std::vector<std::string_view> vret;
+	size_t beg = 0;
+	for(int i=1;i<=n and beg<text.size();++i) {
+		size_t end = i==n ? text.size() : std::max(beg,text.size()*i/n);
+		if (end<text.size()) {
+			end = text.find('\n',end);
+			end = end==std::string_view::npos ? text.size() : end+1;
+		}
+		vret.push_back(text.substr(beg,end-beg));
+		beg = end;
+	}
+	return vret;
+}
+
+template<typename T>
+void append(std::vector<T> &dst, std::vector<T> &src) {
+	if (dst.empty()) dst = std::move(src);
+	else dst.insert(dst.end(),src.begin(),src.end());
+}
+
+}
+
+ObjMesh readObj(const std::string &full_path, int threads, Arena *arena) {
+	cg_info( "Reading obj file: " + full_path + "..." );
+	std::string path = extractFolder(full_path);
+	MappedFile file(full_path);
+	cg_assert(file.isOk(),"Could not open obj file: "+full_path);
+	
+	// parse the chunks (the first one in this thread, the rest in workers)
+	constexpr size_t min_chunk_size = 64*1024;
+	if (threads<=0) threads = std::max(1u,std::thread::hardware_concurrency());
+	threads = static_cast<int>(std::min<size_t>(threads,file.size()/min_chunk_size+1));
+	std::vector<std::string_view> texts = splitLines(file.view(),threads);
+	std::pmr::memory_resource *resource = getResource(arena);
+	std::vector<ObjChunk> chunks;
+	chunks.reserve(texts.size());
+	for(size_t i=0;i<texts.size();++i)
+		chunks.emplace_back(resource);
+	auto parse = [&](int i) {
+		try { parseChunk(texts[i],chunks[i]); } 
+		catch(...) { chunks[i].error = std::current_exception(); }
+	};
+	std::vector<std::thread> workers;
+	for(size_t i=1;i<chunks.size();++i) 
+		workers.emplace_back(parse,i);
+	if (not chunks.empty()) parse(0);
+	for(std::thread &w : workers) 
+		w.join();
+	for(ObjChunk &chunk : chunks)
+		if (chunk.error) std::rethrow_exception(chunk.error);
+	
+	// stitch them together, replaying the events as a serial parser would
+	ObjMesh meshes;
+	ObjMesh::Part *current_part = nullptr;
+	std::pmr::map<std::string,Material> materials_lib(resource);
+	std::string current_name;
+	
+	for(ObjChunk &chunk : chunks) {
+		append(meshes.positions,chunk.positions);
+		append(meshes.normals,chunk.normals);
+		append(meshes.tex_coords,chunk.tex_coords);
+		size_t next_element = 0;
+		auto addElements = [&](size_t end) {
+			if (end==next_element) return;
+			current_part->elements.insert(current_part->elements.end(),
+										  chunk.elements.begin()+next_element,
+										  chunk.elements.begin()+end);
+			next_element = end;
+		};
+		for(const ObjChunk::Event &ev : chunk.events) {
+			addElements(ev.first_element);
+			switch(ev.type) {
+			case ObjChunk::Event::Object:
+				meshes.parts.push_back({}); 
+				current_part = &meshes.parts.back();
+				current_name = current_part->name = std::string(ev.arg);
+				break;
+			case ObjChunk::Event::MtlLib:
+				materials_lib = loadMaterialsLib(path,ev.arg,resource);
+				meshes.material_libs.push_back(path+std::string(ev.arg));
+				break;
+			case ObjChunk::Event::Touch:
+				if (not current_part) {
+					meshes.parts.push_back({});
+					current_part = &meshes.parts.back();
+				}
+				break;
+			case ObjChunk::Event::UseMtl: {
 				if (not current_part->elements.empty()) {
 					meshes.parts.push_back({}); 
 					current_part = &meshes.parts.back();
 				}
-				current_part->name = current_name+":"+line.substr(7);
-				if  (line.substr(7)!="None") {
-					cg_assert(materials_lib.count(line.substr(7)),"Material not found: "+line.substr(7));
-					current_part->material = materials_lib[line.substr(7)];
+				std::string mtl_name(ev.arg);
+				current_part->name = current_name+":"+mtl_name;
+				if  (mtl_name!="None") {
+					auto it = materials_lib.find(mtl_name);
+					cg_assert(it!=materials_lib.end(),"Material not found: "+mtl_name);
+					current_part->material = it->second;
 				}
+			} break;
 			}
 		}
+		addElements(chunk.elements.size());
 	}
 	cg_assert(not meshes.parts.empty(),"No mesh object found in file");
 	
@@ -172,30 +340,24 @@ ObjMesh readObj(const std::string &full_path) {
 //	return g;
 //}
 
-namespace std {
-	
-	template <> struct hash<std::tuple<int,int,int>> {
-		std::size_t operator()(const std::tuple<int,int,int>& p) const {
-			return ( ( hash<int>()(std::get<0>(p))
-		               ^ (hash<int>()(std::get<1>(p)) << 1) ) >> 1)
-				   ^ (hash<int>()(std::get<0>(p)) << 1);
-		}
-	};
-	
-}
-
-Geometry toGeometry(const ObjMesh &obj, const ObjMesh::Part &part) {
+Geometry toGeometry(const ObjMesh &obj, const ObjMesh::Part &part, Arena *arena) {
 	Geometry g;
-	std::unordered_map<std::tuple<int,int,int>,int> map;
-	auto addVertex = [&g,&obj,&map](const ObjMesh::Element &e, int inode) {
-		auto t = std::make_tuple(e.pos[inode],e.norms[inode],e.tcs[inode]);
-		auto p = map.insert({t,g.positions.size()});
-		if (p.second) {
+	size_t corners = 0, indexes = 0;
+	for(const ObjMesh::Element &e : part.elements) {
+		corners += e.pos[3]==-1 ? 3 : 4;
+		indexes += e.pos[3]==-1 ? 3 : 6;
+	}
+	g.triangles.reserve(indexes);
+	VertexTable table(corners,obj.positions.size(),obj.normals.size(),obj.tex_coords.size(),getResource(arena));
+	auto addVertex = [&g,&obj,&table](const ObjMesh::Element &e, int inode) {
+		bool inserted;
+		int index = table.insert(e.pos[inode],e.norms[inode],e.tcs[inode],g.positions.size(),inserted);
+		if (inserted) {
 			g.positions.push_back(obj.positions[e.pos[inode]]);
 			if (e.norms[inode]!=-1) g.normals.push_back(obj.normals[e.norms[inode]]);
 			if (e.tcs[inode]!=-1) g.tex_coords.push_back(obj.tex_coords[e.tcs[inode]]);
 		}
-		g.triangles.push_back(p.first->second);
+		g.triangles.push_back(index);
 	};
 	for(const ObjMesh::Element &e : part.elements) {
 		addVertex(e,0); addVertex(e,1); addVertex(e,2);
@@ -205,12 +367,12 @@ Geometry toGeometry(const ObjMesh &obj, const ObjMesh::Part &part) {
 	return g;
 }
 
-Geometry toGeometry(const ObjMesh &obj, int ipart) {
-	return toGeometry(obj,obj.parts[ipart]);
+Geometry toGeometry(const ObjMesh &obj, int ipart, Arena *arena) {
+	return toGeometry(obj,obj.parts[ipart],arena);
 }
 
-Geometry toGeometry(const ObjMesh &obj, const std::string &name) {
-	return toGeometry(obj,obj.getPart(name));
+Geometry toGeometry(const ObjMesh &obj, const std::string &name, Arena *arena) {
+	return toGeometry(obj,obj.getPart(name),arena);
 }
 
 const ObjMesh::Part &ObjMesh::getPart(const std::string &name) const {
@@ -222,3 +384,125 @@ const ObjMesh::Part &ObjMesh::getPart(const std::string &name) const {
 	return *it;
 }
 
+
+ObjStream::ObjStream(const std::string &full_path, bool regenerate_normals, int batch_triangles)
+	: m_file(full_path), m_batch_triangles(batch_triangles), 
+	  m_regenerate_normals(regenerate_normals),
+	  m_start_time(std::chrono::steady_clock::now())
+{
+	cg_info( "Streaming obj file: " + full_path + "..." );
+	cg_assert(m_file.isOk(),"Could not open obj file: "+full_path);
+	cg_assert(batch_triangles>0,"Invalid batch size for ObjStream");
+	m_stats.bytes = m_file.size();
+	
+	// a first pass only counts the records, so the arrays are allocated once
+	// with their final sizes (growing them could double the peak memory)
+	size_t normals_count = 0, tex_coords_count = 0;
+	forEachLine(m_file, [&](std::string_view line) {
+		if (startsWith(line,"v ")) ++m_positions_count;
+		else if (startsWith(line,"vn ")) ++normals_count;
+		else if (startsWith(line,"vt ")) ++tex_coords_count;
+		else if (startsWith(line,"f ")) ++m_faces_count;
+	});
+	m_positions.reserve(m_positions_count);
+	m_normals.reserve(regenerate_normals ? m_positions_count : normals_count);
+	m_tex_coords.reserve(tex_coords_count);
+	
+	if (regenerate_normals) { // as Geometry::generateNormals, but per position
+		m_normals.resize(m_positions_count);
+		auto addNormal = [this](int i0, int i1, int i2) {
+			auto n = glm::cross( m_positions[i2]-m_positions[i1], m_positions[i0]-m_positions[i1] );
+			m_normals[i0] += n; m_normals[i1] += n; m_normals[i2] += n;
+		};
+		forEachLine(m_file, [&](std::string_view line) {
+			if (startsWith(line,"v ")) {
+				m_positions.push_back(readVec3(line,2));
+			} else if (startsWith(line,"f ")) {
+				ObjMesh::Element e = readFace(line);
+				for(int j=0;j<4 and e.pos[j]!=-1;++j)
+					cg_assert(e.pos[j]>=0 and e.pos[j]<static_cast<int>(m_positions.size()),
+							  "Invalid position index in face");
+				addNormal(e.pos[0],e.pos[1],e.pos[2]);
+				if (e.pos[3]!=-1) addNormal(e.pos[0],e.pos[2],e.pos[3]);
+			}
+		});
+		for(auto &n : m_normals) 
+			if (glm::dot(n,n)!=0) 
+				n = glm::normalize(n);
+	}
+	
+	m_table = VertexTable(3*(batch_triangles+1), m_positions_count,
+						  regenerate_normals ? 0 : normals_count, tex_coords_count);
+}
+
+bool ObjStream::next(Geometry &batch) {
+	batch.positions.clear();
+	batch.normals.clear();
+	batch.tex_coords.clear();
+	batch.triangles.clear();
+	m_table.clear();
+	
+	int base = m_stats.vertexes, triangles = 0;
+	auto addVertex = [&](const ObjMesh::Element &e, int inode) {
+		int pos = e.pos[inode], tc = e.tcs[inode];
+		int norm = m_regenerate_normals ? -1 : e.norms[inode];
+		cg_assert(pos>=0 and pos<static_cast<int>(m_positions.size())
+				  and norm<static_cast<int>(m_normals.size())
+				  and tc<static_cast<int>(m_tex_coords.size()), "Invalid index in face");
+		bool inserted;
+		int index = m_table.insert(pos,norm,tc,batch.positions.size(),inserted);
+		if (inserted) {
+			batch.positions.push_back(m_positions[pos]);
+			if (m_regenerate_normals) batch.normals.push_back(m_normals[pos]);
+			else if (norm!=-1) batch.normals.push_back(m_normals[norm]);
+			if (tc!=-1) batch.tex_coords.push_back(m_tex_coords[tc]);
+		}
+		batch.triangles.push_back(base+index);
+	};
+	
+	std::string_view text = m_file.view(), line;
+	while (triangles<m_batch_triangles and nextLine(text,m_offset,line)) {
+		if (startsWith(line,"v ")) {
+			if (not m_regenerate_normals) m_positions.push_back(readVec3(line,2));
+		} else if (startsWith(line,"vn ")) {
+			if (not m_regenerate_normals) m_normals.push_back(readVec3(line,3));
+		} else if (startsWith(line,"vt ")) {
+			m_tex_coords.push_back(readVec2(line,3));
+		} else if (startsWith(line,"f ")) {
+			ObjMesh::Element e = readFace(line);
+			addVertex(e,0); addVertex(e,1); addVertex(e,2);
+			++triangles;
+			if (e.pos[3]==-1) continue;
+			addVertex(e,0); addVertex(e,2); addVertex(e,3);
+			++triangles;
+		}
+	}
+	m_file.discard(m_offset);
+	
+	m_stats.vertexes += batch.positions.size();
+	m_stats.triangles += triangles;
+	m_stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-m_start_time).count();
+	m_stats.peak_memory = getPeakMemoryUsage();
+	if (triangles==0) return false;
+	++m_stats.batches;
+	return true;
+}
+
+GeometryRenderer streamObj(const std::string &full_path, bool regenerate_normals, ObjStream::Stats *stats) {
+	ObjStream stream(full_path,regenerate_normals);
+	GeometryRenderer renderer;
+	Geometry batch;
+	while (stream.next(batch)) {
+		renderer.append(batch);
+		if (stream.getStats().batches==1) // exact for closed triangle meshes, the buffers grow if not
+			renderer.reserve(static_cast<int>(stream.getPositionsCount()),
+							 static_cast<int>(3*stream.getFacesCount()));
+	}
+	cg_assert(renderer.isOk(),"No faces found in file");
+	const ObjStream::Stats &s = stream.getStats();
+	cg_info( "  " + std::to_string(s.triangles) + " triangles in " + std::to_string(s.batches)
+			 + " batches, " + std::to_string(s.bytes/s.seconds/(1<<20)) + " MB/s, peak memory "
+			 + std::to_string(s.peak_memory>>20) + " MB" );
+	if (stats) *stats = s;
+	return renderer;
+}
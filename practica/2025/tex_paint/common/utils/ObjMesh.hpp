@@ -3,11 +3,15 @@
 
 #include <vector>
 #include <string>
+#include <chrono>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include "ObjMesh.hpp"
 #include "Material.hpp"
 #include "Geometry.hpp"
+#include "MappedFile.hpp"
+#include "VertexTable.hpp"
+#include "Arena.hpp"
 
 struct ObjMesh {
 	
@@ -27,14 +31,60 @@ struct ObjMesh {
 	};
 	std::vector<Part> parts;
 	
+	std::vector<std::string> material_libs; // full paths of the mtl files used
+	
 	const Part &getPart(const std::string &name) const;
 	
 };
 
-ObjMesh readObj(const std::string &full_path);
+// threads>1 splits the file and parses the chunks in parallel (0 means one
+// per core), the result is exactly the same as with a single thread; the
+// temporary data is allocated in arena if given (the result never is)
+ObjMesh readObj(const std::string &full_path, int threads=1, Arena *arena=nullptr);
+
+Geometry toGeometry(const ObjMesh &obj, const ObjMesh::Part &part, Arena *arena=nullptr);
+Geometry toGeometry(const ObjMesh &obj, int ipart=0, Arena *arena=nullptr);
+Geometry toGeometry(const ObjMesh &obj, const std::string &name, Arena *arena=nullptr);
+
+// reads an obj in batches of faces, for meshes too big to hold as an ObjMesh
+// plus a Geometry plus the GL buffers; each batch is deduplicated on its own
+// (vertexes shared by two batches are repeated) and its indexes are global, so
+// the batches can be appended to a GeometryRenderer one after the other; only
+// the v/vn/vt arrays live for the whole read, and objects and materials are
+// ignored (all the faces end up in a single geometry)
+class ObjStream {
+public:
+	struct Stats {
+		size_t bytes = 0, vertexes = 0, triangles = 0, batches = 0;
+		size_t peak_memory = 0; // peak resident memory of the whole process
+		double seconds = 0;
+	};
+	
+	// regenerate_normals ignores the obj's normals and computes smooth ones per
+	// position (with an extra pass over the file, since they need every face)
+	ObjStream(const std::string &full_path, bool regenerate_normals=false, int batch_triangles=1<<18);
+	// replaces batch's contents with the next faces, false if there were no more
+	bool next(Geometry &batch);
+	
+	const Stats &getStats() const { return m_stats; }
+	size_t getPositionsCount() const { return m_positions_count; }
+	size_t getFacesCount() const { return m_faces_count; }
+	
+private:
+	MappedFile m_file;
+	size_t m_offset = 0, m_positions_count = 0, m_faces_count = 0;
+	int m_batch_triangles;
+	bool m_regenerate_normals;
+	std::vector<glm::vec3> m_positions, m_normals;
+	std::vector<glm::vec2> m_tex_coords;
+	VertexTable m_table;
+	Stats m_stats;
+	std::chrono::steady_clock::time_point m_start_time;
+};
 
-Geometry toGeometry(const ObjMesh &obj, const ObjMesh::Part &part);
-Geometry toGeometry(const ObjMesh &obj, int ipart=0);
-Geometry toGeometry(const ObjMesh &obj, const std::string &name);
+// loads the whole obj through an ObjStream, appending every batch to the
+// returned renderer as soon as it is read
+GeometryRenderer streamObj(const std::string &full_path, bool regenerate_normals=false,
+						   ObjStream::Stats *stats=nullptr);
 
 #endif
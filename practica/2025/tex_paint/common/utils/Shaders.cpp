@@ -6,33 +6,46 @@
 #include "Shaders.hpp"
 #include "Debug.hpp"
 #include "Misc.hpp"
-
-static std::string getShaderSource(std::string file_path) {
-	std::ifstream fs(file_path,std::ios::binary);
-	cg_assert(fs.is_open(),"Could not open "+std::string(file_path));
+#include "Archive.hpp"
+
+// appends the contents of the file to source, replacing every #include line
+// with the included file's (recursively), and with every end-of-line as '\n'
+static void appendShaderSource(const std::string &file_path, std::pmr::string &source) {
+	std::string_view text;
+	std::pmr::string content(source.get_allocator());
+	if (not Archive::find(file_path,text)) {
+		// shaders are small, so a single read is faster than mapping them
+		std::ifstream fs(file_path,std::ios::binary|std::ios::ate);
+		cg_assert(fs.is_open(),"Could not open "+std::string(file_path));
+		content.resize(static_cast<size_t>(fs.tellg()));
+		fs.seekg(0);
+		fs.read(content.data(),content.size());
+		text = content;
+	}
 	
-	std::string folder = extractFolder(file_path);
-	std::string full_content;
-	for(std::string line; std::getline(fs,line); ) {
-		fixEOL(line);
+	while (not text.empty()) {
+		size_t eol = text.find('\n');
+		std::string_view line = text.substr(0,eol);
+		text.remove_prefix(eol==std::string_view::npos ? text.size() : eol+1);
+		if (not line.empty() and line.back()=='\r') line.remove_suffix(1);
 		if (startsWith(line,"#include ")) {
 			auto p = line.find('\"');
-			cg_assert(p!=std::string::npos,file_path+": wrong #include syntax.");
-			line.erase(0,p+1);
-			p = line.find('\"');
-			line.erase(p);
-			line = getShaderSource(folder+line);
+			cg_assert(p!=std::string_view::npos,file_path+": wrong #include syntax.");
+			line.remove_prefix(p+1);
+			line = line.substr(0,line.find('\"'));
+			appendShaderSource(extractFolder(file_path)+std::string(line),source);
+		} else {
+			source.append(line);
 		}
-		full_content += line + '\n';
+		source += '\n';
 	}
-	
-	return full_content;
 }
 
-static GLuint loadAndCompile(GLenum shader_type, const std::string &file_path) {
+static GLuint loadAndCompile(GLenum shader_type, const std::string &file_path, Arena *arena) {
 	GLuint shader_id = glCreateShader(shader_type);
 	
-	std::string shader_code = getShaderSource(file_path);
+	std::pmr::string shader_code(getResource(arena));
+	appendShaderSource(file_path,shader_code);
 	
 	cg_info("Compiling shader: " + file_path + "...");
 	const char *shader_code_ptr = shader_code.c_str();
@@ -53,12 +66,12 @@ static GLuint loadAndCompile(GLenum shader_type, const std::string &file_path) {
 	return shader_id;
 }
 
-Shader::Shader (const std::string &vertex_fname, const std::string &fragment_fname) {
-	load(vertex_fname,fragment_fname);
+Shader::Shader (const std::string &vertex_fname, const std::string &fragment_fname, Arena *arena) {
+	load(vertex_fname,fragment_fname,arena);
 }
 
-Shader::Shader (const std::string &fname) {
-	load(fname+".vert",fname+".frag");
+Shader::Shader (const std::string &fname, Arena *arena) {
+	load(fname+".vert",fname+".frag",arena);
 }
 
 Shader::Shader(Shader &&other) {
@@ -73,15 +86,19 @@ Shader &Shader::operator=(Shader &&other) {
 	return *this;
 }
 
-void Shader::load(const std::string &vertex_fname, const std::string &fragment_fname) {
+void Shader::load(const std::string &vertex_fname, const std::string &fragment_fname, Arena *arena) {
 	cg_assert(program_id==0,"Shader already loaded");
-	GLuint vertex_id = loadAndCompile(GL_VERTEX_SHADER,vertex_fname);
-	GLuint fragment_id = loadAndCompile(GL_FRAGMENT_SHADER,fragment_fname);
+	GLuint vertex_id = loadAndCompile(GL_VERTEX_SHADER,vertex_fname,arena);
+	GLuint fragment_id = loadAndCompile(GL_FRAGMENT_SHADER,fragment_fname,arena);
 	
 	cg_info( "Linking shader program..." );
 	program_id = glCreateProgram();
 	glAttachShader(program_id,vertex_id);
 	glAttachShader(program_id,fragment_id);
+	// the locations GeometryRenderer's VAOs are configured for
+	glBindAttribLocation(program_id,GeometryRenderer::aPosition,"vertexPosition");
+	glBindAttribLocation(program_id,GeometryRenderer::aNormal,"vertexNormal");
+	glBindAttribLocation(program_id,GeometryRenderer::aTexCoords,"vertexTexCoords");
 	glLinkProgram(program_id);
 	
 	GLint result = GL_FALSE, log_len = 0;
@@ -99,10 +116,19 @@ void Shader::load(const std::string &vertex_fname, const std::string &fragment_f
 	
 	glDeleteShader(vertex_id);
 	glDeleteShader(fragment_id);
+	
+	// (explicit layout qualifiers in the shader take precedence over the bound ones)
+	loc_position = glGetAttribLocation(program_id, "vertexPosition");
+	loc_normal = glGetAttribLocation(program_id, "vertexNormal");
+	loc_tex_coords = glGetAttribLocation(program_id, "vertexTexCoords");
+	// (see shaders/funcs/decodeVertex.vert)
+	loc_quantized = glGetUniformLocation(program_id, "quantizedVertex");
+	loc_positions_offset = glGetUniformLocation(program_id, "positionsOffset");
+	loc_positions_scale = glGetUniformLocation(program_id, "positionsScale");
 }
 
-void Shader::load(const std::string &fname) {
-	load(fname+".vert",fname+".frag");
+void Shader::load(const std::string &fname, Arena *arena) {
+	load(fname+".vert",fname+".frag",arena);
 }
 
 
@@ -117,32 +143,19 @@ bool Shader::setBuffer (const char *name, GLuint id, GLenum type, int size, bool
 }
 
 void Shader::setBuffers (const GeometryRenderer & geo) {
-	glBindVertexArray(geo.vertexArray());
-	
-	{ // positions
-		glBindBuffer(GL_ARRAY_BUFFER,geo.positionsVBO());
-		GLint loc_pos = glGetAttribLocation(program_id, "vertexPosition"); 
-		cg_assert(loc_pos!=-1,"Shader does not have vertexPosition attribute");
-		glVertexAttribPointer(loc_pos, 3, GL_FLOAT, GL_FALSE, 0, 0);
-		glEnableVertexAttribArray(loc_pos);
-	}
-	
-	GLint loc_norm = glGetAttribLocation(program_id, "vertexNormal"); 
-	if (loc_norm!=-1) { // normals
-		cg_assert(geo.normalsVBO()!=0,"Geometry does not have normals");
-		glBindBuffer(GL_ARRAY_BUFFER,geo.normalsVBO());
-		glVertexAttribPointer(loc_norm, 3, GL_FLOAT, GL_FALSE, 0, 0);
-		glEnableVertexAttribArray(loc_norm);
-	}
-	
-	GLint loc_tc = glGetAttribLocation(program_id, "vertexTexCoords"); 
-	if (loc_tc!=-1) { // texture coords
-		glBindBuffer(GL_ARRAY_BUFFER,geo.texCoordsVBO());
-		cg_assert(geo.texCoordsVBO()!=0,"Geometry does not have texture coordinates");
-		glVertexAttribPointer(loc_tc, 2, GL_FLOAT, GL_FALSE, 0, 0);
-		glEnableVertexAttribArray(loc_tc);
-	}
-	
+	cg_assert(loc_position!=-1,"Shader does not have vertexPosition attribute");
+	cg_assert(loc_normal==-1 or geo.hasNormals(),"Geometry does not have normals");
+	cg_assert(loc_tex_coords==-1 or geo.hasTexCoords(),"Geometry does not have texture coordinates");
+	// nothing to do unless the shader overrides the fixed locations
+	geo.useAttributes(loc_position,loc_normal,loc_tex_coords);
+	if (geo.isQuantized()) {
+		cg_assert(loc_quantized!=-1,"Shader cannot decode quantized vertexes");
+		glUniform1i(loc_quantized,1);
+		glm::vec3 offset = geo.positionsOffset(), scale = geo.positionsScale();
+		glUniform3f(loc_positions_offset,offset.x,offset.y,offset.z);
+		glUniform3f(loc_positions_scale,scale.x,scale.y,scale.z);
+	} else if (loc_quantized!=-1)
+		glUniform1i(loc_quantized,0);
 }
 
 template<typename TFunc, typename... Ts>
@@ -189,6 +202,8 @@ void Shader::setMaterial (const Material &mat) {
 void Shader::unload() {
 	if (program_id!=0) glDeleteProgram(program_id);
 	program_id = 0;
+	loc_position = loc_normal = loc_tex_coords = -1;
+	loc_quantized = loc_positions_offset = loc_positions_scale = -1;
 }
 
 Shader::~Shader ( ) {
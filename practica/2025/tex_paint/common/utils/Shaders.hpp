@@ -5,6 +5,7 @@
 #include <glm/ext/matrix_float4x4.hpp>
 #include "Material.hpp"
 #include "Geometry.hpp"
+#include "Arena.hpp"
 
 class Shader {
 public:
@@ -12,13 +13,16 @@ public:
 	Shader(Shader &&other);
 	Shader &operator=(Shader &&other);
 	
-	Shader(const std::string &fname);
-	Shader(const std::string &vertex_fname, const std::string &fragment_fname);
+	// arena, if given, is used for the sources while they're read and compiled
+	Shader(const std::string &fname, Arena *arena=nullptr);
+	Shader(const std::string &vertex_fname, const std::string &fragment_fname, Arena *arena=nullptr);
 	
-	void load(const std::string &fname);
-	void load(const std::string &vertex_fname, const std::string &fragment_fname);
+	void load(const std::string &fname, Arena *arena=nullptr);
+	void load(const std::string &vertex_fname, const std::string &fragment_fname, Arena *arena=nullptr);
 	
 	bool setBuffer (const char *name, GLuint buffer_id, GLenum type, int size, bool required=true);
+	// the geometry's VAO is bound by its draw; for a quantized geometry it
+	// also sets the uniforms its decoding needs (so the shader must be in use)
 	void setBuffers(const GeometryRenderer &geo);
 	void setMaterial(const Material &mat);
 	void setMatrixes(const glm::mat4 &model, const glm::mat4 &view, const glm::mat4 &projection);
@@ -41,6 +45,8 @@ public:
 private:
 	Shader &operator=(const Shader &) = default;
 	GLuint program_id = 0;
+	GLint loc_position = -1, loc_normal = -1, loc_tex_coords = -1;
+	GLint loc_quantized = -1, loc_positions_offset = -1, loc_positions_scale = -1;
 };
 
 #endif
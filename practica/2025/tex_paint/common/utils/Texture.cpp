@@ -1,6 +1,8 @@
 #include <stb_image.h>
 #include "Texture.hpp"
 #include "Debug.hpp"
+#include "MappedFile.hpp"
+#include "GpuMemory.hpp"
 
 Texture::Texture(const std::string &fname, int flags) {
 	glGenTextures(1, &id);
@@ -13,10 +15,14 @@ Texture::Texture(const std::string &fname, int flags) {
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	// load image, create texture and generate mipmaps
 	stbi_set_flip_vertically_on_load(!(flags&fY0OnTop)); // tell stb_image.h to flip loaded texture's on the y-axis.
-	unsigned char *data = stbi_load(fname.c_str(), &width, &height, &channels, 0);
+	MappedFile file(fname); // maybe from an Archive
+	cg_assert(file.isOk(),"Could not open texture: "+fname);
+	unsigned char *data = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.data()), file.size(),
+												&width, &height, &channels, 0);
 	cg_assert(data,"Could not load texture: "+fname);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, channels==3?GL_RGB:GL_RGBA, GL_UNSIGNED_BYTE, data);
 	glGenerateMipmap(GL_TEXTURE_2D);
+	GpuMemory::track(GpuMemory::cTexture,id,"Texture",size_t(width)*height*4*4/3); // (+1/3 for the mipmaps)
 	stbi_image_free(data);
 	this->repeat_s = !(flags&fClampS); 
 	this->repeat_t = !(flags&fClampT);
@@ -35,12 +41,19 @@ Texture::Texture(const Image &img, int flags) {
 	width = img.GetWidth(); height = img.GetHeight(); channels = img.GetChannels();
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, channels==3?GL_RGB:GL_RGBA, GL_UNSIGNED_BYTE, img.GetData());
 	if (flags&fMipmaps) glGenerateMipmap(GL_TEXTURE_2D);
+	GpuMemory::track(GpuMemory::cTexture,id,"Texture",size_t(width)*height*4*((flags&fMipmaps)?4:3)/3);
 	this->repeat_s = !(flags&fClampS); 
 	this->repeat_t = !(flags&fClampT);
 }
 
 Texture::~Texture ( ) {
-	if (id!=0) glDeleteTextures(1,&id);
+	freeResources();
+}
+
+void Texture::freeResources() {
+	if (id==0) return;
+	glDeleteTextures(1,&id);
+	GpuMemory::release(GpuMemory::cTexture,id);
 }
 
 void Texture::bind (int number) const {
@@ -57,7 +70,7 @@ Texture::Texture (Texture &&t) {
 }
 
 Texture & Texture::operator=(Texture &&t) {
-	if (id!=0) glDeleteTextures(1,&id);
+	freeResources();
 	*this = static_cast<const Texture &>(t);
 	t = static_cast<const Texture &>(Texture{});
 	return *this;
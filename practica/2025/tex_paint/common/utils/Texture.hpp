@@ -19,6 +19,7 @@ public:
 	bool isOk() const { return channels!=-1; }
 private:
 	Texture &operator=(const Texture &t) = default;
+	void freeResources();
 	GLuint id = 0;
 	int width=-1, height=-1, channels=-1;
 	bool repeat_s=true, repeat_t=true;
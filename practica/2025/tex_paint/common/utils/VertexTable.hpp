@@ -0,0 +1,65 @@
+#ifndef VERTEX_TABLE_HPP
+#define VERTEX_TABLE_HPP
+#include <vector>
+#include <memory_resource>
+#include <algorithm>
+#include <cstdint>
+#include "Debug.hpp"
+
+// flat open-addressing (linear probing) map from an obj vertex, the triple
+// of position/normal/tex_coord indexes (-1 for missing) packed in a 64-bit
+// key, to the index of that vertex in the final geometry; it is sized up
+// front for the max number of vertexes, so it never rehashes
+class VertexTable {
+public:
+	VertexTable() = default; // can't be used until assigned a sized one
+	VertexTable(size_t max_vertexes, size_t pos_count, size_t norm_count, size_t tc_count,
+				std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+		: m_slots(resource), m_norm_shift(bitsFor(pos_count+1)),
+		  m_tc_shift(m_norm_shift+bitsFor(norm_count+1))
+	{
+		cg_assert(m_tc_shift+bitsFor(tc_count+1)<=64,"Too many vertexes for VertexTable");
+		size_t capacity = 16;
+		while (capacity<max_vertexes+max_vertexes/2) capacity *= 2;
+		m_slots.resize(capacity);
+		m_mask = capacity-1;
+	}
+
+	// returns the index stored for the triple; if there wasn't one, stores
+	// and returns new_index, and sets inserted to true
+	int insert(int pos, int norm, int tc, int new_index, bool &inserted) {
+		uint64_t key = uint64_t(pos+1)
+			         | (uint64_t(norm+1)<<m_norm_shift)
+			         | (uint64_t(tc+1)<<m_tc_shift); // never 0, since pos>=0
+		++m_lookups;
+		for(size_t i = hash(key)&m_mask; ; i = (i+1)&m_mask) {
+			Slot &s = m_slots[i];
+			if (s.key==key) { inserted = false; return s.index; }
+			if (s.key==0) { s.key = key; s.index = new_index; inserted = true; return new_index; }
+			++m_probes;
+		}
+	}
+
+	// removes every vertex, but keeps the capacity
+	void clear() { std::fill(m_slots.begin(),m_slots.end(),Slot()); }
+
+	// average number of extra slots visited per lookup
+	double getAverageProbeLength() const { return m_lookups ? double(m_probes)/m_lookups : 0.0; }
+	size_t getCapacity() const { return m_slots.size(); }
+
+private:
+	static int bitsFor(size_t n) { int b = 0; while (n>>b) ++b; return b; }
+	static uint64_t hash(uint64_t k) { // murmur3's fmix64
+		k ^= k>>33; k *= 0xff51afd7ed558ccdull;
+		k ^= k>>33; k *= 0xc4ceb9fe1a85ec53ull;
+		k ^= k>>33; return k;
+	}
+	struct Slot { uint64_t key = 0; int index = -1; };
+	std::pmr::vector<Slot> m_slots;
+	size_t m_mask = 0;
+	int m_norm_shift = 0, m_tc_shift = 0;
+	size_t m_lookups = 0, m_probes = 0;
+};
+
+#endif
+
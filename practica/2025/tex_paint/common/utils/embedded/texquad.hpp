@@ -0,0 +1,44 @@
+// generated with Model::writeEmbedded("models/texquad",...,1), do not edit
+// (cleaned with weld_epsilon=0.000001, optimized)
+#ifndef EMBEDDED_TEXQUAD_HPP
+#define EMBEDDED_TEXQUAD_HPP
+#include "../EmbeddedMesh.hpp"
+
+namespace embedded {
+
+namespace texquad_data {
+
+inline constexpr float positions_0[][3] = {
+	{1.f,1.f,0.f},
+	{-1.f,1.f,0.f},
+	{-1.f,-1.f,0.f},
+	{1.f,-1.f,0.f},
+};
+inline constexpr float normals_0[][3] = {
+	{0.f,0.f,1.f},
+	{0.f,0.f,1.f},
+	{0.f,0.f,1.f},
+	{0.f,0.f,1.f},
+};
+inline constexpr float tex_coords_0[][2] = {
+	{1.f,1.f},
+	{0.f,1.f},
+	{0.f,0.f},
+	{1.f,0.f},
+};
+inline constexpr int triangles_0[] = {
+	0,1,2,
+	0,2,3,
+};
+
+}
+
+inline constexpr EmbeddedMesh texquad[] = {
+	{ "Plane:Material.002", {0.959999979f,0.720000029f,0.100000001f}, {0.959999979f,0.720000029f,0.100000001f}, {0.5f,0.5f,0.5f}, {0.f,0.f,0.f}, 225.f, 1.f, "models/chookity.png",
+	  texquad_data::positions_0, texquad_data::normals_0, texquad_data::tex_coords_0, 4,
+	  texquad_data::triangles_0, 6 },
+};
+
+}
+
+#endif
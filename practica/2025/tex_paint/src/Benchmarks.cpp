@@ -0,0 +1,603 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "Benchmarks.hpp"
+#include "ObjMesh.hpp"
+#include "Debug.hpp"
+#include "Misc.hpp"
+#include "VertexTable.hpp"
+#include "Arena.hpp"
+#include "Shaders.hpp"
+#include "Archive.hpp"
+#include "Image.hpp"
+#include "Model.hpp"
+#include "MeshCleanup.hpp"
+#include "MeshOptimizer.hpp"
+
+namespace fs = std::filesystem;
+
+// todas las reservas de memoria dinmica del programa pasan por ac, para
+// que benchmarkArena las pueda contar
+static std::atomic<size_t> heap_allocations{0};
+
+void *operator new(std::size_t size) {
+	heap_allocations.fetch_add(1,std::memory_order_relaxed);
+	if (void *p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+// (las de std::pmr::new_delete_resource, el recurso por defecto, vienen por ac)
+void *operator new(std::size_t size, std::align_val_t align) {
+	heap_allocations.fetch_add(1,std::memory_order_relaxed);
+	// se pide de ms para alinear, y se guarda antes el puntero de malloc
+	std::size_t a = static_cast<std::size_t>(align);
+	void *raw = std::malloc(size+a+sizeof(void*));
+	if (not raw) throw std::bad_alloc();
+	std::uintptr_t p = (reinterpret_cast<std::uintptr_t>(raw)+sizeof(void*)+a-1)&~std::uintptr_t(a-1);
+	reinterpret_cast<void**>(p)[-1] = raw;
+	return reinterpret_cast<void*>(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept { if (p) std::free(static_cast<void**>(p)[-1]); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { if (p) std::free(static_cast<void**>(p)[-1]); }
+
+namespace {
+
+// el lector de obj anterior a readObj, para comparar
+namespace getline_obj {
+
+float readInt(const std::string &s, int &i) {
+	char *p = const_cast<char*>(s.c_str())+i;
+	int r = std::strtol(p,&p,10);
+	i = p-s.c_str();
+	return r;
+}
+
+float readFloat(const std::string &s, int &i) {
+	char *p = const_cast<char*>(s.c_str())+i;
+	float r = std::strtof(p,&p);
+	i = p-s.c_str();
+	return r;
+}
+
+float readFloat(const std::string &s, const int &i) {
+	int j = i; return readFloat(s,j);
+}
+
+glm::vec3 readVec3(const std::string &s, int i) {
+	glm::vec3 v;
+	v.x = readFloat(s,i); ++i;
+	v.y = readFloat(s,i); ++i;
+	v.z = readFloat(s,i);
+	return v;
+}
+
+glm::vec2 readVec2(const std::string &s, int i) {
+	glm::vec2 v;
+	v.x = readFloat(s,i); ++i;
+	v.y = readFloat(s,i);
+	return v;
+}
+
+std::map<std::string,Material> loadMaterialsLib(const std::string &path, const std::string &filename) {
+	cg_info( "Reading mtl file: " + path+filename + "...");
+	std::ifstream file(path+filename);
+	cg_assert(file.is_open(),"Could not open mtl file");
+	
+	std::map<std::string,Material> lib;
+	Material *current_material = nullptr;
+	for(std::string line; std::getline(file,line); ) {
+		if (line.empty() or line[0]=='#' or line[0]=='\r') continue;
+		if (line[line.size()-1]=='\r') line.erase(line.size()-1);
+		if (startsWith(line,"newmtl ")) {
+			cg_assert(lib.count(line.substr(7))==0,"Duplicate material name");
+			current_material = &lib[line.substr(7)];
+		} else {
+			cg_assert(current_material,"Material property before command newmtl");
+			if (startsWith(line,"Ks ")) {
+				current_material->ks = readVec3(line,3);
+			} else if (startsWith(line,"Ka ")) {
+				current_material->ka = readVec3(line,3);
+			} else if (startsWith(line,"Kd ")) {
+				current_material->kd = readVec3(line,3);
+			} else if (startsWith(line,"Ke ")) {
+				current_material->ke = readVec3(line,3);
+			} else if (startsWith(line,"Ns ")) {
+				current_material->shininess = readFloat(line,3);
+			} else if (startsWith(line,"d ")) {
+				current_material->opacity = readFloat(line,2);
+			} else if (startsWith(line,"Tr ")) {
+				current_material->opacity = 1.f-readFloat(line,3);				
+			} else if (startsWith(line,"map_Kd ")) {
+				current_material->texture = path+line.substr(7);
+			}
+		}
+	}
+	return lib;
+}
+
+
+ObjMesh readObj(const std::string &full_path) {
+	cg_info( "Reading obj file: " + full_path + "..." );
+	std::string path = extractFolder(full_path);
+	std::ifstream file(full_path);
+	cg_assert(file.is_open(),"Could not open obj file: "+full_path);
+	
+	ObjMesh meshes;
+	ObjMesh::Part *current_part = nullptr;
+	std::map<std::string,Material> materials_lib;
+	std::string current_name;
+	
+	for(std::string line; std::getline(file,line); ) {
+		if (line.empty() or line[0]=='#' or line[0]=='\r') continue;
+		if (line[line.size()-1]=='\r') line.erase(line.size()-1);
+		if (startsWith(line,"o ")) {
+			meshes.parts.push_back({}); 
+			current_part = &meshes.parts.back();
+			current_name = current_part->name = line.substr(2);
+		} else if (startsWith(line,"mtllib ")) {
+			materials_lib = loadMaterialsLib(path,line.substr(7));
+		} else {
+			if (not current_part) {
+				meshes.parts.push_back({});
+				current_part = &meshes.parts.back();
+			}
+			if (startsWith(line,"v ")) {
+				meshes.positions.push_back(readVec3(line,2));
+			} else if (startsWith(line,"vn ")) {
+				meshes.normals.push_back(readVec3(line,3));
+			} else if (startsWith(line,"vt ")) {
+				meshes.tex_coords.push_back(readVec2(line,3));
+			} else if (startsWith(line,"f ")) {
+				ObjMesh::Element e; 
+				int is = 2, in = 0, l = line.size();
+				while(is<l) {
+					cg_assert(in<4,"Face with more than 4 vertexes are not supported yet");
+					e.pos[in] = readInt(line,is)-1;
+					if (line[is]=='/') {
+						if (line[++is]=='/') {
+							e.tcs[in] = -1;
+							e.norms[in] = readInt(line,++is)-1;
+						} else {
+							e.tcs[in] = readInt(line,is)-1;
+							if (line[is]=='/') {
+								e.norms[in] = readInt(line,++is)-1;
+							} else {
+								e.norms[in] = -1;
+							}
+						}
+					} else {
+						e.tcs[in] = -1;
+						e.norms[in] = -1;
+					}
+					++in;
+				}
+				cg_assert(in>2,"Face with less than 3 vertexes");
+				if (in==3) e.pos[3] = e.norms[3] = e.tcs[3] = -1;
+				current_part->elements.push_back(e);
+			} else if (startsWith(line,"usemtl ")) {
+				if (not current_part->elements.empty()) {
+					meshes.parts.push_back({}); 
+					current_part = &meshes.parts.back();
+				}
+				current_part->name = current_name+":"+line.substr(7);
+				if  (line.substr(7)!="None") {
+					cg_assert(materials_lib.count(line.substr(7)),"Material not found: "+line.substr(7));
+					current_part->material = materials_lib[line.substr(7)];
+				}
+			}
+		}
+	}
+	cg_assert(not meshes.parts.empty(),"No mesh object found in file");
+	
+	return meshes;
+}
+
+
+} // namespace getline_obj
+
+// el toGeometry anterior a VertexTable (con su hash, que ignoraba las coordenadas de textura)
+namespace unordered_map_geo {
+
+struct TupleHash {
+	std::size_t operator()(const std::tuple<int,int,int>& p) const {
+		return ( ( std::hash<int>()(std::get<0>(p))
+				   ^ (std::hash<int>()(std::get<1>(p)) << 1) ) >> 1)
+			   ^ (std::hash<int>()(std::get<0>(p)) << 1);
+	}
+};
+
+Geometry toGeometry(const ObjMesh &obj, const ObjMesh::Part &part) {
+	Geometry g;
+	std::unordered_map<std::tuple<int,int,int>,int,TupleHash> map;
+	auto addVertex = [&g,&obj,&map](const ObjMesh::Element &e, int inode) {
+		auto t = std::make_tuple(e.pos[inode],e.norms[inode],e.tcs[inode]);
+		auto p = map.insert({t,g.positions.size()});
+		if (p.second) {
+			g.positions.push_back(obj.positions[e.pos[inode]]);
+			if (e.norms[inode]!=-1) g.normals.push_back(obj.normals[e.norms[inode]]);
+			if (e.tcs[inode]!=-1) g.tex_coords.push_back(obj.tex_coords[e.tcs[inode]]);
+		}
+		g.triangles.push_back(p.first->second);
+	};
+	for(const ObjMesh::Element &e : part.elements) {
+		addVertex(e,0); addVertex(e,1); addVertex(e,2);
+		if (e.pos[3]==-1) continue;
+		addVertex(e,0); addVertex(e,2); addVertex(e,3);
+	}
+	return g;
+}
+
+} // namespace unordered_map_geo
+
+// los .obj de folder y sus subcarpetas, en orden alfabtico
+std::vector<std::string> findObjs(const std::string &folder) {
+	std::vector<std::string> paths;
+	std::error_code ec;
+	for(fs::recursive_directory_iterator it(folder,ec), end; it!=end; it.increment(ec))
+		if (it->is_regular_file(ec) and it->path().extension()==".obj") 
+			paths.push_back(it->path().string());
+	std::sort(paths.begin(),paths.end());
+	return paths;
+}
+
+// el menor tiempo (en ms) de reps ejecuciones de f
+template<typename TFunc>
+double bestOf(int reps, TFunc f) {
+	double best = std::numeric_limits<double>::max();
+	for(int i=0;i<reps;++i) {
+		auto t0 = std::chrono::steady_clock::now();
+		f();
+		best = std::min(best,std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-t0).count());
+	}
+	return best;
+}
+
+// las mediciones de archivos grandes se repiten menos
+int repsFor(const std::string &path) {
+	return fs::file_size(path)>(64<<20) ? 1 : 3;
+}
+
+bool sameGeometry(const Geometry &a, const Geometry &b) {
+	return a.positions==b.positions and a.normals==b.normals and a.tex_coords==b.tex_coords and a.triangles==b.triangles;
+}
+
+bool sameObj(const ObjMesh &a, const ObjMesh &b) {
+	if (a.positions!=b.positions or a.normals!=b.normals or a.tex_coords!=b.tex_coords or a.parts.size()!=b.parts.size()) return false;
+	for(size_t i=0;i<a.parts.size();++i) {
+		const ObjMesh::Part &pa = a.parts[i], &pb = b.parts[i];
+		if (pa.name!=pb.name or pa.material.texture!=pb.material.texture or pa.material.kd!=pb.material.kd 
+			or pa.elements.size()!=pb.elements.size()) return false;
+		if (std::memcmp(pa.elements.data(),pb.elements.data(),pa.elements.size()*sizeof(ObjMesh::Element))!=0) return false;
+	}
+	return true;
+}
+
+void addLine(std::string &report, const char *format, ...) {
+	char line[512];
+	va_list args;
+	va_start(args,format);
+	std::vsnprintf(line,sizeof(line),format,args);
+	va_end(args);
+	if (not report.empty()) report += '\n';
+	report += line;
+}
+
+std::string finish(const std::string &report) {
+	cg_info(report);
+	return report;
+}
+
+// escribe una grilla de n x n vrtices (2(n-1)^2 tringulos) ondulada en z
+void writeGrid(const std::string &path, int n) {
+	FILE *file = std::fopen(path.c_str(),"w");
+	cg_assert(file,"Could not write "+path);
+	std::fprintf(file,"o grid\n");
+	for(int i=0;i<n;++i) 
+		for(int j=0;j<n;++j) 
+			std::fprintf(file,"v %f %f %f\n",float(i)/n,float(j)/n,.1f*std::sin(i*.05f)*std::cos(j*.05f));
+	for(int i=0;i+1<n;++i) 
+		for(int j=0;j+1<n;++j) {
+			int a = i*n+j+1, b = a+1, c = a+n, d = c+1;
+			std::fprintf(file,"f %d %d %d\nf %d %d %d\n",a,b,d,a,d,c);
+		}
+	bool ok = std::ferror(file)==0;
+	ok = std::fclose(file)==0 and ok;
+	if (not ok) fs::remove(path);
+	cg_assert(ok,"Could not write "+path);
+}
+
+} // namespace
+
+std::string benchmarkObjParser(const std::string &folder) {
+	std::string files;
+	double total_old = 0.0, total_new = 0.0, total_mb = 0.0;
+	int count = 0, differ = 0;
+	for(const std::string &path : findObjs(folder)) {
+		try {
+			ObjMesh old_obj, new_obj;
+			double t_old = bestOf(repsFor(path),[&]() { old_obj = getline_obj::readObj(path); });
+			double t_new = bestOf(repsFor(path),[&]() { new_obj = readObj(path); });
+			double mb = fs::file_size(path)/1048576.0;
+			bool same = sameObj(old_obj,new_obj);
+			addLine(files,"  %s: %.2f MB, %.2f -> %.2f ms (x%.1f)%s",path.c_str(),mb,
+					t_old,t_new,t_old/t_new,same?"":", DIFFERENT");
+			total_old += t_old; total_new += t_new; total_mb += mb;
+			++count; differ += not same;
+		} catch (std::exception &e) {
+			addLine(files,"  %s: %s",path.c_str(),e.what());
+		}
+	}
+	if (not count) return finish("No .obj files could be read from "+folder);
+	std::string report;
+	addLine(report,"OBJ parser, %i files (%.1f MB): getline %.1f ms, mapped %.1f ms (x%.1f), %i/%i differ",
+			count,total_mb,total_old,total_new,total_old/total_new,differ,count);
+	return finish(report+"\n"+files);
+}
+
+std::string benchmarkStreaming() {
+	const int n = 2237; // 2*2236^2 = 9999392 tringulos
+	const size_t triangles = 2*size_t(n-1)*(n-1);
+	std::string path = (fs::temp_directory_path()/"cg_grid10m.obj").string();
+	std::string report;
+	try {
+		std::error_code ec;
+		if (not fs::exists(path,ec)) {
+			double gen_ms = bestOf(1,[&]() { writeGrid(path,n); });
+			addLine(report,"Generated %s in %.1f s",path.c_str(),gen_ms/1000.0);
+		}
+		size_t peak_before = getPeakMemoryUsage();
+		ObjStream::Stats stats;
+		GeometryRenderer renderer = streamObj(path,false,&stats);
+		// lo que ocuparan el ObjMesh de readObj y el Geometry de toGeometry (con normales)
+		double whole_mb = (size_t(n)*n*sizeof(glm::vec3)+triangles*sizeof(ObjMesh::Element) 
+						   + size_t(n)*n*2*sizeof(glm::vec3)+3*triangles*sizeof(int))/1048576.0;
+		addLine(report,"Streamed %.1f MB: %zu triangles%s, %zu vertexes, %zu batches",stats.bytes/1048576.0,
+				stats.triangles,stats.triangles==triangles?"":" (WRONG COUNT)",stats.vertexes,stats.batches);
+		addLine(report,"  %.2f s, %.1f MB/s, %.2f M triangles/s",stats.seconds,
+				stats.bytes/1048576.0/stats.seconds,stats.triangles/1e6/stats.seconds);
+		addLine(report,"  peak memory %.0f -> %.0f MB (an ObjMesh and a Geometry would need %.0f MB)",
+				peak_before/1048576.0,stats.peak_memory/1048576.0,whole_mb);
+	} catch (std::exception &e) {
+		addLine(report,"%s",e.what());
+	}
+	return finish(report);
+}
+
+std::string benchmarkArena(const std::string &folder) {
+	// lo que hace f (el menor tiempo de 20 veces), y cuntas reservas hace una vez
+	auto measure = [](auto f, double &ms, size_t &allocations) {
+		ms = bestOf(20,f);
+		size_t before = heap_allocations.load();
+		f();
+		allocations = heap_allocations.load()-before;
+	};
+	std::string report;
+	
+	std::vector<std::string> shaders;
+	std::error_code ec;
+	for(fs::directory_iterator it("shaders",ec), end; it!=end; it.increment(ec)) {
+		fs::path p = it->path();
+		if (p.extension()==".vert" and fs::exists(fs::path(p).replace_extension(".frag"),ec))
+			shaders.push_back(fs::path(p).replace_extension().string());
+	}
+	std::sort(shaders.begin(),shaders.end());
+	if (not shaders.empty()) try {
+		double ms_heap, ms_arena;
+		size_t allocs_heap, allocs_arena;
+		Arena arena;
+		measure([&]() { for(const std::string &s : shaders) Shader shader(s); },ms_heap,allocs_heap);
+		measure([&]() { for(const std::string &s : shaders) { arena.reset(); Shader shader(s,&arena); } },ms_arena,allocs_arena);
+		addLine(report,"%i shaders: %zu -> %zu heap allocations, %.3f -> %.3f ms",
+				int(shaders.size()),allocs_heap,allocs_arena,ms_heap,ms_arena);
+	} catch (std::exception &e) {
+		addLine(report,"%s",e.what());
+	}
+	
+	// como Model::loadParts: un arena para todo el archivo, reiniciado en cada parte
+	std::vector<std::string> objs = findObjs(folder);
+	auto load = [&](Arena *arena) {
+		for(const std::string &path : objs) {
+			ObjMesh obj = readObj(path,1,arena);
+			for(const ObjMesh::Part &part : obj.parts) {
+				if (arena) arena->reset();
+				Geometry geometry = toGeometry(obj,part,arena);
+			}
+		}
+	};
+	try {
+		double ms_heap, ms_arena;
+		size_t allocs_heap, allocs_arena;
+		Arena arena;
+		measure([&]() { load(nullptr); },ms_heap,allocs_heap);
+		measure([&]() { arena.reset(); load(&arena); },ms_arena,allocs_arena);
+		addLine(report,"%i models: %zu -> %zu heap allocations, %.2f -> %.2f ms",
+				int(objs.size()),allocs_heap,allocs_arena,ms_heap,ms_arena);
+	} catch (std::exception &e) {
+		addLine(report,"%s",e.what());
+	}
+	return finish("Without -> with arena:\n"+report);
+}
+
+std::string benchmarkMeshOptimizer(const std::string &folder) {
+	std::string files;
+	for(const std::string &path : findObjs(folder)) {
+		try {
+			ObjMesh obj = readObj(path);
+			centerAndResize(obj.positions);
+			// acmr, atvr y overdraw del orden original, del de optimizeVertexCache
+			// y del de optimizeOverdraw despus, sumados por tringulo
+			float sums[3][3] = {};
+			size_t triangles = 0;
+			for(const ObjMesh::Part &part : obj.parts) {
+				Geometry geo = toGeometry(obj,part);
+				cleanMesh(geo,Model::weld_epsilon);
+				int tris = geo.triangles.size()/3;
+				for(int pass=0;pass<3;++pass) {
+					if (pass==1) optimizeVertexCache(geo);
+					if (pass==2) optimizeOverdraw(geo);
+					VertexCacheStats vc = analyzeVertexCache(geo);
+					sums[pass][0] += vc.acmr*tris; sums[pass][1] += vc.atvr*tris;
+					sums[pass][2] += analyzeOverdraw(geo)*tris;
+				}
+				triangles += tris;
+			}
+			if (not triangles) continue;
+			for(auto &pass : sums) for(float &sum : pass) sum /= triangles;
+			addLine(files,"  %s: %i triangles",path.c_str(),int(triangles));
+			addLine(files,"    acmr %.3f -> %.3f -> %.3f, atvr %.3f -> %.3f -> %.3f, overdraw %.3f -> %.3f -> %.3f",
+					sums[0][0],sums[1][0],sums[2][0],sums[0][1],sums[1][1],sums[2][1],sums[0][2],sums[1][2],sums[2][2]);
+		} catch (std::exception &e) {
+			addLine(files,"  %s: %s",path.c_str(),e.what());
+		}
+	}
+	if (files.empty()) return finish("No .obj files could be read from "+folder);
+	return finish("Original order -> vertex cache -> overdraw:\n"+files);
+}
+
+std::string buildArchive(const std::string &archive_path) {
+	// si est montado, Archive::write igual lee los archivos del disco
+	bool ok = false;
+	double ms = bestOf(1,[&]() { ok = Archive::write(".",archive_path); });
+	if (not ok) return finish("Could not write "+archive_path);
+	std::error_code ec;
+	std::string report;
+	addLine(report,"%s written in %.0f ms (%.1f MB)",archive_path.c_str(),ms,fs::file_size(archive_path,ec)/1048576.0);
+	return finish(report);
+}
+
+std::string benchmarkStartup(const std::string &archive_path) {
+	bool was_mounted = Archive::isMounted();
+	Archive::unmount();
+	if (not Archive::mount(archive_path)) {
+		if (was_mounted) Archive::mount(archive_path);
+		return finish("Could not mount "+archive_path+" (build it first)");
+	}
+	
+	// las mismas lecturas que el inicio de tex_paint
+	auto startup = [&]() {
+		Shader main("shaders/main"), flat("shaders/flat"), quad("shaders/quad");
+		Image image("models/chookity.png",true), colormap("models/chookity.png",true);
+		int flags = Model::fNoTextures|Model::fLods|Model::fMeshlets|Model::fKeepGeometry|Model::fParallelLoad|Model::fInterleaved;
+		Model chookity = Model::loadSingle("models/chookity",flags);
+	};
+	const int runs = 7;
+	std::vector<double> loose, packed;
+	std::string error;
+	try {
+		for(int i=0;i<runs;++i) {
+			Archive::unmount();
+			loose.push_back(bestOf(1,startup));
+			Archive::mount(archive_path);
+			packed.push_back(bestOf(1,startup));
+		}
+	} catch (std::exception &e) {
+		error = e.what();
+	}
+	Archive::unmount();
+	if (was_mounted) Archive::mount(archive_path);
+	if (not error.empty()) return finish(error);
+	
+	auto median = [](std::vector<double> &v) { 
+		std::nth_element(v.begin(),v.begin()+v.size()/2,v.end()); 
+		return v[v.size()/2];
+	};
+	std::string report;
+	addLine(report,"Startup reads, median of %i: loose files %.1f ms, %s %.1f ms",
+			runs,median(loose),archive_path.c_str(),median(packed));
+	addLine(report,"  (the files are in the OS cache after the first run, so this is a warm start)");
+	return finish(report);
+}
+
+std::string benchmarkParallelObj(const std::string &folder) {
+	std::vector<std::string> paths;
+	std::vector<ObjMesh> serial;
+	double total_mb = 0.0;
+	for(const std::string &path : findObjs(folder)) {
+		try {
+			serial.push_back(readObj(path));
+			paths.push_back(path);
+			total_mb += fs::file_size(path)/1048576.0;
+		} catch (std::exception &) { } // (las que no se pueden leer no se miden)
+	}
+	if (paths.empty()) return finish("No .obj files could be read from "+folder);
+	
+	unsigned cores = std::thread::hardware_concurrency();
+	std::string report;
+	addLine(report,"Parallel OBJ parsing, %i files (%.1f MB), %u cores:",int(paths.size()),total_mb,cores);
+	double serial_ms = 0.0;
+	for(int threads=1; threads<=int(std::max(4u,cores)); threads*=2) {
+		double total_ms = 0.0;
+		int differ = 0;
+		for(size_t i=0;i<paths.size();++i) {
+			ObjMesh obj;
+			total_ms += bestOf(repsFor(paths[i]),[&]() { obj = readObj(paths[i],threads); });
+			differ += not sameObj(obj,serial[i]);
+		}
+		if (threads==1) serial_ms = total_ms;
+		addLine(report,"  %i threads: %.1f ms (x%.2f), %i/%i differ",threads,total_ms,serial_ms/total_ms,differ,int(paths.size()));
+	}
+	return finish(report);
+}
+
+std::string benchmarkVertexTable(const std::string &folder) {
+	std::string files;
+	double total_map = 0.0, total_table = 0.0;
+	int count = 0, differ = 0;
+	for(const std::string &path : findObjs(folder)) {
+		try {
+			ObjMesh obj = readObj(path);
+			double t_map = 0.0, t_table = 0.0;
+			size_t vertexes = 0, lookups = 0;
+			double probes = 0.0;
+			bool same = true;
+			for(const ObjMesh::Part &part : obj.parts) {
+				Geometry g_map, g_table;
+				t_map += bestOf(5,[&]() { g_map = unordered_map_geo::toGeometry(obj,part); });
+				t_table += bestOf(5,[&]() { g_table = toGeometry(obj,part); });
+				same = same and sameGeometry(g_map,g_table);
+				// la misma tabla que arma toGeometry, para contar sus pasos
+				size_t corners = 0;
+				for(const ObjMesh::Element &e : part.elements) corners += e.pos[3]==-1 ? 3 : 4;
+				VertexTable table(corners,obj.positions.size(),obj.normals.size(),obj.tex_coords.size());
+				bool inserted;
+				for(const ObjMesh::Element &e : part.elements) 
+					for(int k=0;k<4 and e.pos[k]!=-1;++k) 
+						table.insert(e.pos[k],e.norms[k],e.tcs[k],0,inserted);
+				probes += table.getAverageProbeLength()*corners;
+				lookups += corners;
+				vertexes += g_table.positions.size();
+			}
+			addLine(files,"  %s: %i vertexes, %.3f -> %.3f ms (x%.1f), probe length %.3f%s",path.c_str(),int(vertexes),
+					t_map,t_table,t_map/t_table,lookups?probes/lookups:0.0,same?"":", DIFFERENT");
+			total_map += t_map; total_table += t_table;
+			++count; differ += not same;
+		} catch (std::exception &e) {
+			addLine(files,"  %s: %s",path.c_str(),e.what());
+		}
+	}
+	if (not count) return finish("No .obj files could be read from "+folder);
+	std::string report;
+	addLine(report,"Vertex dedup, %i files: unordered_map %.2f ms, VertexTable %.2f ms (x%.1f), %i/%i differ",
+			count,total_map,total_table,total_map/total_table,differ,count);
+	return finish(report+"\n"+files);
+}
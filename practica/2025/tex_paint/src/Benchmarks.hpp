@@ -0,0 +1,48 @@
+#ifndef BENCHMARKS_HPP
+#define BENCHMARKS_HPP
+#include <string>
+
+// mediciones que se lanzan desde la ventana de settings; cada una devuelve un
+// reporte para mostrar en la ventana (que tambin se enva a cg_info) y
+// comprueba que lo que compara d los mismos resultados
+
+// lee cada .obj de folder (y sus subcarpetas) con el lector anterior (getline
+// y strtof/strtol por lnea) y con readObj (archivo mapeado, una sola pasada)
+std::string benchmarkObjParser(const std::string &folder);
+
+// lee todos los .obj de folder con readObj usando 1, 2, 4... hilos (al menos
+// hasta 4, aunque haya menos ncleos), y compara con el resultado de uno solo
+std::string benchmarkParallelObj(const std::string &folder);
+
+// arma la geometra de cada parte de los .obj de folder con el unordered_map
+// que usaba toGeometry y con la VertexTable que usa ahora, y muestra cuntos
+// slots de ms visita en promedio cada bsqueda en la tabla
+std::string benchmarkVertexTable(const std::string &folder);
+
+// carga con streamObj en un GeometryRenderer una grilla de 10 millones de
+// tringulos (el .obj, de unos 380 MB, se genera la primera vez en la carpeta
+// temporal), y muestra su velocidad y la memoria mxima del proceso antes y
+// despus (necesita el contexto de OpenGL)
+std::string benchmarkStreaming();
+
+// carga los shaders de la carpeta shaders y lee los .obj de folder (cada parte
+// con toGeometry) con y sin un Arena para los temporales, contando las
+// reservas de memoria dinmica de cada carga (necesita el contexto de OpenGL)
+std::string benchmarkArena(const std::string &folder);
+
+// pasa cada parte de los .obj de folder (como la deja Model::loadParts antes
+// de optimizarla) por optimizeVertexCache y luego por optimizeOverdraw, y
+// muestra acmr y atvr (ver analyzeVertexCache) y el overdraw (ver
+// analyzeOverdraw) de cada orden, promediados por tringulo en cada archivo
+std::string benchmarkMeshOptimizer(const std::string &folder);
+
+// empaqueta la carpeta actual en archive_path (ver Archive::write)
+std::string buildArchive(const std::string &archive_path);
+
+// repite las lecturas del inicio de tex_paint (shaders, imagen y modelo)
+// leyendo los archivos sueltos y con archive_path montado, alternando, y
+// muestra la mediana de cada forma; al terminar deja montado o no el paquete
+// como estaba (necesita el contexto de OpenGL)
+std::string benchmarkStartup(const std::string &archive_path);
+
+#endif
@@ -3,15 +3,23 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <random>
+#include <cmath>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
+#include <glm/gtc/packing.hpp>
 #include "Model.hpp"
 #include "Window.hpp"
 #include "Callbacks.hpp"
 #include "Debug.hpp"
 #include "Shaders.hpp"
+#include "Archive.hpp"
+#include "GpuMemory.hpp"
+#include "Bvh.hpp"
+#include "Benchmarks.hpp"
+#include "embedded/texquad.hpp"
 
 #define VERSION 20250901
 
@@ -35,6 +43,27 @@ Model model_aux; // un quad para cubrir la ventana auxiliar y mostrar la textura
 Shader shader_main; // shader para el objeto principal (drawMain)
 Shader shader_aux; // shader para la ventana auxiliar (drawTexture)
 
+bool use_lods = true; // dibujar una versin simplificada del modelo si se ve chico
+float lod_pixels = 1.f; // error mximo (en pixeles) que se acepta al elegirla
+int lod_level = 0; // la versin elegida para el cuadro actual (0 es la original)
+double frame_time = 0.0; // duracin del ltimo cuadro (en segundos)
+bool use_meshlets = true; // descartar los grupos de tringulos que no se ven antes de dibujar
+std::vector<GeometryRenderer::IndexRange> visible_ranges; // los que quedan de la versin elegida
+MeshletCulling meshlet_culling; // cuntos se descartaron en el ltimo cuadro
+void drawChookity(Shader &shader, int level); // dibuja esa versin del modelo con el shader ya activo (sin los meshlets descartados, si es la elegida)
+Bvh bvh_chookity; // jerarqua de cajas sobre los tringulos del modelo, para elegir sin usar la GPU
+bool use_bvh = true; // elegir el texel con un rayo en la CPU en lugar de leerlo del back-buffer
+double pick_time = 0.0; // duracin de la ltima eleccin (en segundos)
+bool use_quantized = false; // vrtices de 16 bytes en lugar de 32 (Model::fQuantized; leyendo el back-buffer se elige con hasta 1/4 de texel de error)
+float quantized_texel_error = 0.f; // cuntos texels se corren como mximo las coords de textura al pasarlas a half float
+void loadChookity(); // (re)carga el modelo y su bvh con el formato de vrtices elegido
+void benchmarkBvh(); // mide el bvh del modelo y compara sus resultados con los de probar todos los tringulos
+std::string bvh_benchmark; // el resultado de la ltima medicin
+char benchmark_folder[256] = "models"; // dnde buscan los .obj las mediciones de Benchmarks.hpp
+std::string benchmark_report; // el resultado de la ltima de ellas
+bool use_archive = false; // leer shaders, modelos e imgenes de assets.cgpack en lugar de los archivos sueltos (ver Archive)
+bool pickTexel(GLFWwindow *window, double x, double y, glm::vec2 &texel); // el texel de la imagen que se ve en el cursor
+
 
 
 // CUSTOM VARS
@@ -97,20 +126,22 @@ int main() {
 
 	texture = Texture(image);
 	
-	model_chookity = Model::loadSingle("models/chookity", Model::fNoTextures);
+	loadChookity();
 	
 	// aux window (texture image)
 	aux_window = Window(512,512, "Texture", true, main_window);
 	glfwSetCursorPosCallback(aux_window, auxMouseMoveCallback);
 	glfwSetMouseButtonCallback(aux_window, auxMouseButtonCallback);
 	
-	model_aux = Model::loadSingle("models/texquad", Model::fNoTextures);
+	model_aux = Model::fromEmbedded(embedded::texquad[0], Model::fNoTextures|Model::fInterleaved);
 	shader_aux = Shader("shaders/quad");
 	
 	
 	// main loop
+	FrameTimer ftime;
 	do {
 		glfwPollEvents();
+		frame_time = ftime.newFrame();
 		
 		glfwMakeContextCurrent(main_window);
 		drawMain();
@@ -130,17 +161,46 @@ int main() {
 
 // ===== pasos del renderizado =====
 
+void loadChookity() {
+	int flags = Model::fNoTextures|Model::fLods|Model::fMeshlets|Model::fKeepGeometry|Model::fParallelLoad;
+	model_chookity = Model::loadSingle("models/chookity", flags|(use_quantized?Model::fQuantized:Model::fInterleaved));
+	bvh_chookity = Bvh(model_chookity.geometry);
+	
+	// el error que ve la eleccin leyendo el back-buffer (la del bvh usa la geometra en float)
+	quantized_texel_error = 0.f;
+	glm::vec2 size(image.GetWidth(),image.GetHeight());
+	if (use_quantized) {
+		for(const glm::vec2 &tc : model_chookity.geometry.tex_coords) {
+			glm::vec2 d = glm::abs(glm::unpackHalf2x16(glm::packHalf2x16(tc))-tc)*size;
+			quantized_texel_error = std::max(quantized_texel_error,std::max(d.x,d.y));
+		}
+	}
+}
+
 void drawMain() {
 	glEnable(GL_DEPTH_TEST);
 	glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
 	
+	// la versin del modelo segn su tamao en pantalla (drawBack usa la misma)
+	auto ms = common_callbacks::getMatrixes(main_window);
+	lod_level = use_lods ? model_chookity.selectLod(ms[1]*ms[0], ms[2], main_window.getBufferSize().height, lod_pixels) : 0;
+	// y de ella, slo los meshlets que pueden verse
+	if (use_meshlets and model_chookity.hasMeshlets())
+		meshlet_culling = cullMeshlets(model_chookity.getMeshlets(lod_level), ms[1]*ms[0], ms[2], visible_ranges);
+	
 	texture.bind();
 	shader_main.use();
 	setMatrixes(main_window, shader_main);
 	shader_main.setLight(glm::vec4{-1.f,1.f,4.f,1.f}, glm::vec3{1.f,1.f,1.f}, 0.35f);
 	shader_main.setMaterial(model_chookity.material);
-	shader_main.setBuffers(model_chookity.buffers);
-	model_chookity.buffers.draw();
+	drawChookity(shader_main, lod_level);
+}
+
+void drawChookity(Shader &shader, int level) {
+	const GeometryRenderer &buffers = model_chookity.getLod(level);
+	shader.setBuffers(buffers);
+	if (level==lod_level and use_meshlets and model_chookity.hasMeshlets()) buffers.draw(visible_ranges);
+	else buffers.draw();
 }
 
 void drawAux() {
@@ -175,8 +235,7 @@ void drawBack() {
 	shader_flat.setMaterial(model_chookity.material);
 	// Pass texture size so the shader can encode pixel coordinates into color
 	shader_flat.setUniform("texSize", glm::vec2((float)image.GetWidth(), (float)image.GetHeight()));
-	shader_flat.setBuffers(model_chookity.buffers);
-	model_chookity.buffers.draw();
+	drawChookity(shader_flat, 0); // siempre la original, para elegir el texel que se pinta
 
 	glFlush();
     glFinish();
@@ -207,6 +266,62 @@ void drawImGui(Window &window) {
 			image = Image("models/chookity.png",true);
 			texture.update(image);
 		}
+		
+		ImGui::Checkbox("LODs",&use_lods);
+		if (use_lods) {
+			ImGui::SameLine();
+			ImGui::SliderFloat("Max error (px)",&lod_pixels,.25f,8.f);
+		}
+		ImGui::Text("Level %i/%i: %i triangles, frame %.2f ms",lod_level,model_chookity.getLodCount()-1,
+					model_chookity.getLodTriangles(lod_level),frame_time*1000.0);
+		ImGui::Checkbox("Meshlet culling",&use_meshlets);
+		if (use_meshlets and meshlet_culling.total) {
+			const MeshletCulling &mc = meshlet_culling;
+			ImGui::Text("Culled %.0f%% of %i meshlets (frustum %i, backface %i)",
+						100.f*(mc.frustum+mc.backface)/mc.total,mc.total,mc.frustum,mc.backface);
+		}
+		
+		if (ImGui::Checkbox("Quantized vertexes",&use_quantized)) loadChookity();
+		if (use_quantized) {
+			ImGui::SameLine();
+			if (use_bvh) ImGui::Text("(BVH picking is exact)");
+			else ImGui::Text("(picking up to %.2f texels off)",quantized_texel_error);
+		}
+		ImGui::Checkbox("BVH picking",&use_bvh);
+		ImGui::SameLine();
+		ImGui::Text("last pick %.3f ms",pick_time*1000.0);
+		if (ImGui::Button("Benchmark BVH")) benchmarkBvh();
+		if (not bvh_benchmark.empty()) ImGui::TextUnformatted(bvh_benchmark.c_str());
+		
+		if (ImGui::CollapsingHeader("Benchmarks")) {
+			ImGui::InputText("Models folder",benchmark_folder,sizeof(benchmark_folder));
+			if (ImGui::Button("OBJ parser")) benchmark_report = benchmarkObjParser(benchmark_folder);
+			ImGui::SameLine();
+			if (ImGui::Button("OBJ threads")) benchmark_report = benchmarkParallelObj(benchmark_folder);
+			ImGui::SameLine();
+			if (ImGui::Button("Vertex table")) benchmark_report = benchmarkVertexTable(benchmark_folder);
+			if (ImGui::Button("Stream 10M triangles")) benchmark_report = benchmarkStreaming();
+			ImGui::SameLine();
+			if (ImGui::Button("Arena")) benchmark_report = benchmarkArena(benchmark_folder);
+			ImGui::SameLine();
+			if (ImGui::Button("Mesh optimizer")) benchmark_report = benchmarkMeshOptimizer(benchmark_folder);
+			if (ImGui::Button("Build assets.cgpack")) benchmark_report = buildArchive("assets.cgpack");
+			ImGui::SameLine();
+			if (ImGui::Button("Startup")) benchmark_report = benchmarkStartup("assets.cgpack");
+			ImGui::SameLine();
+			if (ImGui::Checkbox("Use it",&use_archive)) {
+				if (use_archive) use_archive = Archive::mount("assets.cgpack");
+				else Archive::unmount();
+			}
+			if (not benchmark_report.empty()) ImGui::TextUnformatted(benchmark_report.c_str());
+		}
+		
+		const GeometryRenderer::IndexStats &is = GeometryRenderer::getIndexStats();
+		if (is.triangles) ImGui::Text("Indexes %.2f MB (%.2f MB saved, %i strips), ACMR %.3f",
+									  is.bytes/1048576.0,is.saved_bytes/1048576.0,is.strips,
+									  float(is.transformed)/is.triangles);
+		
+		GpuMemory::addImGuiSettings();
 	});
 }
 
@@ -274,58 +389,11 @@ void mainMouseButtonCallback(GLFWwindow* window, int button, int action, int mod
 		if (button==GLFW_MOUSE_BUTTON_LEFT) {
 			mouse_action = MouseAction::Draw;
 			
-			// Ponemos el mapa de colores
-			//texture.update(image_colormap);
-
-			drawBack();
-			glFinish();
-			
 			double wx,wy;
 			glfwGetCursorPos(window,&wx,&wy);
-
-			int  wwidth, wheight;
-    		glfwGetWindowSize(window,&wwidth, &wheight);
-
-			int px = (int)(wx);
-			int py = (int)(wheight - wy);
-
-			p0_2d = glm::vec2(px,py);
-			
-			float zbf ;
-			glReadBuffer(GL_DEPTH);
-			glReadPixels(px,py,1,1,GL_DEPTH_COMPONENT,GL_FLOAT,&zbf);
-
-			std::cout << "P: " << px << ", " << py << std::endl;			
-			std::cout << "Z_VALUE: " << zbf << std::endl;
-			
-			if(zbf < 1.f) // Si no es el Z_FAR
-			{	
-				std::cout << "zbf function triggered" << std::endl;
-
-				// Leemos el color del pixel
-				glReadBuffer(GL_BACK);
-				unsigned char color_value[3];
-				glReadPixels(px, py, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, color_value);
-
-				// Decode the packed 24-bit index from the read-back RGB
-				int r = (int)color_value[0];
-				int g = (int)color_value[1];
-				int b = (int)color_value[2];
-
-				int idx = (r << 16) | (g << 8) | b;
-				int texW = image.GetWidth();
-				int texH = image.GetHeight();
-				int px_tex = idx % texW;
-				int py_tex = idx / texW;
-
-				glm::vec2 p0_tex = glm::vec2((float)px_tex, (float)py_tex);
-
-				std::cout << "READ COLOR (packed idx): " << idx << " -> POS: "
-						  << px_tex << ", " << py_tex << std::endl;
-				
-				
+			glm::vec2 p0_tex;
+			if (pickTexel(window,wx,wy,p0_tex)) {
 				drawCircle(radius, p0_tex);
-				
 				p0_2d = p0_tex;
 				texture.update(image);
 			}
@@ -352,59 +420,169 @@ void mainMouseMoveCallback(GLFWwindow* window, double xpos, double ypos) {
 	/// @ToDo: Parte 2: pintar un segmento de ancho "2*radius" en la imagen
 	///                 "image" que se usa como textura
 	
-	
-	drawBack();
-	glFinish();
-	
-	int  wwidth, wheight;
+	glm::vec2 p1_tex;
+	if (pickTexel(window,xpos,ypos,p1_tex)) {
+		dda(p0_2d,p1_tex,"stroke"); // implemento DDA en 3d
+		p0_2d = p1_tex;
+		texture.update(image);
+	}
+}
+
+bool pickTexel(GLFWwindow *window, double x, double y, glm::vec2 &texel) {
+	double t0 = glfwGetTime();
+	int wwidth, wheight;
 	glfwGetWindowSize(window,&wwidth, &wheight);
+	int texW = image.GetWidth();
+	int texH = image.GetHeight();
+	bool found = false;
 	
-	int px = (int)(xpos);
-	int py = (int)(wheight-ypos);
+	if (use_bvh) {
+		// el rayo que va del plano near al far por el cursor, llevado a las
+		// coordenadas del modelo (t entre 0 y 1)
+		auto ms = common_callbacks::getMatrixes(main_window);
+		glm::mat4 inv = glm::inverse(ms[2]*ms[1]*ms[0]);
+		float nx = 2.f*float(x)/wwidth-1.f, ny = 1.f-2.f*float(y)/wheight;
+		glm::vec4 p_near = inv*glm::vec4(nx,ny,-1.f,1.f), p_far = inv*glm::vec4(nx,ny,1.f,1.f);
+		glm::vec3 origin = glm::vec3(p_near)/p_near.w;
+		RayHit hit = bvh_chookity.rayCast(origin, glm::vec3(p_far)/p_far.w-origin, 1.f);
+		if (hit.triangle!=-1) {
+			// el mismo texel que elige shader_flat
+			texel.x = glm::clamp(int(std::floor(hit.tex_coords.x*texW)),0,texW-1);
+			texel.y = glm::clamp(int(std::floor(hit.tex_coords.y*texH)),0,texH-1);
+			found = true;
+		}
+	} else {
+		drawBack();
+		glFinish();
+		
+		int px = (int)(x);
+		int py = (int)(wheight-y);
+		
+		float zbf ;
+		glReadBuffer(GL_DEPTH);
+		glReadPixels(px,py,1,1,GL_DEPTH_COMPONENT,GL_FLOAT,&zbf);
+		
+		if(zbf < 1.f) // Si no es el Z_FAR
+		{	
+			// Leemos el color del pixel
+			glReadBuffer(GL_BACK);
+			unsigned char color_value[3];
+			glReadPixels(px, py, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, color_value);
+			
+			// Decode the packed 24-bit index from the read-back RGB
+			int r = (int)color_value[0];
+			int g = (int)color_value[1];
+			int b = (int)color_value[2];
+			
+			int idx = (r << 16) | (g << 8) | b;
+			texel = glm::vec2((float)(idx % texW), (float)(idx / texW));
+			found = true;
+		}
+	}
 	
-	p1_2d = glm::vec2(px,py);
+	pick_time = glfwGetTime()-t0;
+	return found;
+}
+
+void benchmarkBvh() {
+	const Geometry &geo = model_chookity.geometry;
+	int tri_count = geo.triangles.size()/3;
+	auto vertex = [&](int t, int k) { return geo.positions[geo.triangles[3*t+k]]; };
+	glm::vec3 pmin(std::numeric_limits<float>::max()), pmax(-std::numeric_limits<float>::max());
+	for(const glm::vec3 &p : geo.positions) { pmin = glm::min(pmin,p); pmax = glm::max(pmax,p); }
+	glm::vec3 center = (pmin+pmax)*.5f;
+	float radius = glm::length(pmax-pmin)*.5f;
+	std::mt19937 rng(1); // siempre los mismos rayos y puntos, para poder comparar
+	std::uniform_real_distribution<float> uniform(-1.f,1.f);
+	auto randomPoint = [&]() { // dentro de la esfera unitaria
+		glm::vec3 p;
+		do p = glm::vec3(uniform(rng),uniform(rng),uniform(rng)); while (glm::dot(p,p)>1.f or glm::dot(p,p)<1e-4f);
+		return p;
+	};
+	auto ms = [](double t0, int n) { return (glfwGetTime()-t0)*1000.0/n; };
 	
-	//p0_2d = glm::vec2(px,py);
+	// construccin (promedio de 10)
+	double t0 = glfwGetTime();
+	Bvh bvh;
+	for(int i=0;i<10;++i) bvh = Bvh(geo);
+	double build_ms = ms(t0,10);
 	
-	float zbf ;
-	glReadBuffer(GL_DEPTH);
-	glReadPixels(px,py,1,1,GL_DEPTH_COMPONENT,GL_FLOAT,&zbf);
+	// rayos desde una esfera alrededor del modelo hacia puntos de su interior,
+	// y los primeros 1000 contra todos los tringulos (Mller-Trumbore, ambas caras)
+	const int ray_count = 100000, ray_checks = 1000;
+	std::vector<glm::vec3> origins(ray_count), directions(ray_count);
+	for(int i=0;i<ray_count;++i) {
+		origins[i] = center+glm::normalize(randomPoint())*radius*2.f;
+		directions[i] = center+randomPoint()*radius*.5f-origins[i];
+	}
+	t0 = glfwGetTime();
+	int hits = 0;
+	for(int i=0;i<ray_count;++i) hits += bvh.rayCast(origins[i],directions[i]).triangle!=-1;
+	double ray_ms = ms(t0,ray_count);
+	int ray_errors = 0;
+	for(int i=0;i<ray_checks;++i) {
+		float best = std::numeric_limits<float>::max();
+		for(int t=0;t<tri_count;++t) {
+			glm::vec3 e1 = vertex(t,1)-vertex(t,0), e2 = vertex(t,2)-vertex(t,0);
+			glm::vec3 pv = glm::cross(directions[i],e2), tv = origins[i]-vertex(t,0), qv = glm::cross(tv,e1);
+			float det = glm::dot(e1,pv);
+			if (det==0.f) continue;
+			float u = glm::dot(tv,pv)/det, v = glm::dot(directions[i],qv)/det, d = glm::dot(e2,qv)/det;
+			if (u>=0.f and v>=0.f and u+v<=1.f and d>=0.f) best = std::min(best,d);
+		}
+		RayHit hit = bvh.rayCast(origins[i],directions[i]);
+		if ((hit.triangle==-1) != (best==std::numeric_limits<float>::max()) or
+			(hit.triangle!=-1 and std::fabs(hit.distance-best)>1e-5f)) ++ray_errors;
+	}
 	
-	if(zbf < 1.f) // Si no es el Z_FAR
-	{	
-		std::cout << "zbf function triggered" << std::endl;
-		
-		// Leemos el color del pixel
-		glReadBuffer(GL_BACK);
-		unsigned char color_value[3];
-		glReadPixels(px, py, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, color_value);
-		
-		// Decode the packed 24-bit index from the read-back RGB
-		int r = (int)color_value[0];
-		int g = (int)color_value[1];
-		int b = (int)color_value[2];
-		
-		int idx = (r << 16) | (g << 8) | b;
-		int texW = image.GetWidth();
-		int texH = image.GetHeight();
-		int px_tex = idx % texW;
-		int py_tex = idx / texW;
-		
-		glm::vec2 p1_tex = glm::vec2((float)px_tex, (float)py_tex);
+	// puntos ms cercanos, y los primeros 200 contra un bvh de una sola hoja
+	const int point_count = 20000, point_checks = 200;
+	std::vector<glm::vec3> points(point_count);
+	for(glm::vec3 &p : points) p = center+randomPoint()*radius*1.2f;
+	t0 = glfwGetTime();
+	for(const glm::vec3 &p : points) bvh.nearestPoint(p);
+	double point_ms = ms(t0,point_count);
+	Bvh flat(geo,1,tri_count);
+	int point_errors = 0;
+	for(int i=0;i<point_checks;++i)
+		if (std::fabs(bvh.nearestPoint(points[i]).distance-flat.nearestPoint(points[i]).distance)>1e-6f) ++point_errors;
 	
-	///p1_2d = glm::vec2(xpos,ypos);
-	/*
-	int  win_width, win_height;
-	glfwGetWindowSize(window,&win_width, &win_height);
-	auto p1_st = glm::vec2(p1_2d.x / win_width, 1 - (p1_2d.y/win_height)); 
-	auto p0_st = glm::vec2(p0_2d.x / win_width, 1 - (p0_2d.y/win_height)); 
-	auto p0_img = glm::vec2((float)image.GetWidth()*p0_st.x,(float)image.GetHeight()*p0_st.y); 
-	auto p1_img = glm::vec2((float)image.GetWidth()*p1_st.x,(float)image.GetHeight()*p1_st.y);
-	*/
-	dda(p0_2d,p1_tex,"stroke"); // implemento DDA en 3d
-	p0_2d = p1_tex;
-	texture.update(image);
+	// cajas (5% del radio) alrededor de esos puntos; en las primeras 200 deben
+	// estar todos los tringulos con un vrtice dentro, y ninguno cuya caja no la toque
+	glm::vec3 half(radius*.05f);
+	std::vector<int> found;
+	t0 = glfwGetTime();
+	size_t found_count = 0;
+	for(const glm::vec3 &p : points) { found.clear(); bvh.overlapping(p-half,p+half,found); found_count += found.size(); }
+	double box_ms = ms(t0,point_count);
+	int box_errors = 0;
+	auto inside = [&](const glm::vec3 &p, const glm::vec3 &bmin, const glm::vec3 &bmax) {
+		return p.x>=bmin.x and p.y>=bmin.y and p.z>=bmin.z and p.x<=bmax.x and p.y<=bmax.y and p.z<=bmax.z;
+	};
+	for(int i=0;i<point_checks;++i) {
+		glm::vec3 bmin = points[i]-half, bmax = points[i]+half;
+		found.clear(); bvh.overlapping(bmin,bmax,found);
+		std::vector<bool> reported(tri_count,false);
+		for(int t : found) reported[t] = true;
+		for(int t=0;t<tri_count;++t) {
+			glm::vec3 tmin = glm::min(glm::min(vertex(t,0),vertex(t,1)),vertex(t,2));
+			glm::vec3 tmax = glm::max(glm::max(vertex(t,0),vertex(t,1)),vertex(t,2));
+			bool touches = tmin.x<=bmax.x and tmin.y<=bmax.y and tmin.z<=bmax.z 
+				and tmax.x>=bmin.x and tmax.y>=bmin.y and tmax.z>=bmin.z;
+			bool has_vertex = inside(vertex(t,0),bmin,bmax) or inside(vertex(t,1),bmin,bmax) or inside(vertex(t,2),bmin,bmax);
+			if ((has_vertex and not reported[t]) or (reported[t] and not touches)) ++box_errors;
+		}
 	}
+	
+	char line[512];
+	std::snprintf(line,sizeof(line),"BVH: %i triangles, %i nodes, built in %.2f ms\n"
+				  "rays %.2f us (%.0f%% hit, %i/%i differ)\n"
+				  "nearest %.2f us (%i/%i differ)\n"
+				  "boxes %.2f us (%.1f triangles, %i/%i wrong)",
+				  tri_count,bvh.getNodeCount(),build_ms,ray_ms*1000.0,100.0*hits/ray_count,ray_errors,ray_checks,
+				  point_ms*1000.0,point_errors,point_checks,box_ms*1000.0,double(found_count)/point_count,box_errors,point_checks);
+	bvh_benchmark = line;
+	cg_info(bvh_benchmark);
 }
 
 void dda(glm::vec2 p_0,glm::vec2 p_1,std::string type)
@@ -1,3 +1,7 @@
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <thread>
 #include <glm/ext.hpp>
 #include "Geometry.hpp"
 #include "Debug.hpp"
@@ -37,6 +41,7 @@ GeometryRenderer::GeometryRenderer(const Geometry &geo, bool dynamic) {
 		count = geo.triangles.size();
 	} else 
 		count = geo.positions.size();
+	vertex_count = geo.positions.size();
 	
 	glBindVertexArray(0);
 }
@@ -55,8 +60,14 @@ GeometryRenderer &GeometryRenderer::operator=(GeometryRenderer &&geo) {
 
 void GeometryRenderer::draw() const {
 	glBindVertexArray(VAO);
-	if (EBO) glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0);
-	else glDrawArrays(GL_TRIANGLES, 0,count);
+	int base = stream_segment==-1 ? 0 : stream_segment*vertex_count;
+	if (EBO) glDrawElementsBaseVertex(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0, base);
+	else glDrawArrays(GL_TRIANGLES, base, count);
+	if (stream_segment!=-1) {
+		GLsync &fence = fences[stream_segment];
+		if (fence) glDeleteSync(fence);
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+	}
 	glBindVertexArray(0);
 }
 
@@ -66,6 +77,8 @@ void GeometryRenderer::freeResources() {
 	if (VBO_norms) glDeleteBuffers(1,&VBO_norms);
 	if (VBO_tcs) glDeleteBuffers(1,&VBO_tcs);
 	if (EBO) glDeleteBuffers(1,&EBO);
+	for(GLsync fence : fences) 
+		if (fence) glDeleteSync(fence);
 	glDeleteVertexArrays(1,&VAO);
 }
 GeometryRenderer::~GeometryRenderer() {
@@ -73,14 +86,17 @@ GeometryRenderer::~GeometryRenderer() {
 }
 
 void GeometryRenderer::updateTexCoords (const std::vector<glm::vec2> &vtc, bool realloc, bool dynamic) {
+	cg_assert(stream_segment==-1,"Use stream to update a streamed geometry");
 	updateBuffer(GL_ARRAY_BUFFER, VBO_tcs,vtc,realloc,dynamic);
 }
 
 void GeometryRenderer::updatePositions (const std::vector<glm::vec3> &vp, bool realloc, bool dynamic) {
+	cg_assert(stream_segment==-1,"Use stream to update a streamed geometry");
 	updateBuffer(GL_ARRAY_BUFFER, VBO_pos,vp,realloc,dynamic);
 }
 
 void GeometryRenderer::updateNormals (const std::vector<glm::vec3> &vn, bool realloc, bool dynamic) {
+	cg_assert(stream_segment==-1,"Use stream to update a streamed geometry");
 	updateBuffer(GL_ARRAY_BUFFER, VBO_norms,vn,realloc,dynamic);
 }
 
@@ -88,27 +104,174 @@ void GeometryRenderer::updateElements(const std::vector<int> &ve, bool realloc,
 	updateBuffer(GL_ELEMENT_ARRAY_BUFFER,EBO,ve,realloc,dynamic);
 }
 
-void Geometry::generateNormals ( ) {
-	normals.clear();
-	normals.resize(positions.size());
-	if (triangles.empty()) {
-		for(size_t i=0;i<positions.size();i+=3)
-			normals[i] = normals[i+1] = normals[i+2] = 
-				glm::normalize(
-					glm::cross(
-						(positions[i+2]-positions[i+1]),
-						(positions[i+0]-positions[i+1]) ) );
-	} else {
-		for(size_t i=0;i<triangles.size();i+=3) {
-			auto n = glm::cross( (positions[triangles[i+2]]-positions[triangles[i+1]]),
-								 (positions[triangles[i+0]]-positions[triangles[i+1]]) );
-			normals[triangles[i+0]] += n;
-			normals[triangles[i+1]] += n;
-			normals[triangles[i+2]] += n;
+// replaces buffer id with one that has count copies of its contents
+static void replicateBuffer(GLuint &id, size_t bytes, int count) {
+	GLuint ring;
+	glGenBuffers(1,&ring);
+	glBindBuffer(GL_COPY_WRITE_BUFFER,ring);
+	glBufferData(GL_COPY_WRITE_BUFFER,bytes*count,nullptr,GL_STREAM_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER,id);
+	for(int i=0;i<count;++i)
+		glCopyBufferSubData(GL_COPY_READ_BUFFER,GL_COPY_WRITE_BUFFER,0,i*bytes,bytes);
+	glDeleteBuffers(1,&id);
+	id = ring;
+}
+
+void GeometryRenderer::writeSegment(GLuint id, const std::vector<glm::vec3> &v) {
+	size_t bytes = v.size()*sizeof(glm::vec3);
+	glBindBuffer(GL_ARRAY_BUFFER,id);
+	void *dst = glMapBufferRange(GL_ARRAY_BUFFER,stream_segment*bytes,bytes,
+								 GL_MAP_WRITE_BIT|GL_MAP_INVALIDATE_RANGE_BIT|GL_MAP_UNSYNCHRONIZED_BIT);
+	cg_assert(dst,"Could not map the stream buffer");
+	std::memcpy(dst,v.data(),bytes);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+}
+
+void GeometryRenderer::stream(const std::vector<glm::vec3> &vp, const std::vector<glm::vec3> &vn) {
+	cg_assert(vp.size()==size_t(vertex_count),"Wrong positions count");
+	cg_assert(vn.size()==(VBO_norms?vp.size():0),"Wrong normals count");
+	if (stream_segment==-1) {
+		// every attribute needs the copies, so the base vertex works for all
+		// (the attribute pointers are set on each Shader::setBuffers)
+		replicateBuffer(VBO_pos,vertex_count*sizeof(glm::vec3),stream_segments);
+		if (VBO_norms) replicateBuffer(VBO_norms,vertex_count*sizeof(glm::vec3),stream_segments);
+		if (VBO_tcs) replicateBuffer(VBO_tcs,vertex_count*sizeof(glm::vec2),stream_segments);
+	}
+	stream_segment = (stream_segment+1)%stream_segments;
+	
+	GLsync &fence = fences[stream_segment];
+	if (fence) { 
+		// with 3 segments this only waits if the gpu is 2 frames behind
+		glClientWaitSync(fence,GL_SYNC_FLUSH_COMMANDS_BIT,1000000000);
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+	writeSegment(VBO_pos,vp);
+	if (VBO_norms) writeSegment(VBO_norms,vn);
+}
+
+namespace {
+
+// calls f(begin,end) for consecutive chunks of [0,count), one per thread 
+// (this one included), with at least min_chunk elements each
+// threads that parallelChunks uses for count elements
+int chunkThreads(int count, int threads) {
+	constexpr int min_chunk = 16*1024;
+	if (threads<=0) threads = std::max(1u,std::thread::hardware_concurrency());
+	return std::max(1,std::min(threads,count/min_chunk));
+}
+
+template<typename TFunc>
+void parallelChunks(int count, int threads, TFunc f) {
+	threads = chunkThreads(count,threads);
+	int chunk = (count+threads-1)/threads;
+	std::vector<std::thread> workers;
+	for(int i=1;i<threads;++i)
+		workers.emplace_back(f,i*chunk,std::min(count,(i+1)*chunk));
+	f(0,std::min(count,chunk));
+	for(std::thread &w : workers) 
+		w.join();
+}
+
+// angle between two (not normalized) edges
+float cornerAngle(const glm::vec3 &a, const glm::vec3 &b) {
+	return std::atan2(glm::length(glm::cross(a,b)),glm::dot(a,b));
+}
+
+}
+
+void NormalsGenerator::buildAdjacency(const std::vector<int> &triangles, int vertex_count) {
+	m_vertex_count = vertex_count;
+	m_index_count = triangles.size();
+	m_begin.assign(m_vertex_count+1,0);
+	for(int v : triangles) ++m_begin[v+1];
+	for(int v=0;v<m_vertex_count;++v) m_begin[v+1] += m_begin[v];
+	m_corners.resize(triangles.size());
+	std::vector<int> filled(m_begin.begin(),m_begin.end()-1);
+	for(size_t i=0;i<triangles.size();++i) 
+		m_corners[filled[triangles[i]]++] = i;
+}
+
+void NormalsGenerator::generate(const std::vector<glm::vec3> &pos, const std::vector<int> &tris,
+								std::vector<glm::vec3> &normals) 
+{
+	normals.resize(pos.size());
+	if (tris.empty()) { // (each 3 consecutive vertexes are a face)
+		parallelChunks(pos.size()/3,m_threads,[&](int begin, int end) {
+			for(int t=begin;t<end;++t) {
+				glm::vec3 n = glm::cross(pos[3*t+2]-pos[3*t+1],pos[3*t]-pos[3*t+1]);
+				float len = glm::length(n);
+				normals[3*t] = normals[3*t+1] = normals[3*t+2] = len==0.f ? n : n/len;
+			}
+		});
+		return;
+	}
+	// what each corner of face t adds to its vertex
+	bool by_corner = m_weighting==wAngle;
+	auto cornerWeights = [&](int t, glm::vec3 w[3]) {
+		const glm::vec3 &p0 = pos[tris[3*t]], &p1 = pos[tris[3*t+1]], &p2 = pos[tris[3*t+2]];
+		glm::vec3 n = glm::cross(p2-p1,p0-p1);
+		if (m_weighting!=wArea) {
+			float len = glm::length(n);
+			if (len!=0.f) n /= len;
+		}
+		if (by_corner) {
+			float a0 = cornerAngle(p1-p0,p2-p0), a1 = cornerAngle(p2-p1,p0-p1);
+			w[0] = n*a0;
+			w[1] = n*a1;
+			w[2] = n*std::max(0.f,3.14159265f-a0-a1); // (they add up to pi)
+		} else 
+			w[0] = w[1] = w[2] = n;
+	};
+	auto normalize = [&](int begin, int end) {
+		for(int v=begin;v<end;++v) {
+			float len = glm::length(normals[v]);
+			if (len!=0.f) normals[v] /= len;
+		}
+	};
+	
+	// a single thread scatters the faces into their vertexes, which is
+	// faster than gathering and adds every sum in the same (triangles') order
+	if (chunkThreads(pos.size(),m_threads)==1) {
+		std::fill(normals.begin(),normals.end(),glm::vec3(0.f));
+		glm::vec3 w[3];
+		for(size_t t=0;t<tris.size()/3;++t) {
+			cornerWeights(t,w);
+			for(int k=0;k<3;++k) normals[tris[3*t+k]] += w[k];
+		}
+		normalize(0,pos.size());
+		return;
+	}
+	
+	if (m_vertex_count!=int(pos.size()) or m_index_count!=int(tris.size())) buildAdjacency(tris,pos.size());
+	// faces: what each corner adds to its vertex (the same for the three,
+	// and stored once, unless weighted by angle)
+	m_weighted.resize(by_corner ? tris.size() : tris.size()/3);
+	parallelChunks(tris.size()/3,m_threads,[&](int begin, int end) {
+		glm::vec3 w[3];
+		for(int t=begin;t<end;++t) {
+			cornerWeights(t,w);
+			if (by_corner) for(int k=0;k<3;++k) m_weighted[3*t+k] = w[k];
+			else m_weighted[t] = w[0];
 		}
-		for(auto &n : normals) 
-			if (glm::dot(n,n)!=0) 
-				n = glm::normalize(n);
-	}	
+	});
+	
+	// vertexes: the sum of their corners'
+	parallelChunks(pos.size(),m_threads,[&](int begin, int end) {
+		for(int v=begin;v<end;++v) {
+			glm::vec3 n(0.f);
+			if (by_corner) {
+				for(int i=m_begin[v];i<m_begin[v+1];++i) n += m_weighted[m_corners[i]];
+			} else {
+				for(int i=m_begin[v];i<m_begin[v+1];++i) n += m_weighted[m_corners[i]/3];
+			}
+			normals[v] = n;
+		}
+		normalize(begin,end);
+	});
+}
+
+void Geometry::generateNormals() {
+	NormalsGenerator().generate(*this);
 }
 
@@ -11,10 +11,44 @@ struct Geometry {
 	std::vector<glm::vec3> normals;
 	std::vector<glm::vec2> tex_coords;
 	std::vector<int> triangles;
-	void generateNormals();
+	void generateNormals(); // (with a NormalsGenerator)
 	
 };
 
+// computes the normals of geometries that keep the same triangles, such as
+// one whose vertexes move every frame: the triangles around each vertex are
+// found on the first call, and reused until invalidate() is called (or the
+// vertex or index count changes); then faces and vertexes are processed in chunks by up to
+// threads threads (0 for one per core, fewer for small geometries), each
+// vertex gathering its faces instead of faces scattering into vertexes, so
+// no two threads write the same element (if only one thread would be used,
+// faces scatter, as that's faster and gives the same sums, and the
+// triangles around each vertex are not needed); wArea weights each face by its
+// area (as generateNormals does), wAngle by its corner's angle at the
+// vertex, and wUniform gives all of them the same weight
+class NormalsGenerator {
+public:
+	enum Weighting { wArea, wAngle, wUniform };
+	NormalsGenerator(Weighting weighting=wArea, int threads=0) 
+		: m_weighting(weighting), m_threads(threads) { }
+	// normals of the triangles (indexes into positions, or none if each 3
+	// consecutive positions are a face) at those positions
+	void generate(const std::vector<glm::vec3> &positions, const std::vector<int> &triangles,
+				  std::vector<glm::vec3> &normals);
+	void generate(Geometry &geo) { generate(geo.positions,geo.triangles,geo.normals); }
+	// to be called when the triangles change
+	void invalidate() { m_vertex_count = m_index_count = -1; }
+	void setWeighting(Weighting weighting) { m_weighting = weighting; }
+	Weighting getWeighting() const { return m_weighting; }
+private:
+	void buildAdjacency(const std::vector<int> &triangles, int vertex_count);
+	Weighting m_weighting;
+	int m_threads;
+	int m_vertex_count = -1, m_index_count = -1; // the adjacency was built for
+	std::vector<int> m_begin, m_corners; // corners (3*triangle+k) of each vertex, from m_begin[v] to m_begin[v+1]
+	std::vector<glm::vec3> m_weighted; // weighted face normals, by corner or by face
+};
+
 class GeometryRenderer {
 public:
 	GeometryRenderer() = default;
@@ -32,13 +66,26 @@ public:
 	void updateNormals(const std::vector<glm::vec3> &vn, bool realloc=false, bool dynamic=false);
 	void updateElements(const std::vector<int> &ve, bool realloc=false, bool dynamic=false);
 	
+	// for geometry rewritten every frame: the first call turns the vertex 
+	// buffers into rings of stream_segments copies, and each call writes the
+	// next copy unsynchronized (waiting on its fence only if the gpu is still
+	// drawing from it) and makes draw use it through a base vertex; so unlike 
+	// update*, it never makes the driver stall on a buffer in use; normals
+	// must be given if the geometry has them
+	static constexpr int stream_segments = 3;
+	void stream(const std::vector<glm::vec3> &vp, const std::vector<glm::vec3> &vn);
+	bool isStreaming() const { return stream_segment!=-1; }
+	
 	~GeometryRenderer();
 private:
 	GeometryRenderer(const GeometryRenderer &) = delete;
 	GeometryRenderer &operator=(const GeometryRenderer &) = default;
 	void freeResources();
+	void writeSegment(GLuint id, const std::vector<glm::vec3> &v);
 	GLuint VAO=0, VBO_pos=0, VBO_tcs=0, VBO_norms=0, EBO=0;
-	int count = 0;
+	int count = 0, vertex_count = 0;
+	int stream_segment = -1; // the one draw uses, -1 if not streaming
+	mutable GLsync fences[stream_segments] = {}; // set when a draw that reads each segment is issued
 };
 
 #endif
@@ -138,6 +138,31 @@ double FrameTimer::newFrame() {
 	return delta;
 }
 
+GpuTimer::GpuTimer() {
+	glGenQueries(queries_count,queries);
+}
+
+GpuTimer::~GpuTimer() {
+	glDeleteQueries(queries_count,queries);
+}
+
+void GpuTimer::begin() {
+	// read the oldest query before reusing it (it's from queries_count frames ago)
+	if (pending[current]) {
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(queries[current],GL_QUERY_RESULT,&ns);
+		ms = ns*1e-6;
+		pending[current] = false;
+	}
+	glBeginQuery(GL_TIME_ELAPSED,queries[current]);
+}
+
+void GpuTimer::end() {
+	glEndQuery(GL_TIME_ELAPSED);
+	pending[current] = true;
+	current = (current+1)%queries_count;
+}
+
 bool Window::IsImGuiEnabled (GLFWwindow * window) {
 	auto win = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
 	return win and win->imgui_context;
@@ -49,6 +49,25 @@ private:
 	int fps = 0, fps_aux=0;
 };
 
+// gpu time spent between begin and end; each result is read a few frames
+// later, when it is already available, so it never stalls
+class GpuTimer {
+public:
+	GpuTimer();
+	~GpuTimer();
+	void begin();
+	void end();
+	double getMilliseconds() const { return ms; } // the last one that was read
+private:
+	GpuTimer(const GpuTimer &) = delete;
+	GpuTimer &operator=(const GpuTimer &) = delete;
+	static constexpr int queries_count = 3;
+	GLuint queries[queries_count] = {};
+	bool pending[queries_count] = {};
+	int current = 0;
+	double ms = 0;
+};
+
 namespace ImGui {
 	bool Combo(const char *label, int *current_item, const std::vector<std::string> &items);
 };
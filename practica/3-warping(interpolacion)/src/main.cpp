@@ -22,7 +22,10 @@
 std::vector<std::string> models_names = { "suzanne", "fish" };
 int current_model = 0;
 bool wireframe = false, apply_warp = true, 
-	 show_delaunay = false, show_points = true;
+	 show_delaunay = false, show_points = true,
+	 stream_updates = true; // GeometryRenderer::stream en lugar de update*
+std::vector<std::string> weighting_names = { "area", "angle", "uniform" };
+int normals_weighting = NormalsGenerator::wArea; // cmo se promedian las normales de las caras en cada vrtice
 
 // triangulations
 Delaunay new_delaunay() { float l=1.3f; return Delaunay({-l,-l,-l},{+l,+l,+l}); }
@@ -39,10 +42,10 @@ void keyboardCallback(GLFWwindow* glfw_win, int key, int scancode, int action, i
 
 // funciones para aplicar o deshacer la distorsin
 glm::vec3 warpPoint(const Delaunay &delaunay0, const Delaunay &delaunay1, glm::vec3 p);
-void applyWarp(const Delaunay &delaunay0, const Delaunay &delaunay1, 
-			   const Geometry &geometry, GeometryRenderer &renderer);
-void restoreGeometry(const Delaunay &delaunay0, const Delaunay &delaunay1, 
-			         const Geometry &geometry, GeometryRenderer &renderer);
+void applyWarp(const Delaunay &delaunay0, const Delaunay &delaunay1, const Geometry &geometry,
+			   GeometryRenderer &renderer, NormalsGenerator &normals);
+void restoreGeometry(const Delaunay &delaunay0, const Delaunay &delaunay1, const Geometry &geometry,
+			         GeometryRenderer &renderer, NormalsGenerator &normals);
 
 // programa principal
 int main() {
@@ -65,8 +68,14 @@ int main() {
 		   shader_wire("shaders/wireframe");
 	int loaded_model = -1;
 	std::vector<Model> models;
+	std::vector<NormalsGenerator> normals_generators; // uno por parte, conservan su adyacencia entre cuadros
 	DelaunayRenderer delaunay_renderer;
 	
+	// tiempos: del frame, de actualizar los vertices (cpu) y de dibujar el modelo (gpu)
+	FrameTimer frame_timer;
+	GpuTimer gpu_timer;
+	double frame_ms = 0, update_ms = 0;
+	
 	// main loop
 	do {
 		
@@ -74,24 +83,33 @@ int main() {
 		if (loaded_model!=current_model) {
 			models = Model::load(models_names[current_model],Model::fKeepGeometry|Model::fDynamic|Model::fNoTextures);
 			loaded_model = current_model;
+			normals_generators.assign(models.size(),NormalsGenerator());
 		}
 		
 		glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+		frame_ms = frame_timer.newFrame()*1000.0;
 		
 		// dibujar el modelo
 		glPolygonMode(GL_FRONT_AND_BACK,wireframe?GL_LINE:GL_FILL);
-		for(Model &part : models) {
+		gpu_timer.begin();
+		update_ms = 0;
+		for(size_t i=0;i<models.size();++i) {
+			Model &part = models[i];
 			Shader &shader = wireframe ? shader_wire : shader_phong;
 			shader.use();
 			setMatrixes(shader);
 			shader.setLight(glm::vec4{-2.f,-2.f,-4.f,0.f}, glm::vec3{1.f,1.f,1.f}, 0.15f);
 			// aplicar deformacion
 			auto func = apply_warp?applyWarp:restoreGeometry;
-			func(delaunay0,delaunay1,part.geometry,part.buffers);
+			double t0 = glfwGetTime();
+			normals_generators[i].setWeighting(static_cast<NormalsGenerator::Weighting>(normals_weighting));
+			func(delaunay0,delaunay1,part.geometry,part.buffers,normals_generators[i]);
+			update_ms += (glfwGetTime()-t0)*1000.0;
 			shader.setBuffers(part.buffers);
 			shader.setMaterial(part.material);
 			part.buffers.draw();
 		}
+		gpu_timer.end();
 		
 		// dibujar la triangulacion
 		if (show_delaunay||show_points) {
@@ -110,6 +128,11 @@ int main() {
 			ImGui::Checkbox("Delaunay (D)",&show_delaunay);
 			ImGui::Checkbox("Wireframe (W)",&wireframe);
 			ImGui::Checkbox("Control Points(P)",&show_points);
+			if (ImGui::Checkbox("Stream updates",&stream_updates))
+				loaded_model = -1; // se recarga, una geometra en stream no admite update*
+			ImGui::Combo("Normals weighting",&normals_weighting,weighting_names);
+			ImGui::Text("frame %.2f ms, warp+upload %.2f ms, gpu %.2f ms",
+						frame_ms, update_ms, gpu_timer.getMilliseconds());
 			if (ImGui::Button("Reset Positions (R)"))
 				delaunay1 = delaunay0;
 			if (ImGui::Button("Reset All (C)")) 
@@ -154,29 +177,39 @@ glm::vec3 warpPoint(const Delaunay &delaunay0, const Delaunay &delaunay1, glm::v
 }
 
 // distorsiona toda la geometra
-void applyWarp(const Delaunay &delaunay0, const Delaunay &delaunay1,
-			   const Geometry &geometry, GeometryRenderer &renderer) 
+void applyWarp(const Delaunay &delaunay0, const Delaunay &delaunay1, const Geometry &geometry,
+			   GeometryRenderer &renderer, NormalsGenerator &normals) 
 {
-	// obtener vertices deformados
-	Geometry new_geom;
-	new_geom.positions.reserve(geometry.positions.size());
-	for(glm::vec3 p : geometry.positions)
-		new_geom.positions.push_back( warpPoint(delaunay0,delaunay1,p) );
+	// obtener vertices deformados (en vectores que se reutilizan entre
+	// llamadas, para no pedir memoria en cada cuadro)
+	static std::vector<glm::vec3> positions, new_normals;
+	positions.resize(geometry.positions.size());
+	for(size_t i=0;i<positions.size();++i)
+		positions[i] = warpPoint(delaunay0,delaunay1,geometry.positions[i]);
 	
-	// recalcular normales y enviar los nuevos datos a la gpu
-	new_geom.triangles = geometry.triangles;
-	new_geom.generateNormals();
-	renderer.updatePositions(new_geom.positions,false);
-	renderer.updateNormals(new_geom.normals,false);
+	// recalcular normales (los tringulos no cambian, as que el generador
+	// reutiliza la adyacencia del cuadro anterior, y no hace falta copiarlos)
+	// y enviar los nuevos datos a la gpu
+	normals.generate(positions,geometry.triangles,new_normals);
+	if (stream_updates) {
+		renderer.stream(positions,new_normals);
+	} else {
+		renderer.updatePositions(positions,false);
+		renderer.updateNormals(new_normals,false);
+	}
 }
 
 // restablece los vertices originales
-void restoreGeometry(const Delaunay &delaunay0, const Delaunay &delaunay1,
-					 const Geometry &geometry, GeometryRenderer &renderer) 
+void restoreGeometry(const Delaunay &delaunay0, const Delaunay &delaunay1, const Geometry &geometry,
+					 GeometryRenderer &renderer, NormalsGenerator &normals) 
 {
 	// enviar los datos originales a la gpu
-	renderer.updatePositions(geometry.positions,false);
-	renderer.updateNormals(geometry.normals,false);
+	if (stream_updates) {
+		renderer.stream(geometry.positions,geometry.normals);
+	} else {
+		renderer.updatePositions(geometry.positions,false);
+		renderer.updateNormals(geometry.normals,false);
+	}
 }
 
 // teclado: atajos para las settings
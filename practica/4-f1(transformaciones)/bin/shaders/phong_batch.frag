@@ -0,0 +1,26 @@
+# version 330 core
+
+in vec3 fragNormal;
+in vec3 fragPosition;
+in vec4 lightVSPosition;
+
+// propiedades del material (de la tabla por dibujo)
+flat in vec3 fragAmbient;
+flat in vec3 fragDiffuse;
+flat in vec3 fragSpecular;
+flat in vec3 fragEmission;
+flat in vec2 fragShininessOpacity;
+
+// propiedades de la luz
+uniform float ambientStrength;
+uniform vec3 lightColor;
+
+out vec4 fragColor;
+
+#include "funcs/calcPhong.frag"
+
+void main() {
+	vec3 phong = calcPhong(lightVSPosition, lightColor,
+						   fragAmbient, fragDiffuse, fragSpecular, fragShininessOpacity.x);
+	fragColor = vec4(phong+fragEmission,fragShininessOpacity.y);
+}
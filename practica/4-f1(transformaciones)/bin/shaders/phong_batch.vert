@@ -0,0 +1,41 @@
+#version 330 core
+
+in vec3 vertexPosition;
+in vec3 vertexNormal;
+
+// tabla por dibujo (ver DrawCommands)
+in mat4 drawMatrix;
+in vec3 drawAmbient;
+in vec3 drawDiffuse;
+in vec3 drawSpecular;
+in vec3 drawEmission;
+in vec2 drawShininessOpacity;
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+uniform vec4 lightPosition;
+
+out vec3 fragPosition;
+out vec3 fragNormal;
+out vec4 lightVSPosition;
+flat out vec3 fragAmbient;
+flat out vec3 fragDiffuse;
+flat out vec3 fragSpecular;
+flat out vec3 fragEmission;
+flat out vec2 fragShininessOpacity;
+
+void main() {
+	mat4 viewModel = viewMatrix*drawMatrix;
+	vec4 pAux = viewModel * vec4(vertexPosition,1.f);
+	gl_Position = projectionMatrix * pAux;
+	fragPosition = pAux.xyz/pAux.w;
+	mat3 normalMat = mat3(transpose(inverse(viewModel)));
+	fragNormal = normalMat * normalize(vertexNormal);
+	fragNormal = determinant(viewModel)<0 ? -fragNormal : fragNormal;
+	lightVSPosition = viewMatrix * lightPosition;
+	fragAmbient = drawAmbient;
+	fragDiffuse = drawDiffuse;
+	fragSpecular = drawSpecular;
+	fragEmission = drawEmission;
+	fragShininessOpacity = drawShininessOpacity;
+}
@@ -0,0 +1,15 @@
+#version 330 core
+
+in vec3 vertexPosition;
+
+in mat4 drawMatrix; // tabla por dibujo (ver DrawCommands)
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+uniform vec4 lightPosition;
+
+void main() {
+	vec4 modelPos = drawMatrix * vec4(vertexPosition,1.f); 
+	modelPos -= normalize(lightPosition)*modelPos.y; modelPos.y = 0.01;
+	gl_Position = projectionMatrix * viewMatrix * modelPos;
+}
@@ -0,0 +1,102 @@
+#include <map>
+#include <mutex>
+#include "AssetCache.hpp"
+#include "Model.hpp"
+
+namespace {
+
+// weak references to the loaded assets of one type (the handles own them)
+template<typename T>
+class AssetTable {
+public:
+	template<typename TLoad, typename TBytes>
+	std::shared_ptr<T> get(const std::string &key, TLoad load, TBytes bytes) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::weak_ptr<T> &item = m_items[key];
+		std::shared_ptr<T> p = item.lock();
+		if (p) {
+			++m_stats.hits;
+			m_stats.gpu_bytes_saved += bytes(*p);
+		} else {
+			++m_stats.misses;
+			p = load();
+			item = p;
+		}
+		return p;
+	}
+	bool has(const std::string &key) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_items.find(key);
+		return it!=m_items.end() and not it->second.expired();
+	}
+	AssetCache::Stats getStats() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_stats;
+	}
+private:
+	std::mutex m_mutex;
+	std::map<std::string,std::weak_ptr<T>> m_items;
+	AssetCache::Stats m_stats;
+};
+
+AssetTable<Texture> &textures() { static AssetTable<Texture> table; return table; }
+AssetTable<Shader> &shaders() { static AssetTable<Shader> table; return table; }
+AssetTable<const std::vector<Model>> &models() { static AssetTable<const std::vector<Model>> table; return table; }
+AssetTable<AsyncModel> &asyncModels() { static AssetTable<AsyncModel> table; return table; }
+
+std::string textureKey(const std::string &fname, int flags) {
+	return fname+"|"+std::to_string(flags);
+}
+
+size_t getGpuBytes(const std::vector<Model> &vm) {
+	size_t bytes = 0;
+	for(const Model &m : vm) {
+		bytes += m.buffers.getGpuBytes();
+		if (m.texture) bytes += m.texture->getGpuBytes();
+	}
+	return bytes;
+}
+
+}
+
+std::shared_ptr<Texture> AssetCache::getTexture(const std::string &fname, int flags, const Texture::Image *image) {
+	return textures().get(textureKey(fname,flags),
+						  [&]() { return image ? std::make_shared<Texture>(*image,flags)
+											   : std::make_shared<Texture>(fname,flags); },
+						  [](const Texture &t) { return t.getGpuBytes(); });
+}
+
+bool AssetCache::hasTexture(const std::string &fname, int flags) {
+	return textures().has(textureKey(fname,flags));
+}
+
+std::shared_ptr<Shader> AssetCache::getShader(const std::string &fname) {
+	return getShader(fname+".vert",fname+".frag");
+}
+
+std::shared_ptr<Shader> AssetCache::getShader(const std::string &vertex_fname, const std::string &fragment_fname) {
+	return shaders().get(vertex_fname+"|"+fragment_fname,
+						 [&]() { return std::make_shared<Shader>(vertex_fname,fragment_fname); },
+						 [](const Shader &) { return size_t(0); });
+}
+
+std::shared_ptr<const std::vector<Model>> AssetCache::getModels(const std::string &name, int flags) {
+	return models().get(name+"|"+std::to_string(flags),
+						[&]() { return std::make_shared<const std::vector<Model>>(Model::load(name,flags)); },
+						[](const std::vector<Model> &vm) { return getGpuBytes(vm); });
+}
+
+std::shared_ptr<AsyncModel> AssetCache::getAsyncModels(const std::string &name, int flags) {
+	return asyncModels().get(name+"|"+std::to_string(flags),
+							  [&]() { return std::make_shared<AsyncModel>(Model::loadAsync(name,flags)); },
+							  [](const AsyncModel &am) { return getGpuBytes(am.get()); }); // 0 if still loading
+}
+
+AssetCache::Stats AssetCache::getTextureStats() { return textures().getStats(); }
+AssetCache::Stats AssetCache::getShaderStats() { return shaders().getStats(); }
+AssetCache::Stats AssetCache::getModelStats() {
+	Stats s = models().getStats(), sa = asyncModels().getStats();
+	s.hits += sa.hits; s.misses += sa.misses; s.gpu_bytes_saved += sa.gpu_bytes_saved;
+	return s;
+}
+
@@ -0,0 +1,42 @@
+#ifndef ASSET_CACHE_HPP
+#define ASSET_CACHE_HPP
+#include <string>
+#include <vector>
+#include <memory>
+#include "Texture.hpp"
+#include "Shaders.hpp"
+
+struct Model;
+class AsyncModel;
+
+// path-keyed cache of textures, shaders and models: each asset is loaded the
+// first time it is requested, and then every request gets a shared handle
+// to the same object, that is released when its last handle is destroyed;
+// textures can be queried from any thread, but (as everything that creates
+// GL objects) the getters must be called from the context thread
+class AssetCache {
+public:
+	struct Stats {
+		int hits = 0, misses = 0;
+		size_t gpu_bytes_saved = 0; // what the hits would have uploaded again
+	};
+
+	// image can give the already decoded pixels, used only on a miss
+	static std::shared_ptr<Texture> getTexture(const std::string &fname, int flags=Texture::fY0OnTop,
+											   const Texture::Image *image=nullptr);
+	static bool hasTexture(const std::string &fname, int flags=Texture::fY0OnTop);
+
+	static std::shared_ptr<Shader> getShader(const std::string &fname);
+	static std::shared_ptr<Shader> getShader(const std::string &vertex_fname, const std::string &fragment_fname);
+
+	// same as Model::load and Model::loadAsync
+	static std::shared_ptr<const std::vector<Model>> getModels(const std::string &name, int flags=0);
+	static std::shared_ptr<AsyncModel> getAsyncModels(const std::string &name, int flags=0);
+
+	static Stats getTextureStats();
+	static Stats getShaderStats();
+	static Stats getModelStats();
+};
+
+#endif
+
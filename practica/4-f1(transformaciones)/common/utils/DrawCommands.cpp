@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstddef>
+#include "DrawCommands.hpp"
+#include "Debug.hpp"
+
+const DrawCommands::TableAttribute DrawCommands::table_attributes[table_attribute_count] = {
+	{ "drawMatrix",           16, offsetof(DrawData,matrix) },
+	{ "drawAmbient",          3,  offsetof(DrawData,ka) },
+	{ "drawDiffuse",          3,  offsetof(DrawData,kd) },
+	{ "drawSpecular",         3,  offsetof(DrawData,ks) },
+	{ "drawEmission",         3,  offsetof(DrawData,ke) },
+	{ "drawShininessOpacity", 2,  offsetof(DrawData,shininess_opacity) } };
+
+DrawCommands::DrawCommands(DrawCommands &&other) {
+	*this = static_cast<const DrawCommands&>(other);
+	other = static_cast<const DrawCommands&>(DrawCommands());
+}
+
+DrawCommands &DrawCommands::operator=(DrawCommands &&other) {
+	freeResources();
+	*this = static_cast<const DrawCommands&>(other);
+	other = static_cast<const DrawCommands&>(DrawCommands());
+	return *this;
+}
+
+DrawCommands::~DrawCommands() {
+	freeResources();
+}
+
+void DrawCommands::freeResources() {
+	if (m_table_buffer) glDeleteBuffers(1,&m_table_buffer);
+	if (m_command_buffer) glDeleteBuffers(1,&m_command_buffer);
+}
+
+bool DrawCommands::hasMultiDraw() {
+	// (the base instance of indirect commands is only used with ARB_base_instance)
+	return GLAD_GL_ARB_multi_draw_indirect and GLAD_GL_ARB_base_instance;
+}
+
+void DrawCommands::add(const GeometryRenderer &geo, const glm::mat4 &matrix, const Material &material) {
+	add(geo,0,geo.indexCount(),matrix,material);
+}
+
+void DrawCommands::add(const GeometryRenderer &geo, int first_index, int index_count,
+					   const glm::mat4 &matrix, const Material &material)
+{
+	cg_assert(geo.indexCount()>0,"DrawCommands requires indexed geometries");
+	DrawData data = { matrix, material.ka, material.kd, material.ks, material.ke,
+		              {material.shininess,material.opacity} };
+	m_draws.push_back({&geo,first_index,index_count,data,0});
+}
+
+void DrawCommands::setTableAttributes(const GLint *locations, int entry) const {
+	glBindBuffer(GL_ARRAY_BUFFER,m_table_buffer);
+	for(int i=0;i<table_attribute_count;++i) {
+		if (locations[i]==-1) continue;
+		// a mat4 takes 4 consecutive locations, one per column
+		int columns = table_attributes[i].floats==16 ? 4 : 1, rows = table_attributes[i].floats/columns;
+		for(int c=0;c<columns;++c) {
+			size_t offset = entry*sizeof(DrawData)+table_attributes[i].offset+c*rows*sizeof(float);
+			glVertexAttribPointer(locations[i]+c, rows, GL_FLOAT, GL_FALSE, sizeof(DrawData),
+								  reinterpret_cast<const void*>(offset));
+			glVertexAttribDivisor(locations[i]+c, 1);
+			glEnableVertexAttribArray(locations[i]+c);
+		}
+	}
+}
+
+void DrawCommands::resetTableAttributes(const GLint *locations) const {
+	// (so other shaders can use these locations for per-vertex attributes)
+	for(int i=0;i<table_attribute_count;++i) {
+		if (locations[i]==-1) continue;
+		for(int c=0;c<(table_attributes[i].floats==16?4:1);++c) {
+			glVertexAttribDivisor(locations[i]+c, 0);
+			glDisableVertexAttribArray(locations[i]+c);
+		}
+	}
+}
+
+void DrawCommands::submit(Shader &shader, bool multi_draw) {
+	m_draw_calls = 0;
+	if (m_draws.empty()) return;
+	multi_draw = multi_draw and hasMultiDraw();
+
+	// group the draws by geometry, in the order each geometry first appears
+	std::vector<const GeometryRenderer*> geos;
+	for(Draw &d : m_draws) {
+		d.group = std::find(geos.begin(),geos.end(),d.geo)-geos.begin();
+		if (d.group==int(geos.size())) geos.push_back(d.geo);
+	}
+	std::stable_sort(m_draws.begin(),m_draws.end(),[](const Draw &a, const Draw &b) {
+		return a.group<b.group;
+	});
+
+	// upload the table (and the commands), orphaning last frame's buffers
+	m_table.clear(); m_commands.clear();
+	for(const Draw &d : m_draws) {
+		m_commands.push_back({GLuint(d.index_count),1,GLuint(d.first_index),0,GLuint(m_table.size())});
+		m_table.push_back(d.data);
+	}
+	if (m_table_buffer==0) glGenBuffers(1,&m_table_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER,m_table_buffer);
+	glBufferData(GL_ARRAY_BUFFER,m_table.size()*sizeof(DrawData),m_table.data(),GL_STREAM_DRAW);
+	if (multi_draw) {
+		if (m_command_buffer==0) glGenBuffers(1,&m_command_buffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER,m_command_buffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER,m_commands.size()*sizeof(Command),m_commands.data(),GL_STREAM_DRAW);
+	}
+
+	shader.use();
+	GLint locations[table_attribute_count];
+	for(int i=0;i<table_attribute_count;++i)
+		locations[i] = glGetAttribLocation(shader.getProgramId(),table_attributes[i].name);
+	cg_assert(locations[0]!=-1,"Shader does not have drawMatrix attribute");
+
+	for(size_t begin=0, end;begin<m_draws.size();begin=end) {
+		const GeometryRenderer &geo = *m_draws[begin].geo;
+		end = begin+1;
+		while (end<m_draws.size() and m_draws[end].geo==&geo) ++end;
+		shader.setBuffers(geo); // (binds its VAO)
+		if (multi_draw) {
+			setTableAttributes(locations,0); // (each command's base instance selects its entry)
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+										reinterpret_cast<const void*>(begin*sizeof(Command)),
+										end-begin, 0);
+			++m_draw_calls;
+		} else {
+			for(size_t i=begin;i<end;++i) {
+				setTableAttributes(locations,i);
+				geo.drawRange(m_draws[i].first_index,m_draws[i].index_count);
+				++m_draw_calls;
+			}
+		}
+		resetTableAttributes(locations);
+	}
+	glBindVertexArray(0);
+	m_draws.clear();
+}
+
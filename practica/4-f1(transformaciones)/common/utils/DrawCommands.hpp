@@ -0,0 +1,79 @@
+#ifndef DRAW_COMMANDS_HPP
+#define DRAW_COMMANDS_HPP
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Geometry.hpp"
+#include "Material.hpp"
+#include "Shaders.hpp"
+
+// draws gathered along a frame (ranges of indexed GeometryRenderers, each
+// with its own transform and material) to submit them all at once: the
+// transforms and materials go to a per-draw table, read by the shader as
+// instance attributes (drawMatrix, drawAmbient, drawDiffuse, drawSpecular,
+// drawEmission and drawShininessOpacity, see shaders/phong_batch.vert), and
+// the draws that share a GeometryRenderer (same VAO) are submitted with a
+// single glMultiDrawElementsIndirect, each one selecting its table entry
+// with its base instance; without multi-draw, they are submitted one by one
+// pointing the table attributes to their entry
+class DrawCommands {
+public:
+	DrawCommands() = default;
+	DrawCommands(DrawCommands &&other);
+	DrawCommands &operator=(DrawCommands &&other);
+	~DrawCommands();
+
+	void add(const GeometryRenderer &geo, const glm::mat4 &matrix, const Material &material);
+	void add(const GeometryRenderer &geo, int first_index, int index_count,
+			 const glm::mat4 &matrix, const Material &material);
+
+	// draws everything added since the last submit with shader (already set
+	// up with the uniforms that are common to all the draws), in the order
+	// they were added but grouped by geometry
+	void submit(Shader &shader, bool multi_draw=true);
+
+	// if multi-draw can be used (GL 4.3, or its extensions)
+	static bool hasMultiDraw();
+
+	int size() const { return m_draws.size(); }
+	int getDrawCalls() const { return m_draw_calls; } // in the last submit
+
+private:
+	DrawCommands(const DrawCommands &) = delete;
+	DrawCommands &operator=(const DrawCommands &) = default;
+	void freeResources();
+
+	// an entry of the per-draw table (as read by the shader)
+	struct DrawData {
+		glm::mat4 matrix;
+		glm::vec3 ka, kd, ks, ke;
+		glm::vec2 shininess_opacity;
+	};
+	// as glMultiDrawElementsIndirect expects it
+	struct Command {
+		GLuint count, instance_count, first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+	struct Draw {
+		const GeometryRenderer *geo;
+		int first_index, index_count;
+		DrawData data;
+		int group; // of draws with the same geo (set in submit)
+	};
+	// the table's attributes: name, floats (16 for a mat4) and offset
+	struct TableAttribute { const char *name; int floats; size_t offset; };
+	static constexpr int table_attribute_count = 6;
+	static const TableAttribute table_attributes[table_attribute_count];
+	void setTableAttributes(const GLint *locations, int entry) const;
+	void resetTableAttributes(const GLint *locations) const;
+
+	std::vector<Draw> m_draws;
+	std::vector<DrawData> m_table;
+	std::vector<Command> m_commands;
+	GLuint m_table_buffer = 0, m_command_buffer = 0;
+	int m_draw_calls = 0;
+};
+
+#endif
+
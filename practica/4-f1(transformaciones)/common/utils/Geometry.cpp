@@ -60,6 +60,23 @@ void GeometryRenderer::draw() const {
 	glBindVertexArray(0);
 }
 
+size_t GeometryRenderer::getGpuBytes() const {
+	size_t bytes = 0;
+	for(GLuint id : {VBO_pos,VBO_norms,VBO_tcs,EBO}) {
+		if (id==0) continue;
+		GLint size = 0;
+		glBindBuffer(GL_COPY_READ_BUFFER,id);
+		glGetBufferParameteriv(GL_COPY_READ_BUFFER,GL_BUFFER_SIZE,&size);
+		bytes += size;
+	}
+	return bytes;
+}
+
+void GeometryRenderer::drawRange(int first, int count) const {
+	cg_assert(EBO,"drawRange requires an indexed geometry");
+	glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, reinterpret_cast<const void*>(first*sizeof(int)));
+}
+
 void GeometryRenderer::freeResources() {
 	if (VAO==0) return;
 	if (VBO_pos) glDeleteBuffers(1,&VBO_pos);
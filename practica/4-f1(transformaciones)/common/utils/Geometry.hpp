@@ -22,6 +22,10 @@ public:
 	GeometryRenderer(GeometryRenderer &&geo);
 	GeometryRenderer &operator=(GeometryRenderer &&geo);
 	void draw() const;
+	// draws count indexes starting at first; the VAO must be already bound
+	// (Shader::setBuffers does it), so several ranges can share one bind
+	void drawRange(int first, int count) const;
+	int indexCount() const { return EBO ? count : 0; } // 0 if not indexed
 	GLuint vertexArray() const { return VAO; }
 	GLuint positionsVBO() const { return VBO_pos; }
 	GLuint normalsVBO() const { return VBO_norms; }
@@ -33,6 +37,7 @@ public:
 	void updateElements(const std::vector<int> &ve, bool realloc=false, bool dynamic=false);
 	
 	bool isOk() const { return VAO!=0; }
+	size_t getGpuBytes() const; // total size of the buffers
 	
 	~GeometryRenderer();
 private:
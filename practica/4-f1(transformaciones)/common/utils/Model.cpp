@@ -1,32 +1,123 @@
 #include <tuple>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <set>
 #include "Model.hpp"
 #include "Debug.hpp"
 #include "ObjMesh.hpp"
 #include "Misc.hpp"
+#include "AssetCache.hpp"
 
-Model Model::loadSingle(const std::string &name, int flags) {
-	ObjMesh obj = readObj("models/"+name+".obj");
-	if (!(flags&fDontFit)) centerAndResize(obj.positions);
-	Geometry geometry = toGeometry(obj,0);
-	if (flags&fRegenerateNormals or geometry.normals.empty()) geometry.generateNormals();
-	return Model(std::move(geometry), obj.parts[0].material, flags);
+Model::Model(ModelData &&d, int flags) 
+	: buffers(d.geometry,flags&fDynamic), material(d.material)
+{
+	for(ModelData::SubMesh &sm : d.sub_meshes)
+		sub_meshes.push_back({sm.material, getTexture(sm.material,&sm.image,flags),
+							  sm.first_index, sm.index_count});
+	texture = sub_meshes.empty() ? getTexture(material,&d.image,flags) : sub_meshes[0].texture;
+	if (flags&fKeepGeometry) geometry = std::move(d.geometry);
 }
 
-std::vector<Model> Model::load(const std::string &name, int flags) {
-	auto obj = readObj("models/"+name+".obj");
+Model::Model(Geometry &&g, const Material &m, int flags) 
+	: Model(std::move(g),m,nullptr,flags) 
+{
+	
+}
+
+Model::Model(Geometry &&g, const Material &m, const Texture::Image *image, int flags) 
+	: buffers(g,flags&fDynamic), material(m), texture(getTexture(m,image,flags))
+{
+	if (flags&fKeepGeometry) geometry = std::move(g);
+}
+
+std::shared_ptr<Texture> Model::getTexture(const Material &m, const Texture::Image *image, int flags) {
+	if (m.texture.empty() or (flags&fNoTextures)) return nullptr;
+	return AssetCache::getTexture(m.texture,model2texture(flags),
+								  image and image->data ? image : nullptr);
+}
+
+// appends part to packed, rebasing its indexes (and adding empty texture
+// coordinates if only one of them has them, so all the arrays keep matching)
+static void packGeometry(Geometry &packed, const Geometry &part) {
+	int base = packed.positions.size();
+	if (part.tex_coords.empty() != packed.tex_coords.empty()) {
+		if (packed.tex_coords.empty()) packed.tex_coords.resize(packed.positions.size());
+		else packed.tex_coords.resize(packed.positions.size()+part.positions.size());
+	}
+	packed.positions.insert(packed.positions.end(),part.positions.begin(),part.positions.end());
+	packed.normals.insert(packed.normals.end(),part.normals.begin(),part.normals.end());
+	if (not part.tex_coords.empty())
+		packed.tex_coords.insert(packed.tex_coords.end(),part.tex_coords.begin(),part.tex_coords.end());
+	for(int i : part.triangles)
+		packed.triangles.push_back(base+i);
+}
+
+// the part of loading a model that does not need the GL context
+std::vector<ModelData> Model::loadData(const std::string &name, int flags, bool only_first) {
+	ObjMesh obj = readObj("models/"+name+".obj");
 	if (!(flags&fDontFit)) centerAndResize(obj.positions);
 	
-	std::vector<Model> vret; vret.reserve(obj.parts.size());
-	for (auto &part : obj.parts) {
-		Geometry geometry = toGeometry(obj,part);
-		if (flags&fRegenerateNormals or geometry.normals.empty()) geometry.generateNormals();
-		vret.emplace_back(std::move(geometry), part.material, flags);
+	size_t count = only_first ? 1 : obj.parts.size();
+	std::vector<ModelData> vret(count);
+	std::set<std::string> decoded; // parts often share their texture
+	for (size_t i=0;i<count;++i) {
+		ModelData &d = vret[i];
+		d.geometry = toGeometry(obj,obj.parts[i]);
+		if (flags&fRegenerateNormals or d.geometry.normals.empty()) d.geometry.generateNormals();
+		d.material = obj.parts[i].material;
+		const std::string &fname = d.material.texture;
+		if (not fname.empty() and not (flags&fNoTextures) and decoded.insert(fname).second
+			and not AssetCache::hasTexture(fname,model2texture(flags)))
+			d.image = Texture::decode(fname,model2texture(flags));
 	}
+	if (not (flags&fPackParts) or vret.size()<2) return vret;
+	
+	ModelData packed;
+	packed.material = vret[0].material;
+	for(ModelData &d : vret) {
+		int first = packed.geometry.triangles.size();
+		packGeometry(packed.geometry,d.geometry);
+		d.geometry = Geometry(); // free it as soon as possible
+		packed.sub_meshes.push_back({d.material, std::move(d.image), 
+									 first, int(packed.geometry.triangles.size())-first});
+	}
+	vret.clear();
+	vret.push_back(std::move(packed));
 	return vret;
 }
 
+Model Model::loadSingle(const std::string &name, int flags) {
+	return Model(std::move(loadData(name,flags,true)[0]), flags);
+}
+
+std::vector<Model> Model::load(const std::string &name, int flags) {
+	std::vector<ModelData> vd = loadData(name,flags,false);
+	std::vector<Model> vret; vret.reserve(vd.size());
+	for (auto &d : vd)
+		vret.emplace_back(std::move(d), flags);
+	return vret;
+}
+
+AsyncModel Model::loadAsync(const std::string &name, int flags) {
+	return AsyncModel(std::async(std::launch::async,loadData,name,flags,false),flags);
+}
+
+AsyncModel Model::loadSingleAsync(const std::string &name, int flags) {
+	return AsyncModel(std::async(std::launch::async,loadData,name,flags,true),flags);
+}
+
+bool AsyncModel::update() {
+	if (m_ready or not m_future.valid()) return m_ready;
+	if (m_future.wait_for(std::chrono::seconds(0))!=std::future_status::ready) return false;
+	std::vector<ModelData> vd = m_future.get();
+	m_models.reserve(vd.size());
+	for (auto &d : vd)
+		m_models.emplace_back(std::move(d), m_flags);
+	m_ready = true;
+	return true;
+}
+
 void centerAndResize(std::vector<glm::vec3> &v) {
 	// get global bb
 	glm::vec3 pmin, pmax;
@@ -1,40 +1,73 @@
 #ifndef MODEL_HPP
 #define MODEL_HPP
 #include <vector>
+#include <future>
+#include <memory>
 #include "Geometry.hpp"
 #include "Material.hpp"
 #include "Texture.hpp"
 
+class AsyncModel;
+
+// what is prepared for each Model before creating its GL objects (so it can
+// be done in any thread)
+struct ModelData {
+	Geometry geometry;
+	Material material;
+	Texture::Image image; // empty if not needed
+	// with Model::fPackParts, one for each part of the obj packed in geometry
+	struct SubMesh {
+		Material material;
+		Texture::Image image;
+		int first_index = 0, index_count = 0;
+	};
+	std::vector<SubMesh> sub_meshes;
+};
+
 // auxiliar struct for loading all model-related data
 struct Model {
 	Geometry geometry;
 	GeometryRenderer buffers;
 	Material material;
-	Texture texture;
+	std::shared_ptr<Texture> texture; // null if none, shared by every Model with the same image (see AssetCache)
 	
-	Model() = default;
+	// with fPackParts, one for each part of the obj, as ranges of the same
+	// buffers (material and texture are then those of the first one)
+	struct SubMesh {
+		Material material;
+		std::shared_ptr<Texture> texture;
+		int first_index = 0, index_count = 0;
+	};
+	std::vector<SubMesh> sub_meshes;
 	
-	Model(Geometry &&g, const Material &m, int flags) 
-		: buffers(g,flags&fDynamic), material(m), 
-		  texture(m.texture.empty() or (flags&fNoTextures) 
-	           ? Texture() 
-			   : Texture(m.texture, model2texture(flags)) )
-	{
-		if (flags&fKeepGeometry) geometry = std::move(g);
-	}
+	Model() = default;
+	Model(ModelData &&d, int flags);
+	Model(Geometry &&g, const Material &m, int flags);
+	// image can give m.texture already decoded (it's only used if that texture 
+	// is not already loaded)
+	Model(Geometry &&g, const Material &m, const Texture::Image *image, int flags);
 	
 	// flags meanings are such that 0 is default behaviour and it matches 
 	// what obj (texture repeat and flipV) and most examples (fit, static data 
-	// and discard geometry) expects
+	// and discard geometry) expects; fPackParts makes load return a single
+	// Model with all the parts in the same VAO (see sub_meshes)
 	enum Flags { fNone=0, fDontFit=1, fKeepGeometry=2, 
 				 fRegenerateNormals=4, fDynamic=8, 
-		         fNoTextures=16, fTextureDontFlipV=32, fTextureClamp=64 };
+		         fNoTextures=16, fTextureDontFlipV=32, fTextureClamp=64,
+		         fPackParts=128 };
 	static std::vector<Model> load(const std::string &name, int flags = 0);
 	static Model loadSingle(const std::string &name, int flags = 0);
 	
+	// same as load/loadSingle, but everything but creating the GL objects is
+	// done in a worker thread, so the caller can keep rendering meanwhile
+	static AsyncModel loadAsync(const std::string &name, int flags = 0);
+	static AsyncModel loadSingleAsync(const std::string &name, int flags = 0);
+	
 	bool isOk() const { return buffers.isOk(); }
 		
 private:
+	static std::shared_ptr<Texture> getTexture(const Material &m, const Texture::Image *image, int flags);
+	static std::vector<ModelData> loadData(const std::string &name, int flags, bool only_first);
 	static int model2texture(int flags) {
 		return 
 			((flags&fTextureClamp)?(Texture::fClampS|Texture::fClampT):0)
@@ -42,6 +75,30 @@ private:
 	}
 };
 
+// handle to the models of an obj being loaded in a worker thread (parsing,
+// toGeometry, normals and image decoding); update() must be called from the
+// context thread (once per frame is enough) to create the buffers and
+// textures once the worker is done, until then get() is just empty
+class AsyncModel {
+public:
+	AsyncModel() = default;
+	AsyncModel(std::future<std::vector<ModelData>> &&future, int flags)
+		: m_future(std::move(future)), m_flags(flags) {}
+	
+	// creates the models if the worker is done (and rethrows its errors)
+	bool update();
+	bool isOk() const { return m_ready; }
+	
+	const std::vector<Model> &get() const { return m_models; }
+	std::vector<Model> &get() { return m_models; }
+	
+private:
+	std::future<std::vector<ModelData>> m_future;
+	std::vector<Model> m_models;
+	int m_flags = 0;
+	bool m_ready = false;
+};
+
 void centerAndResize(std::vector<glm::vec3> &v);
 
 #endif
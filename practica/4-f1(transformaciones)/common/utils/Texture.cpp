@@ -1,8 +1,35 @@
+#include <algorithm>
 #include <stb_image.h>
 #include "Texture.hpp"
 #include "Debug.hpp"
 
-Texture::Texture(const std::string &fname, int flags) {
+void Texture::Image::Free::operator()(unsigned char *data) const {
+	stbi_image_free(data);
+}
+
+Texture::Image Texture::decode(const std::string &fname, int flags) {
+	Image image;
+	// stb's flip flag is global, so rows are flipped here instead, to allow
+	// decoding several images at the same time from different threads
+	image.data.reset(stbi_load(fname.c_str(), &image.width, &image.height, &image.channels, 0));
+	cg_assert(image.data,"Could not load texture");
+	if (not (flags&fY0OnTop)) {
+		size_t row = size_t(image.width)*image.channels;
+		unsigned char *p = image.data.get();
+		for(int i=0, j=image.height-1; i<j; ++i, --j)
+			std::swap_ranges(p+i*row,p+(i+1)*row,p+j*row);
+	}
+	return image;
+}
+
+Texture::Texture(const std::string &fname, int flags) 
+	: Texture(decode(fname,flags),flags) 
+{
+	
+}
+
+Texture::Texture(const Image &image, int flags) {
+	cg_assert(image.data,"Invalid image for texture");
 	glGenTextures(1, &id);
 	glBindTexture(GL_TEXTURE_2D, id); 
 	// set the texture wrapping parameters
@@ -11,14 +38,10 @@ Texture::Texture(const std::string &fname, int flags) {
 	// set texture filtering parameters
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load image, create texture and generate mipmaps
-	stbi_set_flip_vertically_on_load(!(flags&fY0OnTop)); // tell stb_image.h to flip loaded texture's on the y-axis.
-	// The FileSystem::getPath(...) is part of the GitHub repository so we can find files on any IDE/platform; replace it with your own image path.
-	unsigned char *data = stbi_load(fname.c_str(), &width, &height, &channels, 0);
-	cg_assert(data,"Could not load texture");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, channels==3?GL_RGB:GL_RGBA, GL_UNSIGNED_BYTE, data);
+	// upload the image and generate mipmaps
+	width = image.width; height = image.height; channels = image.channels;
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, channels==3?GL_RGB:GL_RGBA, GL_UNSIGNED_BYTE, image.data.get());
 	glGenerateMipmap(GL_TEXTURE_2D);
-	stbi_image_free(data);
 	this->repeat_s = !(flags&fClampS); 
 	this->repeat_t = !(flags&fClampT);
 }
@@ -2,18 +2,32 @@
 #define TEXTURE_H
 
 #include <string>
+#include <memory>
 #include <glad/glad.h>
 
 class Texture {
 public:
 	enum Flags { fNone=0, fY0OnTop=1, fClampS=2, fClampT=4 };
+	
+	// pixels of an image file, decoded but not uploaded yet (decoding does
+	// not need the GL context, so it can be done in any thread)
+	struct Image {
+		struct Free { void operator()(unsigned char *data) const; };
+		std::unique_ptr<unsigned char[],Free> data;
+		int width=-1, height=-1, channels=-1;
+	};
+	static Image decode(const std::string &fname, int flags=fY0OnTop);
+	
 	Texture() = default;
 	Texture(const std::string &fname, int flags=fY0OnTop);
+	Texture(const Image &image, int flags=fY0OnTop);
 	Texture(Texture &&t);
 	Texture &operator=(Texture &&t);
 	~Texture();
 	void bind(int number=0) const;
 	bool isOk() const { return channels!=-1; }
+	// video memory used (rgba, with mipmaps)
+	size_t getGpuBytes() const { return isOk() ? size_t(width)*height*4*4/3 : 0; }
 private:
 	Texture &operator=(const Texture &t) = default;
 	GLuint id = 0;
@@ -1,53 +1,80 @@
 #include <glm/ext.hpp>
 #include "Render.hpp"
 #include "Callbacks.hpp"
+#include "AssetCache.hpp"
+#include "DrawCommands.hpp"
 
 extern bool wireframe, play, top_view, use_helmet;
+extern int submit_mode;
+
+// con submit_mode!=smPerPart, renderPart solo agrega aqu y renderCar enva todo junto
+static DrawCommands draw_commands;
+static int draw_calls = 0; // del auto, en el ltimo renderCar
 
 // matrices que definen la camara
 glm::mat4 projection_matrix, view_matrix;
 
 // funcin para renderizar cada "parte" del auto
 void renderPart(const Car &car, const std::vector<Model> &v_models, const glm::mat4 &matrix, Shader &shader) {
-	// select a shader
-	for(const Model &model : v_models) {
-		shader.use();
+	// matrixes
+	glm::mat4 model_matrix;
+	if (play) {
+		/// @todo: modificar una de estas matrices para mover todo el auto (todas
+		///        las partes) a la posicin (y orientacin) que le corresponde en la pista
+		glm::mat4 trans(1.0f, 0.0f , 0.0f, 0.0f,
+						0.0f, 1.0f , 0.0f, 0.0f,
+						0.0f, 0.0f , 1.0f, 0.0f,
+						car.x,0.0f, car.y, 1.0f);
 		
-		// matrixes
-		if (play) {
-			/// @todo: modificar una de estas matrices para mover todo el auto (todas
-			///        las partes) a la posicin (y orientacin) que le corresponde en la pista
-			glm::mat4 trans(1.0f, 0.0f , 0.0f, 0.0f,
+		
+		float gamma = car.ang;
+		
+		glm::mat4 rotsides (cos(gamma), 0.0f , sin(gamma), 0.0f,
 							0.0f, 1.0f , 0.0f, 0.0f,
-							0.0f, 0.0f , 1.0f, 0.0f,
-							car.x,0.0f, car.y, 1.0f);
-			
-			
-			float gamma = car.ang;
-			
-			glm::mat4 rotsides (cos(gamma), 0.0f , sin(gamma), 0.0f,
-								0.0f, 1.0f , 0.0f, 0.0f,
-								-1*sin(gamma), 0.0f ,cos(gamma), 0.0f,
-								0.0f, 0.0f, 0.0f, 1.0f);
-			
-			glm::mat4 model_matrix = trans*rotsides*matrix;
-			
-			shader.setMatrixes(model_matrix,view_matrix,projection_matrix);
-		} else {
-			glm::mat4 model_matrix = glm::rotate(glm::mat4(1.f),view_angle,glm::vec3{1.f,0.f,0.f}) *
-						             glm::rotate(glm::mat4(1.f),model_angle,glm::vec3{0.f,1.f,0.f}) *
-			                         matrix;
-			shader.setMatrixes(model_matrix,view_matrix,projection_matrix);
+							-1*sin(gamma), 0.0f ,cos(gamma), 0.0f,
+							0.0f, 0.0f, 0.0f, 1.0f);
+		
+		model_matrix = trans*rotsides*matrix;
+	} else {
+		model_matrix = glm::rotate(glm::mat4(1.f),view_angle,glm::vec3{1.f,0.f,0.f}) *
+					   glm::rotate(glm::mat4(1.f),model_angle,glm::vec3{0.f,1.f,0.f}) *
+		               matrix;
+	}
+	
+	// gather the draws, renderCar submits them all together
+	if (submit_mode!=smPerPart) {
+		for(const Model &model : v_models) {
+			if (model.sub_meshes.empty())
+				draw_commands.add(model.buffers,model_matrix,model.material);
+			else
+				for(const Model::SubMesh &sm : model.sub_meshes)
+					draw_commands.add(model.buffers,sm.first_index,sm.index_count,model_matrix,sm.material);
 		}
+		return;
+	}
+	
+	// select a shader
+	for(const Model &model : v_models) {
+		shader.use();
+		shader.setMatrixes(model_matrix,view_matrix,projection_matrix);
 		
-		// setup light and material
+		// setup light and geometry
 		shader.setLight(glm::vec4{20.f,40.f,20.f,0.f}, glm::vec3{1.f,1.f,1.f}, 0.35f);
-		shader.setMaterial(model.material);
-		
-		// send geometry
 		shader.setBuffers(model.buffers);
 		glPolygonMode(GL_FRONT_AND_BACK,(wireframe and (not play))?GL_LINE:GL_FILL);
-		model.buffers.draw();
+		
+		// draw (packed models draw every part from the same VAO)
+		if (model.sub_meshes.empty()) {
+			shader.setMaterial(model.material);
+			model.buffers.draw();
+			++draw_calls;
+		} else {
+			for(const Model::SubMesh &sm : model.sub_meshes) {
+				shader.setMaterial(sm.material);
+				model.buffers.drawRange(sm.first_index,sm.index_count);
+				++draw_calls;
+			}
+		}
 	}
 }
 
@@ -71,7 +98,8 @@ void setViewAndProjectionMatrixes(const Car &car) {
 }
 
 // funcin que rendiriza todo el auto, parte por parte
-void renderCar(const Car &car, const std::vector<Part> &parts, Shader &shader) {
+int renderCar(const Car &car, const std::vector<Part> &parts, Shader &shader) {
+	draw_calls = 0;
 	const Part &axis = parts[0], &body = parts[1], &wheel = parts[2],
 	           &fwing = parts[3], &rwing = parts[4], &helmet = parts[use_helmet?5:6];
 
@@ -90,7 +118,7 @@ void renderCar(const Car &car, const std::vector<Part> &parts, Shader &shader) {
 						0.0f, 0.0f , 1.0f, 0.0f,
 						0.0f, 0.22f, 0.0f, 1.0f);
 		
-		renderPart(car,body.models,mpos*mres,shader);
+		renderPart(car,body.models.get(),mpos*mres,shader);
 	}
 	
 	if (wheel.show or play) {
@@ -128,7 +156,7 @@ void renderCar(const Car &car, const std::vector<Part> &parts, Shader &shader) {
 						0.5f, 0.18f, -0.35f, 1.0f);
 		
 		
-		renderPart(car,wheel.models,trans*rotsides*rotfor*scale,shader); 
+		renderPart(car,wheel.models.get(),trans*rotsides*rotfor*scale,shader); 
 		
 		// Pos Back-left
 		trans= glm::mat4(1.0f, 0.0f , 0.0f, 0.0f,
@@ -136,7 +164,7 @@ void renderCar(const Car &car, const std::vector<Part> &parts, Shader &shader) {
 						0.0f, 0.0f , 1.0f, 0.0f,
 						-0.9f, 0.18f , -0.42f, 1.0f);
 		
-		renderPart(car,wheel.models,trans*rotfor*scale,shader); 
+		renderPart(car,wheel.models.get(),trans*rotfor*scale,shader); 
 		
 		// Pos Back-Right
 		
@@ -152,7 +180,7 @@ void renderCar(const Car &car, const std::vector<Part> &parts, Shader &shader) {
 		
 		glm::mat4 finalMatrix = trans * rotfor * rot * scale;
 		
-		renderPart(car,wheel.models,finalMatrix,shader); 
+		renderPart(car,wheel.models.get(),finalMatrix,shader); 
 		
 		// Pos Front-Right
 		
@@ -168,7 +196,7 @@ void renderCar(const Car &car, const std::vector<Part> &parts, Shader &shader) {
 		
 		finalMatrix = trans * rotsides * rotfor * rot * scale;
 		
-		renderPart(car,wheel.models,finalMatrix,shader); 
+		renderPart(car,wheel.models.get(),finalMatrix,shader); 
 	}
 	
 	if (fwing.show or play) {
@@ -192,7 +220,7 @@ void renderCar(const Car &car, const std::vector<Part> &parts, Shader &shader) {
 					   -1*sin(theta), 0.0f ,cos(theta), 0.0f,
 					   0.0f, 0.0f, 0.0f, 1.0f);
 		
-		renderPart(car,fwing.models,trans*rot*scale,shader);
+		renderPart(car,fwing.models.get(),trans*rot*scale,shader);
 	}
 	
 	if (rwing.show or play) {
@@ -215,7 +243,7 @@ void renderCar(const Car &car, const std::vector<Part> &parts, Shader &shader) {
 					   -1*sin(theta), 0.0f ,cos(theta), 0.0f,
 					   0.0f, 0.0f, 0.0f, 1.0f);
 		
-		renderPart(car,rwing.models,trans*rot*scale,shader);
+		renderPart(car,rwing.models.get(),trans*rot*scale,shader);
 	}
 	
 	if (helmet.show or play) {
@@ -238,21 +266,35 @@ void renderCar(const Car &car, const std::vector<Part> &parts, Shader &shader) {
 					   -1*sin(theta), 0.0f ,cos(theta), 0.0f,
 					   0.0f, 0.0f, 0.0f, 1.0f);
 		
-		renderPart(car,helmet.models,trans*rot*scale,shader);
+		renderPart(car,helmet.models.get(),trans*rot*scale,shader);
 	}
 	
-	if (axis.show and (not play)) renderPart(car,axis.models,glm::mat4(1.f),shader);
+	if (axis.show and (not play)) renderPart(car,axis.models.get(),glm::mat4(1.f),shader);
+	
+	// send everything renderPart gathered (the matrixes and materials of each
+	// part go in the table, only what is common to all of them is set here)
+	if (submit_mode!=smPerPart) {
+		shader.use();
+		shader.setMatrixes(glm::mat4(1.f),view_matrix,projection_matrix);
+		shader.setLight(glm::vec4{20.f,40.f,20.f,0.f}, glm::vec3{1.f,1.f,1.f}, 0.35f);
+		glPolygonMode(GL_FRONT_AND_BACK,(wireframe and (not play))?GL_LINE:GL_FILL);
+		draw_commands.submit(shader,submit_mode==smMultiDraw);
+		draw_calls = draw_commands.getDrawCalls();
+	}
+	return draw_calls;
 }
 
 // funcin que renderiza la pista
 void renderTrack() {
-	static Model track = Model::loadSingle("track",Model::fDontFit);
-	static Shader shader("shaders/texture");
-	shader.use();
-	shader.setMatrixes(glm::mat4(1.f),view_matrix,projection_matrix);
-	shader.setMaterial(track.material);
-	shader.setBuffers(track.buffers);
-	track.texture.bind();
+	static AsyncModel async_track = Model::loadSingleAsync("track",Model::fDontFit);
+	static std::shared_ptr<Shader> shader = AssetCache::getShader("shaders/texture");
+	if (not async_track.update()) return; // still loading
+	const Model &track = async_track.get()[0];
+	shader->use();
+	shader->setMatrixes(glm::mat4(1.f),view_matrix,projection_matrix);
+	shader->setMaterial(track.material);
+	shader->setBuffers(track.buffers);
+	track.texture->bind();
 	static float aniso = -1.0f;
 	if (aniso<0) glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &aniso);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, aniso);
@@ -261,9 +303,10 @@ void renderTrack() {
 }
 
 void renderShadow(const Car &car, const std::vector<Part> &parts) {
-	static Shader shader_shadow("shaders/shadow");
+	static std::shared_ptr<Shader> shader_shadow = AssetCache::getShader("shaders/shadow");
+	static std::shared_ptr<Shader> shader_shadow_batch = AssetCache::getShader("shaders/shadow_batch.vert","shaders/shadow.frag");
 	glEnable(GL_STENCIL_TEST); glClear(GL_STENCIL_BUFFER_BIT);
 	glStencilFunc(GL_EQUAL,0,~0); glStencilOp(GL_KEEP,GL_KEEP,GL_INCR);
-	renderCar(car,parts,shader_shadow);
+	renderCar(car,parts,submit_mode==smPerPart ? *shader_shadow : *shader_shadow_batch);
 	glDisable(GL_STENCIL_TEST);
 }
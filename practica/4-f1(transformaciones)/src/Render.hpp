@@ -14,9 +14,14 @@ extern glm::mat4 projection_matrix, view_matrix;
 struct Part {
 	std::string name;
 	bool show;
-	std::vector<Model> models;
+	AsyncModel models; // empty until loaded
 };
 
+// cmo se envan los dibujos del auto: uno por cada parte de cada modelo
+// (renderPart), o juntndolos en un DrawCommands para enviarlos uno por uno o
+// con multi-draw (con shaders que leen la tabla por dibujo, ver phong_batch)
+enum SubmitMode { smPerPart, smLoop, smMultiDraw };
+
 // funcin para renderizar cada "parte" del auto
 void renderPart(const Car &car, const std::vector<Model> &v_models, const glm::mat4 &matrix, Shader &shader);
 
@@ -29,8 +34,9 @@ void renderTrack();
 // funcin que actualiza las matrices que definen la cmara
 void setViewAndProjectionMatrixes(const Car &car);
 
-// funcin que rendiriza todo el auto, parte por parte
-void renderCar(const Car &car, const std::vector<Part> &parts, Shader &shader);
+// funcin que rendiriza todo el auto, parte por parte (retorna cuntas
+// llamadas de dibujo hizo)
+int renderCar(const Car &car, const std::vector<Part> &parts, Shader &shader);
 
 #endif
 
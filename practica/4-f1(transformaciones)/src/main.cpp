@@ -13,11 +13,15 @@
 #include "Shaders.hpp"
 #include "Car.hpp"
 #include "Render.hpp"
+#include "AssetCache.hpp"
+#include "DrawCommands.hpp"
 
 #define VERSION 20230916
 
 // models and settings
 bool wireframe = false, play = false, top_view = true, use_helmet = true;
+int submit_mode = smPerPart; // ver SubmitMode
+const std::vector<std::string> vsubmit_modes = { "per part", "command buffer (loop)", "command buffer (multi-draw)" };
 
 // extra callbacks (atajos de teclado para cambiar de modo y camara)
 void keyboardCallback(GLFWwindow* glfw_win, int key, int scancode, int action, int mods);
@@ -56,25 +60,34 @@ int main() {
 	glEnable(GL_DEPTH_TEST); glDepthFunc(GL_LESS);
 	glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
 	glClearColor(0.4f,0.4f,0.8f,1.f);
-	Shader shader_phong("shaders/phong");
+	std::shared_ptr<Shader> shader_phong = AssetCache::getShader("shaders/phong");
+	std::shared_ptr<Shader> shader_phong_batch = AssetCache::getShader("shaders/phong_batch");
 	
-	// car parts models
+	// car parts models (loaded in background threads, each part shows up
+	// when its models are ready, with all the obj's parts in a single VAO)
 	std::vector<Part> parts; parts.reserve(8);
-	parts.push_back({"axis",      true,Model::load("axis",      Model::fDontFit)});
-	parts.push_back({"body",      true,Model::load("body",      Model::fDontFit)});
-	parts.push_back({"wheels",    true,Model::load("wheel",     Model::fDontFit)});
-	parts.push_back({"front wing",true,Model::load("front_wing",Model::fDontFit)});
-	parts.push_back({"rear wing", true,Model::load("rear_wing", Model::fDontFit)});
-	parts.push_back({"driver",    true,Model::load("driver",    Model::fDontFit)});
-	parts.push_back({"chookity",  true,Model::load("chookity",  Model::fDontFit)});
+	parts.push_back({"axis",      true,Model::loadAsync("axis",      Model::fDontFit|Model::fPackParts)});
+	parts.push_back({"body",      true,Model::loadAsync("body",      Model::fDontFit|Model::fPackParts)});
+	parts.push_back({"wheels",    true,Model::loadAsync("wheel",     Model::fDontFit|Model::fPackParts)});
+	parts.push_back({"front wing",true,Model::loadAsync("front_wing",Model::fDontFit|Model::fPackParts)});
+	parts.push_back({"rear wing", true,Model::loadAsync("rear_wing", Model::fDontFit|Model::fPackParts)});
+	parts.push_back({"driver",    true,Model::loadAsync("driver",    Model::fDontFit|Model::fPackParts)});
+	parts.push_back({"chookity",  true,Model::loadAsync("chookity",  Model::fDontFit|Model::fPackParts)});
 	
 	// main loop
 	resetSimulation();
 	FrameTimer ftime;
+	double submit_ms = 0.0; // tiempo de cpu en enviar los dibujos del auto (promediado)
+	int draw_calls = 0;
 	do {
 		
 		glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
 		
+		// finish loading the models whose workers are done
+		bool loading = false;
+		for(Part &p : parts) 
+			loading = not p.models.update() or loading;
+		
 		// actualizar las pos del auto y de la camara
 		double elapsed_time = ftime.newFrame();
 		accum_dt += elapsed_time;
@@ -95,10 +108,13 @@ int main() {
 			renderTrack();
 			renderShadow(car,parts);
 		}
-		renderCar(car,parts,shader_phong);
+		double t0 = glfwGetTime();
+		draw_calls = renderCar(car,parts,submit_mode==smPerPart ? *shader_phong : *shader_phong_batch);
+		submit_ms = .95*submit_ms+.05*(glfwGetTime()-t0)*1000.0;
 		
 		// settings sub-window
 		window.ImGuiDialog("CG Example",[&](){
+			if (loading) ImGui::Text("Loading models...");
 			ImGui::Checkbox("Play (P)",&play);
 			if (play) {
 				ImGui::Checkbox("Top View (T)",&top_view);
@@ -131,6 +147,23 @@ int main() {
 				ImGui::LabelText("","rang2: %f",car.rang2);
 				ImGui::TreePop();
 			}
+			if (ImGui::TreeNode("draw submission")) {
+				if (ImGui::Combo("mode",&submit_mode,vsubmit_modes)) submit_ms = 0.0;
+				if (submit_mode==smMultiDraw and not DrawCommands::hasMultiDraw())
+					ImGui::Text("(multi-draw not available, using the loop)");
+				ImGui::LabelText("","CPU submit: %.3f ms, %i draw calls",submit_ms,draw_calls);
+				ImGui::TreePop();
+			}
+			if (ImGui::TreeNode("assets cache")) {
+				auto showStats = [](const char *name, const AssetCache::Stats &s) {
+					ImGui::LabelText("","%s: %i hits, %i misses, %.1f MB saved",
+									 name, s.hits, s.misses, s.gpu_bytes_saved/1048576.0);
+				};
+				showStats("textures",AssetCache::getTextureStats());
+				showStats("shaders",AssetCache::getShaderStats());
+				showStats("models",AssetCache::getModelStats());
+				ImGui::TreePop();
+			}
 		});
 		
 		// finish frame